@@ -78,6 +78,15 @@ class ConfigUpdateRequest(BaseModel):
     sample_interval: int  # en segundos
     avg_samples: int
 
+class CompressorBudgetRequest(BaseModel):
+    max_starts: int  # Arranques simultáneos; 0 = sin límite
+    lease_s: Optional[int] = 120  # Duración del pico de arranque
+
+class DemandResponseRequest(BaseModel):
+    level: int  # 1-3 según la política de cada equipo; 0 = terminar
+    duration_s: Optional[int] = 3600
+    event_id: Optional[str] = None
+
 class ScheduleCreate(BaseModel):
     name: str
     action: str  # 'on' or 'off'
@@ -419,6 +428,38 @@ async def update_device_config(device_id: str, config: ConfigUpdateRequest):
         "status": "command_sent"
     }
 
+@app.post("/fleet/{group}/compressor-budget")
+async def set_compressor_budget(group: str, budget: CompressorBudgetRequest):
+    """Limitar los arranques simultáneos de compresor de un grupo de equipos"""
+    if not 0 <= budget.max_starts <= 255 or not 1 <= budget.lease_s <= 900:
+        raise HTTPException(status_code=400, detail="max_starts 0-255, lease_s 1-900")
+
+    mqtt = get_mqtt_client()
+    success = mqtt.set_compressor_budget(group, budget.max_starts, budget.lease_s)
+    check_mqtt_success(success, "compressor budget")
+
+    return {
+        "group": group,
+        "budget": {"max_starts": budget.max_starts, "lease_s": budget.lease_s},
+        "status": "budget_published"
+    }
+
+@app.post("/fleet/{group}/demand-response")
+async def send_demand_response(group: str, signal: DemandResponseRequest):
+    """Reducir consumo en todo un grupo durante un pico de precio"""
+    if not 0 <= signal.level <= 3 or not 0 <= signal.duration_s <= 14400:
+        raise HTTPException(status_code=400, detail="level 0-3, duration_s 0-14400")
+
+    mqtt = get_mqtt_client()
+    success = mqtt.send_demand_response(group, signal.level, signal.duration_s, signal.event_id)
+    check_mqtt_success(success, "demand response")
+
+    return {
+        "group": group,
+        "signal": {"level": signal.level, "duration_s": signal.duration_s},
+        "status": "demand_response_published"
+    }
+
 @app.post("/devices/{device_id}/reboot")
 async def reboot_device(device_id: str):
     """Reiniciar dispositivo"""
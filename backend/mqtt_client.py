@@ -2,6 +2,10 @@ import paho.mqtt.client as mqtt
 import json
 import asyncio
 import os
+import uuid
+import hmac
+import hashlib
+import time
 from typing import Callable, Dict, Any
 from datetime import datetime
 from utils import now_argentina
@@ -10,12 +14,16 @@ class MQTTClient:
     """Cliente MQTT para comunicación con dispositivos ESP32"""
 
     def __init__(self, broker_host: str, broker_port: int = 1883,
-                 username: str = None, password: str = None):
+                 username: str = None, password: str = None,
+                 command_key: str = None):
         self.broker_host = broker_host
         self.broker_port = broker_port
         self.username = username
         self.password = password
 
+        # Clave HMAC de comandos (CMD_AUTH_KEY del firmware); None = sin firmar
+        self.command_key = command_key.encode('utf-8') if command_key else None
+
         # Estado de conexión
         self.connected = False
         self.client = None
@@ -165,7 +173,7 @@ class MQTTClient:
             self.client.subscribe(topic_pattern)
             print(f"📡 Suscrito a: {topic_pattern}")
 
-    def publish(self, topic: str, payload: Any, qos: int = 0) -> bool:
+    def publish(self, topic: str, payload: Any, qos: int = 0, retain: bool = False) -> bool:
         """Publicar mensaje en un topic"""
         if not self.connected or not self.client:
             print("✗ No conectado al broker MQTT")
@@ -173,12 +181,14 @@ class MQTTClient:
 
         try:
             # Convertir payload a JSON si es necesario
-            if isinstance(payload, (dict, list)):
+            if isinstance(payload, dict) and self.command_key:
+                payload_str = self._sign_payload(topic, payload)
+            elif isinstance(payload, (dict, list)):
                 payload_str = json.dumps(payload)
             else:
                 payload_str = str(payload)
 
-            result = self.client.publish(topic, payload_str, qos)
+            result = self.client.publish(topic, payload_str, qos, retain)
 
             if result.rc == mqtt.MQTT_ERR_SUCCESS:
                 print(f"📤 Enviado: {topic} -> {payload_str[:50]}...")
@@ -191,6 +201,19 @@ class MQTTClient:
             print(f"✗ Error publicando mensaje: {e}")
             return False
 
+    def _sign_payload(self, topic: str, payload: dict) -> str:
+        """Firmar un comando como espera hardware/src/CommandAuth.h.
+
+        Agrega timestamp (UTC en s) y nonce, firma topic + "\n" + JSON con
+        HMAC-SHA256 y agrega la firma como última clave ("sig").
+        """
+        signed = dict(payload)
+        signed["timestamp"] = int(time.time())
+        signed["nonce"] = uuid.uuid4().hex
+        body = json.dumps(signed, separators=(',', ':'))
+        mac = hmac.new(self.command_key, f"{topic}\n{body}".encode('utf-8'), hashlib.sha256)
+        return f'{body[:-1]},"sig":"{mac.hexdigest()}"}}'
+
     # Métodos de conveniencia para comandos específicos
     def send_ac_command(self, device_id: str, action: str,
                         temperature: int = 24, mode: str = 'cool',
@@ -202,6 +225,8 @@ class MQTTClient:
             "temperature": temperature,
             "mode": mode,
             "fan_speed": fan_speed,
+            # ID de idempotencia: el dispositivo descarta reentregas QoS 1
+            "command_id": uuid.uuid4().hex,
             "timestamp": int(now_argentina().timestamp())
         }
         return self.publish(topic, payload)
@@ -237,6 +262,55 @@ class MQTTClient:
         }
         return self.publish(topic, payload)
 
+    def send_ota_update(self, device_id: str, url: str, sha256: str,
+                        fmt: str = 'full', base: str = None) -> bool:
+        """Pedir una actualización OTA (ver hardware/tools/ota_build.py)"""
+        topic = f"{device_id}/ota/update"
+        payload = {
+            "url": url,
+            "sha256": sha256,
+            "format": fmt,
+            "timestamp": int(now_argentina().timestamp())
+        }
+        if base:
+            payload["base"] = base
+        return self.publish(topic, payload, qos=1)
+
+    def request_sensor_reading(self, device_id: str, max_age_ms: int = 30000) -> bool:
+        """Pedir la lectura actual; responde en <device>/sensor/current desde la cache del dispositivo"""
+        topic = f"{device_id}/sensor/read"
+        return self.publish(topic, {"max_age_ms": max_age_ms}, qos=0)
+
+    def send_calibration(self, device_id: str, temperature: list = None,
+                         humidity: list = None) -> bool:
+        """Enviar curvas de calibración [[crudo, referencia], ...] (ver hardware/tools/calibration.py)"""
+        topic = f"{device_id}/calibration/update"
+        payload = {}
+        if temperature is not None:
+            payload["temperature"] = temperature
+        if humidity is not None:
+            payload["humidity"] = humidity
+        return self.publish(topic, payload, qos=1)
+
+    def set_compressor_budget(self, group: str, max_starts: int, lease_s: int = 120) -> bool:
+        """Arranques simultáneos de compresor en un grupo (retained, ver
+        hardware/src/CompressorBudget.h); max_starts 0 quita el límite"""
+        topic = f"fleet/{group}/compressor/budget"
+        payload = {"max_starts": max_starts, "lease_s": lease_s}
+        return self.publish(topic, payload, qos=1, retain=True)
+
+    def send_demand_response(self, group: str, level: int, duration_s: int, event_id: str = None) -> bool:
+        """Señal de demand response para todo un grupo (retained, ver
+        hardware/src/DemandResponse.h); level 0 restaura los equipos"""
+        topic = f"fleet/{group}/demand_response"
+        payload = {
+            "level": level,
+            "duration_s": duration_s,
+            "start": int(time.time()),
+            "event_id": event_id or uuid.uuid4().hex[:16]
+        }
+        return self.publish(topic, payload, qos=1, retain=True)
+
 
 # Instancia global del cliente MQTT
 _mqtt_client = None
@@ -251,12 +325,14 @@ def init_mqtt_client() -> MQTTClient:
         broker_port = int(os.getenv("MQTT_BROKER_PORT", 1883))
         username = os.getenv("MQTT_USERNAME")
         password = os.getenv("MQTT_PASSWORD")
+        command_key = os.getenv("MQTT_COMMAND_KEY")
 
         _mqtt_client = MQTTClient(
             broker_host=broker_host,
             broker_port=broker_port,
             username=username,
-            password=password
+            password=password,
+            command_key=command_key
         )
 
         # Cliente MQTT configurado
@@ -38,12 +38,12 @@ def to_argentina_tz(dt: datetime) -> datetime:
         return dt.astimezone(ARGENTINA_TZ)
 
 
-def from_timestamp_argentina(timestamp: int) -> datetime:
+def from_timestamp_argentina(timestamp: float) -> datetime:
     """
     Convertir un timestamp Unix a datetime en timezone de Argentina
 
     Args:
-        timestamp: Timestamp Unix en segundos
+        timestamp: Timestamp Unix en segundos (admite fracción)
 
     Returns:
         datetime: Datetime en timezone de Argentina
@@ -75,6 +75,11 @@ def parse_message_timestamp(payload: Dict[str, Any]) -> datetime:
     Returns:
         datetime: Timestamp parseado en timezone de Argentina
     """
+    # Los dispositivos envían también timestamp_ms (UTC con resolución de ms)
+    timestamp_ms = payload.get('timestamp_ms')
+    if isinstance(timestamp_ms, int):
+        return from_timestamp_argentina(timestamp_ms / 1000)
+
     timestamp_raw = payload.get('timestamp', int(now_argentina().timestamp()))
     if isinstance(timestamp_raw, int):
         return from_timestamp_argentina(timestamp_raw)
@@ -0,0 +1,311 @@
+// Driver del banco A/B (ver tools/ab_bench.py).
+// Compila el firmware de una revisión para la PC contra los shims de
+// bench/native, reproduce un workload grabado sobre el reloj virtual y
+// escribe en stdout un JSON con latencias, asignaciones, bytes publicados
+// y tiempo de CPU por categoría de evento, más los mensajes que el firmware
+// no pudo parsear.
+//
+// Uso: bench <workload> [--loop-ms 10]
+//
+// Categorías:
+//   setup         una ejecución de setup()
+//   loop          cada iteración de loop() entre eventos
+//   sensor        SensorFusion::leer() con la muestra del workload
+//   sample        SampleEvent por el bus (publicación, promedio, LED...)
+//   mqtt/<topic>  un mensaje entrante completo (callback de PubSubClient)
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+#define setup firmwareSetup
+#define loop firmwareLoop
+#include "main.cpp"
+#undef setup
+#undef loop
+
+// ============================================
+// CONTEO DE ASIGNACIONES
+// ============================================
+// Solo se cuentan las hechas dentro de un evento medido; la contabilidad
+// del propio driver queda afuera
+
+static bool allocCounting = false;
+static uint64_t allocCount = 0;
+static uint64_t allocBytes = 0;
+
+// Fuera de línea: si GCC ve free() inlineado junto al new que reservó,
+// avisa -Wmismatched-new-delete aunque ambos usen malloc/free
+__attribute__((noinline)) static void releaseBlock(void *p)
+{
+  free(p);
+}
+
+void *operator new(size_t size)
+{
+  if (allocCounting)
+  {
+    allocCount++;
+    allocBytes += size;
+  }
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  releaseBlock(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  releaseBlock(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  releaseBlock(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+  releaseBlock(p);
+}
+
+// ============================================
+// MEDICIÓN
+// ============================================
+
+struct Category
+{
+  std::vector<uint32_t> latencyNs;
+  uint64_t allocs = 0;
+  uint64_t allocBytes = 0;
+  uint64_t published = 0;
+  uint64_t publishedBytes = 0;
+};
+
+static std::map<std::string, Category> categories;
+
+template <typename F>
+static void measure(const std::string &name, F fn)
+{
+  Category &c = categories[name];
+  uint64_t allocs0 = allocCount, bytes0 = allocBytes;
+  uint64_t pub0 = BenchEnv::publishCount, pubBytes0 = BenchEnv::publishBytes;
+
+  allocCounting = true;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  allocCounting = false;
+
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  c.latencyNs.push_back(ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns);
+  c.allocs += allocCount - allocs0;
+  c.allocBytes += allocBytes - bytes0;
+  c.published += BenchEnv::publishCount - pub0;
+  c.publishedBytes += BenchEnv::publishBytes - pubBytes0;
+}
+
+static double cpuSeconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// ============================================
+// WORKLOAD
+// ============================================
+// Una línea por evento, '#' comenta:
+//   <t_ms> mqtt <topic sin device_id> <payload hasta fin de línea>
+//   <t_ms> sample <temperatura> <humedad>
+
+struct WorkloadEvent
+{
+  uint64_t timeMs;
+  bool isMqtt;
+  std::string topic;
+  std::string payload;
+  float temperatura;
+  float humedad;
+};
+
+static bool loadWorkload(const char *path, std::vector<WorkloadEvent> &events)
+{
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream fields(line);
+    WorkloadEvent e;
+    std::string kind;
+    if (!(fields >> e.timeMs >> kind))
+      continue;
+
+    if (kind == "mqtt")
+    {
+      std::string suffix;
+      fields >> suffix;
+      std::getline(fields >> std::ws, e.payload);
+      e.isMqtt = true;
+      e.topic = std::string(DEVICE_ID) + "/" + suffix;
+    }
+    else if (kind == "sample")
+    {
+      e.isMqtt = false;
+      if (!(fields >> e.temperatura >> e.humedad))
+        continue;
+    }
+    else
+    {
+      continue;
+    }
+    events.push_back(e);
+  }
+  return true;
+}
+
+// ============================================
+// SALIDA
+// ============================================
+
+static void printCategory(const std::string &name, Category &c, bool last)
+{
+  std::vector<uint32_t> sorted = c.latencyNs;
+  std::sort(sorted.begin(), sorted.end());
+  size_t n = sorted.size();
+  uint64_t sum = 0;
+  for (uint32_t v : sorted)
+    sum += v;
+
+  // Histograma log2: cubeta i = [2^i, 2^(i+1)) ns
+  uint32_t hist[32] = {0};
+  for (uint32_t v : sorted)
+  {
+    int bucket = 0;
+    while (bucket < 31 && (v >> (bucket + 1)) != 0)
+      bucket++;
+    hist[bucket]++;
+  }
+
+  printf("    \"%s\": {\"count\": %zu, \"mean_ns\": %.1f, \"p50_ns\": %u, \"p90_ns\": %u, \"p99_ns\": %u, "
+         "\"max_ns\": %u, \"allocs\": %llu, \"alloc_bytes\": %llu, \"published\": %llu, \"published_bytes\": %llu, "
+         "\"hist_log2_ns\": [",
+         name.c_str(), n, n ? (double)sum / n : 0.0,
+         n ? sorted[n / 2] : 0, n ? sorted[n * 9 / 10] : 0, n ? sorted[n * 99 / 100] : 0, n ? sorted[n - 1] : 0,
+         (unsigned long long)c.allocs, (unsigned long long)c.allocBytes,
+         (unsigned long long)c.published, (unsigned long long)c.publishedBytes);
+  for (int i = 0; i < 32; i++)
+    printf("%u%s", hist[i], i < 31 ? ", " : "");
+  printf("]}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "uso: %s <workload> [--loop-ms 10]\n", argv[0]);
+    return 2;
+  }
+  uint32_t loopMs = 10;
+  for (int i = 2; i + 1 < argc; i++)
+  {
+    if (strcmp(argv[i], "--loop-ms") == 0)
+      loopMs = (uint32_t)atoi(argv[++i]);
+  }
+
+  std::vector<WorkloadEvent> events;
+  if (!loadWorkload(argv[1], events))
+  {
+    fprintf(stderr, "no se pudo leer %s\n", argv[1]);
+    return 2;
+  }
+
+  double cpuStart = cpuSeconds();
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+  measure("setup", []()
+          { firmwareSetup(); });
+  uint64_t startMs = Clock::nowMs();
+
+  for (const WorkloadEvent &e : events)
+  {
+    // loop() avanza el reloj con su delay(); si no lo hace (o tarda menos
+    // que loopMs) se completa hasta el período nominal
+    while (Clock::nowMs() - startMs < e.timeMs)
+    {
+      int64_t before = BenchEnv::nowUs;
+      measure("loop", []()
+              { firmwareLoop(); });
+      int64_t elapsed = BenchEnv::nowUs - before;
+      if (elapsed < (int64_t)loopMs * 1000)
+        BenchEnv::advanceUs((int64_t)loopMs * 1000 - elapsed);
+    }
+
+    if (e.isMqtt)
+    {
+      measure("mqtt/" + e.topic.substr(strlen(DEVICE_ID) + 1), [&e]()
+              { PubSubClient::deliver(e.topic.c_str(), e.payload.data(), e.payload.size()); });
+    }
+    else
+    {
+      DHT::simTemperature = e.temperatura;
+      DHT::simHumidity = e.humedad;
+      bool ok = false;
+      measure("sensor", [&ok]()
+              { ok = sensor.leer(); });
+
+      SampleResult sample;
+      sample.timestampMs = Clock::utcMs();
+      sample.temperatura = sensor.getTemperatura();
+      sample.humedad = sensor.getHumedad();
+      sample.ok = ok;
+      sample.sensorError = sensor.hayErrores();
+      measure("sample", [&sample]()
+              { EventBus::publish(SampleEvent{sample}); });
+    }
+  }
+
+  double cpu = cpuSeconds() - cpuStart;
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  uint64_t totalAllocs = 0, totalPublished = 0, totalPublishedBytes = 0;
+  for (auto &entry : categories)
+  {
+    totalAllocs += entry.second.allocs;
+    totalPublished += entry.second.published;
+    totalPublishedBytes += entry.second.publishedBytes;
+  }
+
+  printf("{\n  \"events\": %zu,\n  \"virtual_s\": %.3f,\n  \"cpu_s\": %.6f,\n  \"wall_s\": %.6f,\n",
+         events.size(), (Clock::nowMs() - startMs) / 1000.0, cpu, wall);
+  printf("  \"allocs\": %llu,\n  \"published\": %llu,\n  \"published_bytes\": %llu,\n",
+         (unsigned long long)totalAllocs, (unsigned long long)totalPublished, (unsigned long long)totalPublishedBytes);
+  printf("  \"parse_errors\": %u,\n  \"categories\": {\n", (unsigned)metricMqttParseErrors.get());
+  size_t i = 0;
+  for (auto &entry : categories)
+    printCategory(entry.first, entry.second, ++i == categories.size());
+  printf("  }\n}\n");
+  return 0;
+}
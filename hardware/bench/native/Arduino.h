@@ -0,0 +1,216 @@
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+// Subconjunto del core de Arduino-ESP32 para compilar el firmware en la PC.
+// Sin hardware: GPIO y PWM no hacen nada, el puerto serie descarta y el
+// tiempo es el reloj virtual de BenchEnv.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include "BenchEnv.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define IRAM_ATTR
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::isinf;
+using std::isnan;
+using std::max;
+using std::min;
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+  size_t print(const char *str) { return write(str); }
+  size_t println(const char *str = "") { return write(str) + write((const uint8_t *)"\r\n", 2); }
+  size_t printf(const char *fmt, ...)
+  {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return n > 0 ? write((const uint8_t *)buf, min((size_t)n, sizeof(buf) - 1)) : 0;
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+  size_t readBytes(char *buffer, size_t length)
+  {
+    size_t n = 0;
+    int c;
+    while (n < length && (c = read()) >= 0)
+      buffer[n++] = (char)c;
+    return n;
+  }
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  void setTimeout(unsigned long) {}
+};
+
+// String de Arduino sobre std::string (las asignaciones se cuentan igual)
+class String
+{
+private:
+  std::string s;
+
+public:
+  String(const char *c = "") : s(c ? c : "") {}
+  String(const std::string &x) : s(x) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(long long v) : s(std::to_string(v)) {}
+  String(unsigned long long v) : s(std::to_string(v)) {}
+  String(double v, unsigned decimals = 2)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s = buf;
+  }
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return (unsigned)s.size(); }
+  bool reserve(unsigned int size) { s.reserve(size); return true; }
+  bool concat(const char *c) { s += c; return true; }
+  bool concat(const char *c, unsigned int n) { s.append(c, n); return true; }
+  bool concat(char c) { s += c; return true; }
+  bool concat(const String &o) { s += o.s; return true; }
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *c) { s += c; return *this; }
+  String &operator+=(char c) { s += c; return *this; }
+  String operator+(const String &o) const { return String(s + o.s); }
+  String operator+(const char *c) const { return String(s + c); }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *c) const { return s == c; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator!=(const char *c) const { return s != c; }
+  char operator[](unsigned int i) const { return s[i]; }
+  bool isEmpty() const { return s.empty(); }
+  bool startsWith(const String &o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+  bool endsWith(const String &o) const
+  {
+    return s.size() >= o.s.size() && s.compare(s.size() - o.s.size(), o.s.size(), o.s) == 0;
+  }
+  int indexOf(char c) const
+  {
+    size_t p = s.find(c);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(unsigned int from, int to = -1) const
+  {
+    return String(s.substr(from, to < 0 ? std::string::npos : to - from));
+  }
+  long toInt() const { return atol(s.c_str()); }
+};
+
+inline String operator+(const char *a, const String &b)
+{
+  return String(a) + b;
+}
+
+class IPAddress
+{
+private:
+  uint8_t octets[4];
+
+public:
+  IPAddress() : octets{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+  bool fromString(const char *) { return true; }
+  String toString() const
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(buf);
+  }
+  operator uint32_t() const { return octets[0] | octets[1] << 8 | octets[2] << 16 | (uint32_t)octets[3] << 24; }
+};
+
+// Monitor serie: descarta la salida y nunca tiene entrada
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t size) override { return size; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int availableForWrite() { return 128; }
+  void flush() {}
+};
+static HardwareSerial Serial;
+
+class EspClass
+{
+public:
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 180000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getHeapSize() { return 300000; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getSketchSize() { return 1000000; }
+  uint32_t getFreeSketchSpace() { return 1900000; }
+  String getSketchMD5() { return String("00000000000000000000000000000000"); }
+  void restart() {} // Se ignora: el workload sigue corriendo
+};
+static EspClass ESP;
+
+inline unsigned long micros() { return (unsigned long)BenchEnv::nowUs; }
+inline unsigned long millis() { return (unsigned long)(BenchEnv::nowUs / 1000); }
+inline void delay(uint32_t ms) { BenchEnv::advanceUs((int64_t)ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { BenchEnv::advanceUs(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcWrite(uint8_t, uint32_t) {}
+
+inline uint32_t esp_random() { return BenchEnv::nextRandom(); }
+
+static uint32_t benchCpuMhz = 240;
+inline bool setCpuFrequencyMhz(uint32_t mhz)
+{
+  benchCpuMhz = mhz;
+  return true;
+}
+inline uint32_t getCpuFrequencyMhz() { return benchCpuMhz; }
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef BENCH_ENV_H
+#define BENCH_ENV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Estado compartido por los shims del build nativo del banco A/B.
+// El tiempo es virtual: solo avanza con delay()/vTaskDelay() o cuando el
+// driver (bench_main.cpp) lo mueve al instante del próximo evento.
+struct BenchEnv
+{
+  static int64_t nowUs;        // Reloj monotónico virtual
+  static int64_t utcEpochUs;   // UTC que entrega SNTP al arrancar
+  static uint32_t randomState;
+
+  // Tráfico MQTT saliente
+  static uint32_t publishCount;
+  static uint64_t publishBytes; // topic + payload
+
+  static void advanceUs(int64_t us)
+  {
+    if (us > 0)
+      nowUs += us;
+  }
+
+  // LCG: mismo esp_random() en ambas revisiones
+  static uint32_t nextRandom()
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    return randomState;
+  }
+};
+
+int64_t BenchEnv::nowUs = 0;
+int64_t BenchEnv::utcEpochUs = 1700000000LL * 1000000LL;
+uint32_t BenchEnv::randomState = 1;
+uint32_t BenchEnv::publishCount = 0;
+uint64_t BenchEnv::publishBytes = 0;
+
+#endif
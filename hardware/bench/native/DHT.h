@@ -0,0 +1,25 @@
+#ifndef BENCH_DHT_H
+#define BENCH_DHT_H
+
+#include <Arduino.h>
+
+#define DHT11 11
+#define DHT22 22
+
+// Devuelve la última muestra del workload (la fija el driver)
+class DHT
+{
+public:
+  static float simTemperature;
+  static float simHumidity;
+
+  DHT(uint8_t, uint8_t) {}
+  void begin(uint8_t = 55) {}
+  float readTemperature(bool = false, bool = false) { return simTemperature; }
+  float readHumidity(bool = false) { return simHumidity; }
+};
+
+float DHT::simTemperature = 24.0f;
+float DHT::simHumidity = 50.0f;
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef BENCH_HTTPCLIENT_H
+#define BENCH_HTTPCLIENT_H
+
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+
+// Las descargas OTA corren en su propia tarea, que el banco no ejecuta
+class HTTPClient
+{
+public:
+  void setTimeout(uint16_t) {}
+  void setReuse(bool) {}
+  bool begin(const char *) { return false; }
+  bool begin(WiFiClient &, const char *) { return false; }
+  void addHeader(const char *, const char *) {}
+  int GET() { return -1; }
+  int getSize() { return -1; }
+  WiFiClient *getStreamPtr() { return nullptr; }
+  bool connected() { return false; }
+  void end() {}
+};
+
+#endif
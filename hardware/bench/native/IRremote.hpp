@@ -0,0 +1,14 @@
+#ifndef BENCH_IRREMOTE_HPP
+#define BENCH_IRREMOTE_HPP
+
+#include <Arduino.h>
+
+// La transmisión IR real tarda ~100 ms de aire; acá no se simula
+struct IRsend
+{
+  void begin(uint8_t) {}
+  void sendRaw(const uint16_t *, uint_fast16_t, uint_fast8_t) {}
+};
+static IRsend IrSender;
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef BENCH_PREFERENCES_H
+#define BENCH_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS en memoria: vacía al arrancar, como un equipo recién flasheado
+class Preferences
+{
+private:
+  typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+  Namespace *ns = nullptr;
+
+  static std::map<std::string, Namespace> &storage()
+  {
+    static std::map<std::string, Namespace> nvs;
+    return nvs;
+  }
+
+  template <typename T>
+  T get(const char *key, T value)
+  {
+    getBytes(key, &value, sizeof(value));
+    return value;
+  }
+
+  template <typename T>
+  size_t put(const char *key, T value)
+  {
+    return putBytes(key, &value, sizeof(value));
+  }
+
+public:
+  bool begin(const char *name, bool = false)
+  {
+    ns = &storage()[name];
+    return true;
+  }
+  void end() { ns = nullptr; }
+  bool clear()
+  {
+    if (ns)
+      ns->clear();
+    return ns != nullptr;
+  }
+  bool remove(const char *key) { return ns && ns->erase(key) > 0; }
+  bool isKey(const char *key) { return ns && ns->count(key) > 0; }
+
+  size_t getBytesLength(const char *key)
+  {
+    if (!ns || !ns->count(key))
+      return 0;
+    return (*ns)[key].size();
+  }
+  size_t getBytes(const char *key, void *buf, size_t maxLen)
+  {
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen)
+      return 0;
+    memcpy(buf, (*ns)[key].data(), len);
+    return len;
+  }
+  size_t putBytes(const char *key, const void *value, size_t len)
+  {
+    if (!ns)
+      return 0;
+    (*ns)[key].assign((const uint8_t *)value, (const uint8_t *)value + len);
+    return len;
+  }
+
+  bool getBool(const char *key, bool value = false) { return get(key, value); }
+  size_t putBool(const char *key, bool value) { return put(key, value); }
+  uint8_t getUChar(const char *key, uint8_t value = 0) { return get(key, value); }
+  size_t putUChar(const char *key, uint8_t value) { return put(key, value); }
+  uint32_t getUInt(const char *key, uint32_t value = 0) { return get(key, value); }
+  size_t putUInt(const char *key, uint32_t value) { return put(key, value); }
+  float getFloat(const char *key, float value = NAN) { return get(key, value); }
+  size_t putFloat(const char *key, float value) { return put(key, value); }
+};
+
+#endif
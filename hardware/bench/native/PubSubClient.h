@@ -0,0 +1,123 @@
+#ifndef BENCH_PUBSUBCLIENT_H
+#define BENCH_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <functional>
+#include "Client.h"
+
+// Broker en memoria: conecta siempre, cuenta lo publicado en BenchEnv y
+// entrega a la sesión activa los mensajes que inyecta el driver.
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+class PubSubClient : public Print
+{
+private:
+  MQTT_CALLBACK_SIGNATURE;
+  bool session = false;
+  uint16_t bufferSize = 256;
+  size_t streamed = 0;
+
+  static PubSubClient *&active()
+  {
+    static PubSubClient *client = nullptr;
+    return client;
+  }
+
+public:
+  PubSubClient() {}
+  PubSubClient(Client &) {}
+
+  PubSubClient &setClient(Client &) { return *this; }
+  PubSubClient &setServer(const char *, uint16_t) { return *this; }
+  PubSubClient &setServer(IPAddress, uint16_t) { return *this; }
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE)
+  {
+    this->callback = callback;
+    return *this;
+  }
+  PubSubClient &setKeepAlive(uint16_t) { return *this; }
+  PubSubClient &setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t size)
+  {
+    bufferSize = size;
+    return true;
+  }
+  uint16_t getBufferSize() { return bufferSize; }
+
+  bool connect(const char *id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr); }
+  bool connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage)
+  {
+    return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage);
+  }
+  bool connect(const char *, const char *, const char *, const char *, uint8_t, bool, const char *)
+  {
+    session = true;
+    active() = this;
+    return true;
+  }
+  void disconnect() { session = false; }
+  bool connected() { return session; }
+  int state() { return session ? 0 : -1; }
+  bool loop() { return session; }
+
+  bool subscribe(const char *, uint8_t = 0) { return session; }
+  bool unsubscribe(const char *) { return session; }
+
+  bool publish(const char *topic, const uint8_t *, unsigned int length, bool = false)
+  {
+    if (!session)
+      return false;
+    BenchEnv::publishCount++;
+    BenchEnv::publishBytes += strlen(topic) + length;
+    return true;
+  }
+  bool publish(const char *topic, const char *payload, bool retained = false)
+  {
+    return publish(topic, (const uint8_t *)payload, payload ? strlen(payload) : 0, retained);
+  }
+
+  bool beginPublish(const char *topic, unsigned int, bool)
+  {
+    if (!session)
+      return false;
+    streamed = strlen(topic);
+    return true;
+  }
+  size_t write(uint8_t) override
+  {
+    streamed++;
+    return 1;
+  }
+  size_t write(const uint8_t *, size_t size) override
+  {
+    streamed += size;
+    return size;
+  }
+  int endPublish()
+  {
+    BenchEnv::publishCount++;
+    BenchEnv::publishBytes += streamed;
+    streamed = 0;
+    return 1;
+  }
+
+  // Mensaje del broker hacia el dispositivo (lo usa el driver)
+  static bool deliver(const char *topic, const char *payload, size_t length)
+  {
+    PubSubClient *client = active();
+    if (!client || !client->session || !client->callback)
+      return false;
+    // PubSubClient entrega topic y payload dentro de su propio buffer
+    // (modificable); sin copias al heap para no ensuciar el conteo
+    static char topicBuffer[256];
+    static uint8_t payloadBuffer[4096];
+    if (strlen(topic) >= sizeof(topicBuffer) || length > sizeof(payloadBuffer))
+      return false;
+    strcpy(topicBuffer, topic);
+    memcpy(payloadBuffer, payload, length);
+    client->callback(topicBuffer, payloadBuffer, (unsigned int)length);
+    return true;
+  }
+};
+
+#endif
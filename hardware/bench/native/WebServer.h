@@ -0,0 +1,33 @@
+#ifndef BENCH_WEBSERVER_H
+#define BENCH_WEBSERVER_H
+
+#include <Arduino.h>
+#include <functional>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod
+{
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_POST
+};
+
+// Sin clientes HTTP: /metrics no se consulta durante el banco
+class WebServer
+{
+public:
+  WebServer(int) {}
+  void on(const char *, HTTPMethod, std::function<void()>) {}
+  void on(const char *, std::function<void()>) {}
+  void begin() {}
+  void handleClient() {}
+  void setContentLength(size_t) {}
+  void send(int, const char *, const char *) {}
+  void sendHeader(const char *, const char *, bool = false) {}
+  void sendContent(const char *, size_t) {}
+  void sendContent(const char *) {}
+  void sendContent(const String &) {}
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef BENCH_WIFI_H
+#define BENCH_WIFI_H
+
+#include <Arduino.h>
+#include "Client.h"
+
+// Red siempre disponible: begin() dispara CONNECTED y GOT_IP en el acto
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+typedef enum
+{
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP = 8
+} arduino_event_id_t;
+
+typedef union
+{
+  struct
+  {
+    uint8_t bssid[6];
+    uint8_t channel;
+  } wifi_sta_connected;
+  struct
+  {
+    uint8_t reason;
+  } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef void (*WiFiEventFuncCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+class WiFiClass
+{
+private:
+  WiFiEventFuncCb callback = nullptr;
+  int state = WL_IDLE_STATUS;
+
+public:
+  void mode(int) {}
+  void persistent(bool) {}
+  void setAutoReconnect(bool) {}
+  void setSleep(bool) {}
+  void onEvent(WiFiEventFuncCb cb, arduino_event_id_t = ARDUINO_EVENT_WIFI_STA_CONNECTED) { callback = cb; }
+
+  void begin(const char *, const char *, int32_t = 0, const uint8_t * = nullptr, bool = true)
+  {
+    state = WL_CONNECTED;
+    if (!callback)
+      return;
+    arduino_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.wifi_sta_connected.channel = 6;
+    callback(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+    callback(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+  }
+
+  bool disconnect(bool = false) { return true; }
+  bool reconnect() { return true; }
+  int status() { return state; }
+  bool isConnected() { return state == WL_CONNECTED; }
+  IPAddress localIP() { return IPAddress(192, 168, 0, 50); }
+  int RSSI() { return -55; }
+  int hostByName(const char *, IPAddress &ip)
+  {
+    ip = IPAddress(192, 168, 0, 105);
+    return 1;
+  }
+};
+static WiFiClass WiFi;
+
+// Sockets que conectan siempre y no reciben nada (sondeos del failback)
+class WiFiClient : public Client
+{
+private:
+  bool open = false;
+
+public:
+  int connect(IPAddress, uint16_t) override { return open = true; }
+  int connect(const char *, uint16_t) override { return open = true; }
+  int connect(const char *host, uint16_t port, int32_t) { return connect(host, port); }
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t size) override { return size; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t *, size_t) override { return 0; }
+  int peek() override { return -1; }
+  void flush() override {}
+  void stop() override { open = false; }
+  uint8_t connected() override { return open; }
+  operator bool() override { return open; }
+  void setTimeout(uint32_t) {}
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BENCH_ESP_OTA_OPS_H
+#define BENCH_ESP_OTA_OPS_H
+
+#include <Arduino.h>
+
+// Imagen ya confirmada en la partición ota_0; escribir una nueva falla
+typedef uint32_t esp_ota_handle_t;
+#define OTA_SIZE_UNKNOWN 0xffffffff
+
+typedef struct
+{
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+typedef struct
+{
+  char version[32];
+  uint8_t app_elf_sha256[32];
+} esp_app_desc_t;
+
+static const esp_partition_t benchOta0 = {0x10000, 0x1E0000, "ota_0"};
+static const esp_partition_t benchOta1 = {0x1F0000, 0x1E0000, "ota_1"};
+static const esp_app_desc_t benchAppDesc = {"bench", {0}};
+
+inline const esp_partition_t *esp_ota_get_running_partition() { return &benchOta0; }
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *) { return &benchOta1; }
+inline const esp_app_desc_t *esp_ota_get_app_description() { return &benchAppDesc; }
+inline esp_err_t esp_ota_begin(const esp_partition_t *, size_t, esp_ota_handle_t *) { return ESP_FAIL; }
+inline esp_err_t esp_ota_write(esp_ota_handle_t, const void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_FAIL; }
+inline esp_err_t esp_ota_abort(esp_ota_handle_t) { return ESP_OK; }
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *) { return ESP_FAIL; }
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t, void *data, size_t len)
+{
+  memset(data, 0xff, len);
+  return ESP_OK;
+}
+
+#endif
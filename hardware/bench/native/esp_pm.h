@@ -0,0 +1,7 @@
+#ifndef BENCH_ESP_PM_H
+#define BENCH_ESP_PM_H
+
+// Sin CONFIG_PM_ENABLE (ver sdkconfig.h) el firmware no usa estas funciones
+#include "esp_timer.h"
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef BENCH_ESP_SNTP_H
+#define BENCH_ESP_SNTP_H
+
+#include <sys/time.h>
+#include "BenchEnv.h"
+
+// La "sincronización" ocurre al iniciar SNTP, con la hora de BenchEnv
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+static sntp_sync_time_cb_t benchSntpCallback = nullptr;
+
+inline void sntp_set_sync_interval(uint32_t) {}
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) { benchSntpCallback = cb; }
+
+// En el core de Arduino está en esp32-hal-time
+inline void configTime(long, int, const char *, const char * = nullptr, const char * = nullptr)
+{
+  if (!benchSntpCallback)
+    return;
+  int64_t utcUs = BenchEnv::utcEpochUs + BenchEnv::nowUs;
+  struct timeval tv;
+  tv.tv_sec = (time_t)(utcUs / 1000000);
+  tv.tv_usec = (suseconds_t)(utcUs % 1000000);
+  benchSntpCallback(&tv);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef BENCH_ESP_TIMER_H
+#define BENCH_ESP_TIMER_H
+
+#include <stdint.h>
+#include "BenchEnv.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define RTC_DATA_ATTR
+
+inline int64_t esp_timer_get_time()
+{
+  return BenchEnv::nowUs;
+}
+
+// Los timers se crean pero no disparan: las muestras las entrega el driver
+typedef struct BenchTimer *esp_timer_handle_t;
+
+typedef enum
+{
+  ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+  void (*callback)(void *arg);
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *, esp_timer_handle_t *handle)
+{
+  *handle = nullptr;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+// FreeRTOS mínimo para el banco: un solo hilo, el de loop().
+// Las tareas se registran pero no corren (el driver entrega las muestras
+// por el bus de eventos); las colas son reales para que el costo de
+// encolar quede en la medición; los delays avanzan el reloj virtual.
+// Las notificaciones también son reales: un chequeo puede hacerse pasar
+// por una tarea (benchRunAs) y atender sus avisos sin bloquear.
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "../BenchEnv.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+#define tskIDLE_PRIORITY 0
+#define configMAX_PRIORITIES 25
+#define configMAX_TASK_NAME_LEN 16
+#define portNUM_PROCESSORS 2
+#define portYIELD_FROM_ISR()
+
+typedef struct
+{
+  int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+// ---------- Tareas ----------
+
+struct BenchTask
+{
+  const char *name;
+  uint32_t notifyValue;
+  bool notifyPending;
+};
+
+// Registro fijo: sin asignaciones que se cuenten en la medición de setup()
+struct BenchTaskList
+{
+  BenchTask *items[16];
+  size_t count;
+};
+
+inline BenchTaskList &benchTasks()
+{
+  static BenchTaskList tasks = {};
+  return tasks;
+}
+
+// Tarea "en ejecución" (nullptr: loopTask)
+inline BenchTask *&benchCurrentTask()
+{
+  static BenchTask *current = nullptr;
+  return current;
+}
+
+inline TaskHandle_t benchFindTask(const char *name)
+{
+  BenchTaskList &tasks = benchTasks();
+  for (size_t i = 0; i < tasks.count; i++)
+  {
+    if (strcmp(tasks.items[i]->name, name) == 0)
+      return tasks.items[i];
+  }
+  return nullptr;
+}
+
+inline void benchRunAs(TaskHandle_t task) { benchCurrentTask() = (BenchTask *)task; }
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *name, uint32_t, void *,
+                                          UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+  BenchTask *task = new BenchTask{name, 0, false};
+  BenchTaskList &tasks = benchTasks();
+  if (tasks.count < sizeof(tasks.items) / sizeof(tasks.items[0]))
+    tasks.items[tasks.count++] = task;
+  if (handle)
+    *handle = task;
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                              UBaseType_t priority, TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle, 0);
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t ticks) { BenchEnv::advanceUs((int64_t)ticks * 1000); }
+inline TickType_t xTaskGetTickCount() { return (TickType_t)(BenchEnv::nowUs / 1000); }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return benchCurrentTask(); }
+inline const char *pcTaskGetName(TaskHandle_t task)
+{
+  BenchTask *t = task ? (BenchTask *)task : benchCurrentTask();
+  return t ? t->name : "loopTask";
+}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+
+typedef enum
+{
+  eNoAction = 0,
+  eSetBits,
+  eIncrement,
+  eSetValueWithOverwrite,
+  eSetValueWithoutOverwrite
+} eNotifyAction;
+
+inline BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action)
+{
+  BenchTask *task = (BenchTask *)handle;
+  if (!task)
+    return pdFAIL;
+  if (action == eSetBits)
+    task->notifyValue |= value;
+  else if (action == eIncrement)
+    task->notifyValue++;
+  else if (action != eNoAction)
+    task->notifyValue = value;
+  task->notifyPending = true;
+  return pdPASS;
+}
+
+// Sin esperar: sin aviso pendiente devuelve pdFALSE como un timeout
+inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t)
+{
+  BenchTask *task = benchCurrentTask();
+  if (!task || !task->notifyPending)
+  {
+    if (task)
+      task->notifyValue &= ~clearOnEntry;
+    if (value)
+      *value = task ? task->notifyValue : 0;
+    return pdFALSE;
+  }
+  if (value)
+    *value = task->notifyValue;
+  task->notifyValue &= ~clearOnExit;
+  task->notifyPending = false;
+  return pdTRUE;
+}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+typedef enum
+{
+  eRunning = 0,
+  eReady,
+  eBlocked,
+  eSuspended,
+  eDeleted
+} eTaskState;
+
+typedef struct
+{
+  TaskHandle_t xHandle;
+  const char *pcTaskName;
+  UBaseType_t xTaskNumber;
+  eTaskState eCurrentState;
+  UBaseType_t uxCurrentPriority;
+  UBaseType_t uxBasePriority;
+  uint32_t ulRunTimeCounter;
+  uint32_t *pxStackBase;
+  uint32_t usStackHighWaterMark;
+  BaseType_t xCoreID;
+} TaskStatus_t;
+
+inline UBaseType_t uxTaskGetNumberOfTasks() { return 0; }
+inline UBaseType_t uxTaskGetSystemState(TaskStatus_t *, UBaseType_t, uint32_t *totalRunTime)
+{
+  if (totalRunTime)
+    *totalRunTime = 0;
+  return 0;
+}
+
+// ---------- Colas ----------
+
+struct BenchQueue
+{
+  std::vector<uint8_t> storage;
+  size_t itemSize;
+  size_t capacity;
+  size_t head;
+  size_t count;
+};
+typedef BenchQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  BenchQueue *q = new BenchQueue;
+  q->storage.resize((size_t)length * itemSize);
+  q->itemSize = itemSize;
+  q->capacity = length;
+  q->head = 0;
+  q->count = 0;
+  return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t)
+{
+  if (!q || q->count == q->capacity)
+    return pdFALSE;
+  size_t slot = (q->head + q->count) % q->capacity;
+  memcpy(&q->storage[slot * q->itemSize], item, q->itemSize);
+  q->count++;
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *)
+{
+  return xQueueSend(q, item, 0);
+}
+
+inline BaseType_t xQueueOverwrite(QueueHandle_t q, const void *item)
+{
+  if (q && q->count == q->capacity)
+  {
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+  }
+  return xQueueSend(q, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t)
+{
+  if (!q || q->count == 0)
+    return pdFALSE;
+  memcpy(item, &q->storage[q->head * q->itemSize], q->itemSize);
+  q->head = (q->head + 1) % q->capacity;
+  q->count--;
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return q ? (UBaseType_t)q->count : 0; }
+
+// ---------- Semáforos (un solo hilo: siempre libres) ----------
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return (SemaphoreHandle_t)1; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+#endif
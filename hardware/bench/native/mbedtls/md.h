@@ -0,0 +1,84 @@
+#ifndef BENCH_MBEDTLS_MD_H
+#define BENCH_MBEDTLS_MD_H
+
+#include "sha256.h"
+
+// HMAC-SHA256 sobre el SHA-256 por software de sha256.h
+typedef enum
+{
+  MBEDTLS_MD_NONE = 0,
+  MBEDTLS_MD_SHA256 = 6
+} mbedtls_md_type_t;
+
+typedef struct
+{
+  mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+typedef struct
+{
+  const mbedtls_md_info_t *md_info;
+  mbedtls_sha256_context sha;
+  uint8_t ipad[64];
+  uint8_t opad[64];
+} mbedtls_md_context_t;
+
+static inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+  static const mbedtls_md_info_t sha256 = {MBEDTLS_MD_SHA256};
+  return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+static inline void mbedtls_md_init(mbedtls_md_context_t *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+static inline void mbedtls_md_free(mbedtls_md_context_t *) {}
+
+static inline int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int)
+{
+  ctx->md_info = info;
+  return info ? 0 : -1;
+}
+
+static inline int mbedtls_md_hmac_reset(mbedtls_md_context_t *ctx)
+{
+  mbedtls_sha256_starts_ret(&ctx->sha, 0);
+  return mbedtls_sha256_update_ret(&ctx->sha, ctx->ipad, 64);
+}
+
+static inline int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keyLen)
+{
+  uint8_t k[64] = {0};
+  if (keyLen > 64)
+  {
+    mbedtls_sha256_context h;
+    mbedtls_sha256_starts_ret(&h, 0);
+    mbedtls_sha256_update_ret(&h, key, keyLen);
+    mbedtls_sha256_finish_ret(&h, k);
+  }
+  else
+  {
+    memcpy(k, key, keyLen);
+  }
+  for (int i = 0; i < 64; i++)
+  {
+    ctx->ipad[i] = k[i] ^ 0x36;
+    ctx->opad[i] = k[i] ^ 0x5c;
+  }
+  return mbedtls_md_hmac_reset(ctx);
+}
+
+static inline int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *data, size_t len)
+{
+  return mbedtls_sha256_update_ret(&ctx->sha, data, len);
+}
+
+static inline int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *out)
+{
+  uint8_t inner[32];
+  mbedtls_sha256_finish_ret(&ctx->sha, inner);
+  mbedtls_sha256_starts_ret(&ctx->sha, 0);
+  mbedtls_sha256_update_ret(&ctx->sha, ctx->opad, 64);
+  mbedtls_sha256_update_ret(&ctx->sha, inner, 32);
+  return mbedtls_sha256_finish_ret(&ctx->sha, out);
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef BENCH_SDKCONFIG_H
+#define BENCH_SDKCONFIG_H
+
+// Build nativo: sin aceleradores de hardware ni gestión de energía de IDF
+
+#endif
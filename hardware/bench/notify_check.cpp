@@ -0,0 +1,76 @@
+// Chequeo de las notificaciones de SamplingTask sobre el banco: una
+// lectura a pedido despierta la tarea una sola vez y hace una sola
+// conversión; el aviso no queda pegado para los avisos siguientes.
+//
+// Compilar como bench_main.cpp (ver tools/ab_bench.py) y correr:
+//   g++ -std=gnu++11 -Ibench/native -Isrc -I<alias> -I<ArduinoJson>
+//       bench/notify_check.cpp -o notify_check && ./notify_check
+// Sale con código 1 si algún paso falla.
+
+#define setup firmwareSetup
+#define loop firmwareLoop
+#include "main.cpp"
+#undef setup
+#undef loop
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+  printf("%s %s\n", ok ? "✓" : "✗", what);
+  if (!ok)
+    failures++;
+}
+
+int main()
+{
+  firmwareSetup();
+  TaskHandle_t sensing = benchFindTask("sensing");
+  expect(sensing != nullptr, "tarea de muestreo creada");
+  if (!sensing)
+    return 1;
+
+  // Avisos del arranque
+  benchRunAs(sensing);
+  while (sampling.serviceOnce(0))
+    ;
+  benchRunAs(nullptr);
+
+  for (int round = 0; round < 2; round++)
+  {
+    BenchEnv::advanceUs((int64_t)SENSOR_MIN_READ_INTERVAL_MS * 2000);
+
+    SensorReading reading;
+    uint32_t ticket = 0;
+    bool cached = sampling.requestRead(reading, SENSOR_MIN_READ_INTERVAL_MS, ticket);
+    expect(!cached, "lectura vieja: se pide una conversión");
+
+    uint32_t conversions = metricSensorConversions.get();
+    uint32_t hits = metricSensorCacheHits.get();
+
+    benchRunAs(sensing);
+    bool woke = sampling.serviceOnce(0);
+    bool wokeAgain = sampling.serviceOnce(0);
+    benchRunAs(nullptr);
+
+    expect(woke, "el aviso despierta la tarea");
+    expect(!wokeAgain, "el aviso se consume (sin segunda vuelta)");
+    expect(metricSensorConversions.get() == conversions + 1, "una sola conversión");
+    expect(metricSensorCacheHits.get() == hits, "sin aciertos de cache extra");
+    expect(sampling.readDone(ticket, reading), "readDone ve la conversión");
+
+    // Otro aviso (cambio de intervalo) no repite la lectura a pedido
+    BenchEnv::advanceUs((int64_t)SENSOR_MIN_READ_INTERVAL_MS * 2000);
+    conversions = metricSensorConversions.get();
+    hits = metricSensorCacheHits.get();
+    sampling.setInterval(SAMPLE_INTERVAL_MS);
+    benchRunAs(sensing);
+    woke = sampling.serviceOnce(0);
+    benchRunAs(nullptr);
+    expect(woke, "el cambio de intervalo despierta la tarea");
+    expect(metricSensorConversions.get() == conversions && metricSensorCacheHits.get() == hits,
+           "sin lectura: el bit de la anterior ya se consumió");
+  }
+
+  return failures ? 1 : 0;
+}
@@ -3,6 +3,17 @@
 
 #include <Arduino.h>
 #include <IRremote.hpp>
+#include "Clock.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Log.h"
+#include "PowerManager.h"
+#include "CompressorBudget.h"
+
+static const uint32_t IR_SEND_BUCKETS_US[] = {50000, 100000, 150000, 200000, 300000};
+static Counter metricIrSends("ac_ir_sends", "Comandos IR transmitidos");
+static Counter metricAcRejected("ac_commands_rejected", "Comandos AC rechazados por el delay minimo");
+static Histogram<5> metricIrSendUs("ac_ir_send_us", "Duracion de la transmision IR en microsegundos", IR_SEND_BUCKETS_US);
 
 // Midea AC Protocol Constants
 enum class AcMode : uint8_t
@@ -22,16 +33,31 @@ enum class FanSpeed : uint8_t
   F_HIGH = 0b0011
 };
 
+enum class AcSendResult : uint8_t
+{
+  SENT,
+  QUEUED,  // Arranque de compresor esperando lease (ver CompressorBudget.h)
+  REJECTED
+};
+
 class AcController
 {
 private:
   uint8_t irPin;
+  CompressorBudget &budget;
   bool encendido;
   uint8_t temperatura; // 17-30°C
   AcMode modo;
   FanSpeed fanSpeed;
-  unsigned long ultimoCambio;
-  const unsigned long MIN_DELAY_BETWEEN_COMMANDS = 2000;
+  uint64_t ultimoCambio; // ms monotónicos
+  const uint32_t MIN_DELAY_BETWEEN_COMMANDS = 2000;
+
+  // Arranque en cola: solo el último comando de encendido
+  bool online; // Sesión con el broker, según el último loop()
+  bool startPending;
+  uint8_t pendingTemp;
+  char pendingMode[8];
+  char pendingFan[8];
 
   // Midea protocol timing (in microseconds)
   // T = 21 pulses at 38kHz ≈ 553µs
@@ -129,45 +155,59 @@ private:
     IrSender.sendRaw(rawData, idx, 38);
   }
 
+  // Encender, o pasar de ventilación a un modo con compresor
+  bool arrancaCompresor(bool powerOn, const char *modeStr) const
+  {
+    return powerOn && strcmp(modeStr, "fan") != 0 && (!encendido || modo == AcMode::FAN);
+  }
+
 public:
-  AcController(uint8_t pin) : irPin(pin), encendido(false), temperatura(24),
-                              modo(AcMode::COOL), fanSpeed(FanSpeed::AUTO),
-                              ultimoCambio(0) {}
+  AcController(uint8_t pin, CompressorBudget &startBudget)
+      : irPin(pin), budget(startBudget), encendido(false), temperatura(24),
+        modo(AcMode::COOL), fanSpeed(FanSpeed::AUTO), ultimoCambio(0),
+        online(false), startPending(false), pendingTemp(24)
+  {
+    memset(pendingMode, 0, sizeof(pendingMode));
+    memset(pendingFan, 0, sizeof(pendingFan));
+  }
 
   void begin()
   {
     IrSender.begin(irPin);
-    Serial.println("✓ Controlador AC Midea iniciado");
+    LOG_I("✓ Controlador AC Midea iniciado");
   }
 
-  bool enviarComando(bool powerOn, uint8_t temp, const String &modeStr, const String &fanStr)
+  bool enviarComando(bool powerOn, uint8_t temp, const char *modeStr, const char *fanStr)
   {
-    if (millis() - ultimoCambio < MIN_DELAY_BETWEEN_COMMANDS)
+    TRACE_SCOPE("enviarComando");
+    CpuBoost boost; // Sin cambios de frecuencia durante la trama IR
+    if (Clock::nowMs() - ultimoCambio < MIN_DELAY_BETWEEN_COMMANDS)
     {
-      Serial.println("⚠️ Esperando delay mínimo entre comandos AC");
+      LOG_W("⚠️ Esperando delay mínimo entre comandos AC");
+      metricAcRejected.inc();
       return false;
     }
 
     // Parse mode
-    if (modeStr == "cool")
+    if (strcmp(modeStr, "cool") == 0)
       modo = AcMode::COOL;
-    else if (modeStr == "heat")
+    else if (strcmp(modeStr, "heat") == 0)
       modo = AcMode::HEAT;
-    else if (modeStr == "auto")
+    else if (strcmp(modeStr, "auto") == 0)
       modo = AcMode::AUTO;
-    else if (modeStr == "fan")
+    else if (strcmp(modeStr, "fan") == 0)
       modo = AcMode::FAN;
-    else if (modeStr == "dry")
+    else if (strcmp(modeStr, "dry") == 0)
       modo = AcMode::DRY;
 
     // Parse fan speed
-    if (fanStr == "auto")
+    if (strcmp(fanStr, "auto") == 0)
       fanSpeed = FanSpeed::AUTO;
-    else if (fanStr == "low")
+    else if (strcmp(fanStr, "low") == 0)
       fanSpeed = FanSpeed::F_LOW;
-    else if (fanStr == "medium")
+    else if (strcmp(fanStr, "medium") == 0)
       fanSpeed = FanSpeed::MEDIUM;
-    else if (fanStr == "high")
+    else if (strcmp(fanStr, "high") == 0)
       fanSpeed = FanSpeed::F_HIGH;
 
     // Set temperature
@@ -178,15 +218,70 @@ public:
     uint8_t data[3];
     buildCommand(data, powerOn);
 
-    Serial.printf("📡 Enviando comando AC: power=%s, temp=%d°C, mode=%s, fan=%s\n",
-                  powerOn ? "ON" : "OFF", temperatura, modeStr.c_str(), fanStr.c_str());
-    Serial.printf("   Data: 0x%02X 0x%02X 0x%02X\n", data[0], data[1], data[2]);
+    LOG_I("📡 Enviando comando AC: power=%s, temp=%d°C, mode=%s, fan=%s",
+          powerOn ? "ON" : "OFF", temperatura, modeStr, fanStr);
+    LOG_D("   Data: 0x%02X 0x%02X 0x%02X", data[0], data[1], data[2]);
 
+    uint64_t sendStart = Clock::nowUs();
     sendMideaCommand(data);
-    ultimoCambio = millis();
+    metricIrSendUs.observe((uint32_t)(Clock::nowUs() - sendStart));
+    metricIrSends.inc();
+    ultimoCambio = Clock::nowMs();
+    return true;
+  }
+
+  // Comando remoto: un arranque de compresor espera su lease y se envía
+  // desde loop(); cualquier otro comando se envía ya y descarta el arranque
+  // en cola
+  AcSendResult solicitar(bool powerOn, uint8_t temp, const char *modeStr, const char *fanStr)
+  {
+    bool start = arrancaCompresor(powerOn, modeStr);
+    if (start && !budget.request(online && Clock::isSynced()))
+    {
+      startPending = true;
+      pendingTemp = temp;
+      strncpy(pendingMode, modeStr, sizeof(pendingMode) - 1);
+      strncpy(pendingFan, fanStr, sizeof(pendingFan) - 1);
+      return AcSendResult::QUEUED;
+    }
+
+    if (startPending && !start)
+    {
+      LOG_I("⏹️ Arranque en cola descartado");
+      budget.cancel();
+    }
+    startPending = false;
+    return enviarComando(powerOn, temp, modeStr, fanStr) ? AcSendResult::SENT : AcSendResult::REJECTED;
+  }
+
+  // Llamar en cada loop(). Devuelve true si envió el arranque en cola, con
+  // el resultado en success. online: hay sesión con el broker
+  bool loop(bool brokerOnline, bool &success)
+  {
+    online = brokerOnline;
+    budget.update();
+    if (!startPending || !budget.request(online && Clock::isSynced()))
+      return false;
+    if (!puedeEnviar())
+      return false;
+
+    startPending = false;
+    success = enviarComando(true, pendingTemp, pendingMode, pendingFan);
     return true;
   }
 
+  // Hay un arranque esperando lease
+  bool arranqueEnCola() const
+  {
+    return startPending;
+  }
+
+  // Pasó el delay mínimo desde el último comando
+  bool puedeEnviar() const
+  {
+    return Clock::nowMs() - ultimoCambio >= MIN_DELAY_BETWEEN_COMMANDS;
+  }
+
   // Legacy methods for backward compatibility
   bool encender()
   {
@@ -203,7 +298,7 @@ public:
   AcMode getModo() const { return modo; }
   FanSpeed getFanSpeed() const { return fanSpeed; }
 
-  String getModoStr() const
+  const char *getModoStr() const
   {
     switch (modo)
     {
@@ -222,7 +317,7 @@ public:
     }
   }
 
-  String getFanStr() const
+  const char *getFanStr() const
   {
     switch (fanSpeed)
     {
@@ -242,29 +337,29 @@ public:
   void setEstado(bool estado) { encendido = estado; }
   void setTemperatura(uint8_t temp) { temperatura = constrain(temp, 17, 30); }
 
-  void setModo(const String &modeStr)
+  void setModo(const char *modeStr)
   {
-    if (modeStr == "cool")
+    if (strcmp(modeStr, "cool") == 0)
       modo = AcMode::COOL;
-    else if (modeStr == "heat")
+    else if (strcmp(modeStr, "heat") == 0)
       modo = AcMode::HEAT;
-    else if (modeStr == "auto")
+    else if (strcmp(modeStr, "auto") == 0)
       modo = AcMode::AUTO;
-    else if (modeStr == "fan")
+    else if (strcmp(modeStr, "fan") == 0)
       modo = AcMode::FAN;
-    else if (modeStr == "dry")
+    else if (strcmp(modeStr, "dry") == 0)
       modo = AcMode::DRY;
   }
 
-  void setFanSpeed(const String &fanStr)
+  void setFanSpeed(const char *fanStr)
   {
-    if (fanStr == "auto")
+    if (strcmp(fanStr, "auto") == 0)
       fanSpeed = FanSpeed::AUTO;
-    else if (fanStr == "low")
+    else if (strcmp(fanStr, "low") == 0)
       fanSpeed = FanSpeed::F_LOW;
-    else if (fanStr == "medium")
+    else if (strcmp(fanStr, "medium") == 0)
       fanSpeed = FanSpeed::MEDIUM;
-    else if (fanStr == "high")
+    else if (strcmp(fanStr, "high") == 0)
       fanSpeed = FanSpeed::F_HIGH;
   }
 };
@@ -0,0 +1,156 @@
+#ifndef BROKER_SELECTOR_H
+#define BROKER_SELECTOR_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+struct BrokerEndpoint
+{
+  const char *host;
+  uint16_t port;
+};
+
+// Elección de broker MQTT entre una lista ordenada por preferencia.
+// Cada broker lleva un puntaje de salud (latencia de conexión suavizada +
+// penalización por fallos recientes + su posición en la lista). Tras
+// MQTT_BROKER_FAIL_THRESHOLD fallos seguidos queda en cuarentena, que se
+// duplica con cada fallo hasta MQTT_BROKER_QUARANTINE_MAX_MS.
+// La vuelta a un broker preferido exige MQTT_FAILBACK_PROBES sondeos TCP
+// seguidos exitosos y haber estado MQTT_FAILBACK_MIN_STAY_MS en el actual,
+// para no rebotar entre brokers mientras el primario se estabiliza.
+class BrokerSelector
+{
+private:
+  struct Health
+  {
+    uint32_t latencyMs;     // EWMA (1/4) de conexiones y sondeos
+    uint16_t failures;      // Fallos consecutivos
+    uint32_t totalFailures;
+    uint64_t downUntilMs;   // Fin de la cuarentena (ms monotónicos)
+    uint8_t probeStreak;    // Sondeos exitosos seguidos
+  };
+
+  const BrokerEndpoint *brokers;
+  size_t count;
+  Health health[MQTT_BROKERS_MAX];
+
+  bool quarantined(size_t i, uint64_t now) const
+  {
+    return health[i].downUntilMs > now;
+  }
+
+  uint32_t score(size_t i) const
+  {
+    return health[i].latencyMs + health[i].failures * MQTT_BROKER_FAIL_PENALTY_MS +
+           i * MQTT_BROKER_PRIORITY_MS;
+  }
+
+  void updateLatency(size_t i, uint32_t latencyMs)
+  {
+    Health &h = health[i];
+    h.latencyMs = h.latencyMs == 0 ? latencyMs : (3 * h.latencyMs + latencyMs) / 4;
+  }
+
+public:
+  BrokerSelector(const BrokerEndpoint *list, size_t n)
+      : brokers(list), count(n > MQTT_BROKERS_MAX ? MQTT_BROKERS_MAX : n)
+  {
+    memset(health, 0, sizeof(health));
+  }
+
+  size_t size() const { return count; }
+  const BrokerEndpoint &get(size_t i) const { return brokers[i]; }
+
+  // Mejor broker fuera de cuarentena; si están todos caídos, el que sale
+  // antes de la cuarentena (nunca se deja de intentar)
+  size_t select(uint64_t now) const
+  {
+    size_t best = count;
+    for (size_t i = 0; i < count; i++)
+    {
+      if (!quarantined(i, now) && (best == count || score(i) < score(best)))
+        best = i;
+    }
+    if (best < count)
+      return best;
+
+    best = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+      if (health[i].downUntilMs < health[best].downUntilMs)
+        best = i;
+    }
+    return best;
+  }
+
+  bool allQuarantined(uint64_t now) const
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      if (!quarantined(i, now))
+        return false;
+    }
+    return true;
+  }
+
+  void reportSuccess(size_t i, uint32_t latencyMs)
+  {
+    updateLatency(i, latencyMs);
+    health[i].failures = 0;
+    health[i].downUntilMs = 0;
+  }
+
+  void reportFailure(size_t i, uint64_t now)
+  {
+    Health &h = health[i];
+    h.failures++;
+    h.totalFailures++;
+    h.probeStreak = 0;
+    if (h.failures >= MQTT_BROKER_FAIL_THRESHOLD)
+    {
+      uint32_t shift = h.failures - MQTT_BROKER_FAIL_THRESHOLD;
+      uint64_t quarantineMs = (uint64_t)MQTT_BROKER_QUARANTINE_MS << (shift > 4 ? 4 : shift);
+      if (quarantineMs > MQTT_BROKER_QUARANTINE_MAX_MS)
+        quarantineMs = MQTT_BROKER_QUARANTINE_MAX_MS;
+      h.downUntilMs = now + quarantineMs;
+    }
+  }
+
+  // Broker más preferido que el actual al que conviene sondear para volver,
+  // o size() si no hay ninguno
+  size_t failbackCandidate(size_t current, uint64_t now) const
+  {
+    for (size_t i = 0; i < current && i < count; i++)
+    {
+      if (!quarantined(i, now))
+        return i;
+    }
+    return count;
+  }
+
+  void reportProbe(size_t i, bool ok, uint32_t latencyMs, uint64_t now)
+  {
+    if (!ok)
+    {
+      reportFailure(i, now);
+      return;
+    }
+    updateLatency(i, latencyMs);
+    health[i].failures = 0;
+    if (health[i].probeStreak < 255)
+      health[i].probeStreak++;
+  }
+
+  bool failbackReady(size_t i, size_t current, uint64_t connectedForMs) const
+  {
+    return health[i].probeStreak >= MQTT_FAILBACK_PROBES && connectedForMs >= MQTT_FAILBACK_MIN_STAY_MS &&
+           score(i) < score(current);
+  }
+
+  void resetProbes(size_t i)
+  {
+    health[i].probeStreak = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include "Config.h"
+#include "Log.h"
+
+// Par (lectura cruda, referencia) medido contra un termómetro/higrómetro patrón
+struct CalPoint
+{
+  float raw;
+  float ref;
+};
+
+enum class CalChannel : uint8_t
+{
+  TEMPERATURE,
+  HUMIDITY
+};
+
+// Curva de corrección lineal por tramos. Con un punto es un offset, con dos
+// offset y ganancia, con más sigue la no linealidad; fuera de los puntos se
+// extrapola con el primer/último tramo.
+// Al cargarla se compila a una tabla de CAL_LUT_CELLS celdas uniformes sobre
+// el rango del sensor, así apply() es índice + interpolación sin búsquedas
+// ni saltos. Hay dos tablas: set() compila en la inactiva y la publica de
+// forma atómica, porque la tarea de muestreo puede estar leyendo la otra.
+class CalibrationCurve
+{
+private:
+  struct Table
+  {
+    float y[CAL_LUT_CELLS + 1]; // Valor corregido en cada nodo de la grilla
+  };
+
+  CalPoint points[CAL_MAX_POINTS];
+  size_t count;
+  float x0;
+  float step;
+  float invStep;
+  Table tables[2];
+  std::atomic<uint8_t> active;
+
+  void compile()
+  {
+    uint8_t next = active.load(std::memory_order_relaxed) ^ 1;
+    for (size_t i = 0; i <= CAL_LUT_CELLS; i++)
+      tables[next].y[i] = evaluate(x0 + i * step);
+    active.store(next, std::memory_order_release);
+  }
+
+public:
+  CalibrationCurve(float rangeMin, float rangeMax)
+      : count(0), x0(rangeMin), step((rangeMax - rangeMin) / CAL_LUT_CELLS),
+        invStep(CAL_LUT_CELLS / (rangeMax - rangeMin)), active(0)
+  {
+    compile();
+  }
+
+  // Reemplaza los puntos; 0 puntos = sin corrección. Rechaza valores no
+  // finitos y lecturas crudas repetidas.
+  bool set(const CalPoint *pts, size_t n)
+  {
+    if (n > CAL_MAX_POINTS)
+      return false;
+
+    CalPoint sorted[CAL_MAX_POINTS];
+    for (size_t i = 0; i < n; i++)
+    {
+      if (isnan(pts[i].raw) || isnan(pts[i].ref) || isinf(pts[i].raw) || isinf(pts[i].ref))
+        return false;
+
+      // Inserción ordenada por lectura cruda
+      size_t j = i;
+      while (j > 0 && sorted[j - 1].raw > pts[i].raw)
+      {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      if (j > 0 && sorted[j - 1].raw == pts[i].raw)
+        return false;
+      sorted[j] = pts[i];
+    }
+
+    memcpy(points, sorted, n * sizeof(CalPoint));
+    count = n;
+    compile();
+    return true;
+  }
+
+  // Evaluación exacta de la curva (para compilar la tabla y verificarla)
+  float evaluate(float raw) const
+  {
+    if (count == 0)
+      return raw;
+    if (count == 1)
+      return raw + (points[0].ref - points[0].raw);
+
+    size_t k = 0;
+    while (k + 2 < count && raw > points[k + 1].raw)
+      k++;
+    const CalPoint &a = points[k];
+    const CalPoint &b = points[k + 1];
+    return a.ref + (raw - a.raw) * (b.ref - a.ref) / (b.raw - a.raw);
+  }
+
+  // Núcleo por muestra: fuera del rango se satura al borde de la tabla
+  inline float apply(float raw) const
+  {
+    const float *y = tables[active.load(std::memory_order_acquire)].y;
+    float f = fminf(fmaxf((raw - x0) * invStep, 0.0f), CAL_LUT_CELLS - 0.0001f);
+    int i = (int)f;
+    float t = f - i;
+    return y[i] + (y[i + 1] - y[i]) * t;
+  }
+
+  size_t getCount() const { return count; }
+  const CalPoint *getPoints() const { return points; }
+};
+
+// Curvas de temperatura y humedad de un sensor, persistidas en NVS
+class SensorCalibration
+{
+private:
+  const char *nvsNamespace;
+  CalibrationCurve temperature;
+  CalibrationCurve humidity;
+
+  static const char *key(CalChannel channel)
+  {
+    return channel == CalChannel::TEMPERATURE ? "t" : "h";
+  }
+
+public:
+  SensorCalibration(const char *ns = "cal")
+      : nvsNamespace(ns), temperature(-40.0f, 80.0f), humidity(0.0f, 100.0f) {}
+
+  CalibrationCurve &curve(CalChannel channel)
+  {
+    return channel == CalChannel::TEMPERATURE ? temperature : humidity;
+  }
+
+  void begin()
+  {
+    Preferences prefs;
+    prefs.begin(nvsNamespace, true);
+    for (uint8_t c = 0; c < 2; c++)
+    {
+      CalChannel channel = (CalChannel)c;
+      CalPoint pts[CAL_MAX_POINTS];
+      size_t len = prefs.getBytesLength(key(channel));
+      if (len == 0 || len % sizeof(CalPoint) != 0 || len > sizeof(pts))
+        continue;
+      prefs.getBytes(key(channel), pts, len);
+      curve(channel).set(pts, len / sizeof(CalPoint));
+    }
+    prefs.end();
+
+    LOG_I("📐 Calibración: %u puntos temperatura, %u puntos humedad",
+          (unsigned)temperature.getCount(), (unsigned)humidity.getCount());
+  }
+
+  // Aplica y guarda una curva nueva
+  bool update(CalChannel channel, const CalPoint *pts, size_t n)
+  {
+    if (!curve(channel).set(pts, n))
+      return false;
+
+    Preferences prefs;
+    prefs.begin(nvsNamespace, false);
+    if (n == 0)
+      prefs.remove(key(channel));
+    else
+      prefs.putBytes(key(channel), curve(channel).getPoints(), n * sizeof(CalPoint));
+    prefs.end();
+    return true;
+  }
+
+  float temperatureC(float raw) const { return temperature.apply(raw); }
+  float humidityPct(float raw) const { return fminf(fmaxf(humidity.apply(raw), 0.0f), 100.0f); }
+};
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef CERTIFICATES_H
+#define CERTIFICATES_H
+
+// CA del broker MQTT (PEM). Generado por tools/tls_certs.sh
+static const char MQTT_CA_CERT[] = R"PEM(
+)PEM";
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#endif
+
+// Base de tiempo única del firmware.
+// - Monotónica: microsegundos desde el arranque en 64 bits (esp_timer),
+//   no desborda en la vida útil del equipo.
+// - UTC: se obtiene sumando un offset que SNTP actualiza en cada sincronización,
+//   así los timestamps conservan resolución de milisegundos.
+// Fuera de Arduino (build nativo) el reloj es virtual y se avanza a mano.
+class Clock
+{
+private:
+  static int64_t utcOffsetUs; // UTC(µs) - monotónico(µs)
+  static bool synced;
+
+#ifdef ARDUINO
+  static portMUX_TYPE mux;
+
+  // Se ejecuta en la tarea de lwIP cuando SNTP ajusta la hora
+  static void onSntpSync(struct timeval *tv)
+  {
+    syncUtc((int64_t)tv->tv_sec * 1000000LL + tv->tv_usec);
+  }
+#else
+  static uint64_t virtualUs;
+#endif
+
+public:
+  static uint64_t nowUs()
+  {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time();
+#else
+    return virtualUs;
+#endif
+  }
+
+  static uint64_t nowMs()
+  {
+    return nowUs() / 1000;
+  }
+
+  // Registrar la hora UTC actual (µs desde epoch)
+  static void syncUtc(int64_t utcUs)
+  {
+    int64_t offset = utcUs - (int64_t)nowUs();
+#ifdef ARDUINO
+    portENTER_CRITICAL(&mux);
+#endif
+    utcOffsetUs = offset;
+    synced = true;
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&mux);
+#endif
+  }
+
+  static bool isSynced()
+  {
+    return synced;
+  }
+
+  // Convertir un instante monotónico (µs) a UTC en milisegundos
+  static uint64_t toUtcMs(uint64_t monoUs)
+  {
+#ifdef ARDUINO
+    portENTER_CRITICAL(&mux);
+#endif
+    int64_t offset = utcOffsetUs;
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&mux);
+#endif
+    return (uint64_t)((int64_t)monoUs + offset) / 1000;
+  }
+
+  static uint64_t utcMs()
+  {
+    return toUtcMs(nowUs());
+  }
+
+  static uint32_t utcSeconds()
+  {
+    return (uint32_t)(utcMs() / 1000);
+  }
+
+#ifdef ARDUINO
+  static void beginSntp(const char *server, uint32_t syncIntervalMs)
+  {
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    sntp_set_sync_interval(syncIntervalMs);
+    configTime(0, 0, server); // Siempre UTC; la zona horaria la aplica el backend
+  }
+#else
+  static void setVirtualUs(uint64_t us) { virtualUs = us; }
+  static void advanceUs(uint64_t us) { virtualUs += us; }
+#endif
+};
+
+// Inicializar miembros estáticos
+int64_t Clock::utcOffsetUs = 0;
+bool Clock::synced = false;
+#ifdef ARDUINO
+portMUX_TYPE Clock::mux = portMUX_INITIALIZER_UNLOCKED;
+#else
+uint64_t Clock::virtualUs = 0;
+#endif
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef COMMAND_AUTH_H
+#define COMMAND_AUTH_H
+
+#include <Arduino.h>
+#include <sdkconfig.h>
+#include <mbedtls/md.h>
+#include "Config.h"
+#include "Clock.h"
+#include "CommandDedup.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "PowerManager.h"
+
+static const uint32_t AUTH_VERIFY_BUCKETS_US[] = {50, 100, 200, 500, 1000};
+static Histogram<5> metricAuthVerifyUs("mqtt_auth_verify_us", "Duracion de la verificacion HMAC de un comando en microsegundos", AUTH_VERIFY_BUCKETS_US);
+static Counter metricAuthRejected("mqtt_auth_rejected", "Comandos rechazados por firma, timestamp o nonce");
+static Counter metricAuthUnsigned("mqtt_auth_unsigned", "Comandos sin firma recibidos");
+
+enum class AuthResult
+{
+  OK,
+  UNSIGNED,
+  BAD_SIGNATURE,
+  STALE,      // Timestamp fuera de la ventana
+  REPLAY,     // Nonce ya usado
+  BAD_NONCE,
+  UNSYNCED    // Sin hora NTP no se puede acotar el timestamp
+};
+
+// Autenticación de comandos MQTT con HMAC-SHA256.
+// El backend agrega "timestamp" (UTC en s) y "nonce" al JSON, firma
+// topic + "\n" + JSON y agrega la firma como última clave:
+//   {...,"nonce":"...","sig":"<64 hex>"}
+// La firma cubre el JSON sin ese sufijo, así que se verifica sobre los bytes
+// recibidos sin canonizar nada. Incluir el topic impide reusar una firma de
+// /led/command en /system/reboot.
+// Contra repeticiones: el timestamp debe caer en ±CMD_AUTH_WINDOW_S de la
+// hora NTP y el nonce no debe haberse visto en 2 ventanas. Sin hora NTP se
+// rechazan: tras un reinicio el cache de nonces está vacío y cualquier
+// comando capturado volvería a valer (p. ej. /system/reboot en bucle).
+// El SHA-256 lo hace mbedTLS, que en el core de Arduino usa el acelerador
+// SHA del ESP32 (CONFIG_MBEDTLS_HARDWARE_SHA); el estado con la clave
+// (ipad/opad) se calcula una vez en begin().
+class CommandAuth
+{
+public:
+  static const size_t MAC_LEN = 32;
+  static const size_t SIG_PREFIX_LEN = 8;                           // ,"sig":"
+  static const size_t TRAILER_LEN = SIG_PREFIX_LEN + 2 * MAC_LEN + 2; // ... "}
+
+private:
+
+  mbedtls_md_context_t ctx;
+  bool enabled;
+  CommandDedupCache<CMD_AUTH_NONCE_SETS> nonces;
+
+  static int hexNibble(char c)
+  {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  static bool parseMac(const char *hex, uint8_t *out)
+  {
+    for (size_t i = 0; i < MAC_LEN; i++)
+    {
+      int hi = hexNibble(hex[2 * i]);
+      int lo = hexNibble(hex[2 * i + 1]);
+      if (hi < 0 || lo < 0)
+        return false;
+      out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+  }
+
+  // Tiempo constante: recorre todos los bytes aunque difiera el primero
+  static bool equalConstantTime(const uint8_t *a, const uint8_t *b, size_t len)
+  {
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++)
+      diff |= a[i] ^ b[i];
+    return diff == 0;
+  }
+
+  // HMAC(topic + "\n" + body + "}"); body es el JSON sin el sufijo de firma
+  void computeMac(const char *topic, const char *body, size_t bodyLen, uint8_t *mac)
+  {
+    mbedtls_md_hmac_reset(&ctx);
+    mbedtls_md_hmac_update(&ctx, (const unsigned char *)topic, strlen(topic));
+    mbedtls_md_hmac_update(&ctx, (const unsigned char *)"\n", 1);
+    mbedtls_md_hmac_update(&ctx, (const unsigned char *)body, bodyLen);
+    mbedtls_md_hmac_update(&ctx, (const unsigned char *)"}", 1);
+    mbedtls_md_hmac_finish(&ctx, mac);
+  }
+
+  // Costo de verificar un comando AC típico, a la frecuencia de handleMessage
+  void benchmark(uint32_t iterations)
+  {
+    static const char topic[] = DEVICE_ID "/ac/command";
+    static const char body[] =
+        "{\"action\":\"on\",\"temperature\":24,\"mode\":\"cool\",\"fan_speed\":\"auto\","
+        "\"command_id\":\"4f1c2b9e8d7a6c5b4f3e2d1c0b9a8f7e\",\"timestamp\":1700000000,"
+        "\"nonce\":\"9a8b7c6d5e4f3a2b1c0d9e8f7a6b5c4d\"";
+    uint8_t mac[MAC_LEN];
+    uint8_t expected[MAC_LEN] = {0};
+
+    CpuBoost boost;
+    uint64_t start = Clock::nowUs();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+      computeMac(topic, body, sizeof(body) - 1, mac);
+      equalConstantTime(mac, expected, MAC_LEN);
+    }
+    uint32_t perCommandUs = (uint32_t)((Clock::nowUs() - start) / iterations);
+
+#if defined(CONFIG_MBEDTLS_HARDWARE_SHA)
+    const char *engine = "SHA por hardware";
+#else
+    const char *engine = "SHA por software";
+#endif
+    LOG_I("⏱️ HMAC-SHA256: %u µs por comando (%u bytes, %u MHz, %s)",
+          perCommandUs, (unsigned)(sizeof(topic) + sizeof(body) + TRAILER_LEN), getCpuFrequencyMhz(), engine);
+  }
+
+public:
+  CommandAuth()
+      : enabled(false), nonces(CMD_AUTH_WINDOW_S * 2000UL)
+  {
+    mbedtls_md_init(&ctx);
+  }
+
+  void begin(const char *key)
+  {
+    size_t keyLen = strlen(key);
+    if (keyLen == 0)
+    {
+      LOG_W("⚠️ Comandos sin autenticar (CMD_AUTH_KEY vacía)");
+      return;
+    }
+
+    if (mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) != 0 ||
+        mbedtls_md_hmac_starts(&ctx, (const unsigned char *)key, keyLen) != 0)
+    {
+      LOG_E("✗ No se pudo iniciar HMAC-SHA256, comandos sin autenticar");
+      return;
+    }
+    enabled = true;
+    LOG_I("🔐 Comandos firmados con HMAC-SHA256 (%s)", CMD_AUTH_REQUIRED ? "obligatorio" : "opcional");
+
+#if CMD_AUTH_BENCHMARK
+    benchmark(200);
+#endif
+  }
+
+  bool isEnabled() const
+  {
+    return enabled;
+  }
+
+  // Primera etapa, sobre el payload crudo: deserializeJson modifica el
+  // buffer, así que se llama antes de parsear
+  AuthResult verifySignature(const char *topic, const char *message, size_t length)
+  {
+    if (!enabled)
+      return AuthResult::OK;
+
+    if (length < TRAILER_LEN + 1 ||
+        memcmp(message + length - TRAILER_LEN, ",\"sig\":\"", SIG_PREFIX_LEN) != 0 ||
+        memcmp(message + length - 2, "\"}", 2) != 0)
+    {
+      metricAuthUnsigned.inc();
+      return AuthResult::UNSIGNED;
+    }
+
+    uint8_t received[MAC_LEN];
+    if (!parseMac(message + length - TRAILER_LEN + SIG_PREFIX_LEN, received))
+      return AuthResult::BAD_SIGNATURE;
+
+    uint64_t start = Clock::nowUs();
+    uint8_t mac[MAC_LEN];
+    computeMac(topic, message, length - TRAILER_LEN, mac);
+    bool ok = equalConstantTime(mac, received, MAC_LEN);
+    metricAuthVerifyUs.observe((uint32_t)(Clock::nowUs() - start));
+
+    return ok ? AuthResult::OK : AuthResult::BAD_SIGNATURE;
+  }
+
+  // Firma un JSON propio con el mismo formato ({...,"sig":"..."}) para los
+  // mensajes entre dispositivos; json necesita TRAILER_LEN - 1 bytes más
+  // (y el terminador). Devuelve el largo nuevo, o len sin clave
+  size_t sign(const char *topic, char *json, size_t len)
+  {
+    if (!enabled || len < 2 || json[len - 1] != '}')
+      return len;
+
+    uint8_t mac[MAC_LEN];
+    computeMac(topic, json, len - 1, mac);
+    char *out = json + len - 1;
+    memcpy(out, ",\"sig\":\"", SIG_PREFIX_LEN);
+    out += SIG_PREFIX_LEN;
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < MAC_LEN; i++)
+    {
+      *out++ = hex[mac[i] >> 4];
+      *out++ = hex[mac[i] & 0x0f];
+    }
+    memcpy(out, "\"}", 3);
+    return len - 1 + TRAILER_LEN;
+  }
+
+  // Segunda etapa, con los campos ya parseados de un mensaje firmado.
+  // Consume el nonce: llamar una sola vez por mensaje
+  AuthResult checkFreshness(uint32_t timestamp, const char *nonce)
+  {
+    if (!enabled)
+      return AuthResult::OK;
+
+    size_t nonceLen = strlen(nonce);
+    if (nonceLen < 8 || nonceLen > CommandDedupCache<CMD_AUTH_NONCE_SETS>::MAX_ID_LEN)
+      return AuthResult::BAD_NONCE;
+
+    if (!Clock::isSynced())
+      return AuthResult::UNSYNCED;
+
+    int64_t skew = (int64_t)timestamp - (int64_t)Clock::utcSeconds();
+    if (skew > CMD_AUTH_WINDOW_S || skew < -CMD_AUTH_WINDOW_S)
+      return AuthResult::STALE;
+
+    uint64_t now = Clock::nowMs();
+    bool seen;
+    if (nonces.lookup(nonce, now, seen))
+      return AuthResult::REPLAY;
+    nonces.remember(nonce, true, now);
+    return AuthResult::OK;
+  }
+
+  // Resultado aceptable, sin contar rechazos
+  static bool acceptable(AuthResult result)
+  {
+    return result == AuthResult::OK || (result == AuthResult::UNSIGNED && !CMD_AUTH_REQUIRED);
+  }
+
+  // Decide si se ejecuta el comando; cuenta los rechazos
+  bool allowed(AuthResult result)
+  {
+    if (acceptable(result))
+      return true;
+    metricAuthRejected.inc();
+    return false;
+  }
+
+  static const char *describe(AuthResult result)
+  {
+    switch (result)
+    {
+    case AuthResult::OK:
+      return "ok";
+    case AuthResult::UNSIGNED:
+      return "sin firma";
+    case AuthResult::BAD_SIGNATURE:
+      return "firma invalida";
+    case AuthResult::STALE:
+      return "timestamp fuera de ventana";
+    case AuthResult::REPLAY:
+      return "nonce repetido";
+    case AuthResult::BAD_NONCE:
+      return "nonce invalido";
+    case AuthResult::UNSYNCED:
+      return "sin hora NTP";
+    }
+    return "?";
+  }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef COMMAND_DEDUP_H
+#define COMMAND_DEDUP_H
+
+#include <Arduino.h>
+
+// Cache de IDs de comando recientes para descartar reentregas QoS 1.
+// Tabla asociativa por conjuntos: el hash del ID elige un conjunto de WAYS
+// entradas, así que la búsqueda es O(1) y sin memoria dinámica.
+// Result: lo que se guarda de la primera ejecución (bool por defecto).
+template <size_t SETS, size_t WAYS = 4, typename Result = bool>
+class CommandDedupCache
+{
+public:
+  static const size_t MAX_ID_LEN = 40;
+
+private:
+  struct Entry
+  {
+    uint32_t hash;
+    uint64_t timestamp; // ms monotónicos
+    bool used;
+    Result result;
+    char id[MAX_ID_LEN + 1];
+  };
+
+  Entry entries[SETS][WAYS];
+  uint32_t ttlMs;
+
+  // FNV-1a de 32 bits
+  static uint32_t hashId(const char *id)
+  {
+    uint32_t h = 2166136261u;
+    while (*id)
+    {
+      h ^= (uint8_t)*id++;
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  bool expired(const Entry &e, uint64_t now) const
+  {
+    return now - e.timestamp >= ttlMs;
+  }
+
+public:
+  CommandDedupCache(uint32_t ttl) : ttlMs(ttl)
+  {
+    clear();
+  }
+
+  // Devuelve true si el ID ya se procesó dentro del TTL; en ese caso
+  // cachedResult recibe el resultado de la primera ejecución.
+  bool lookup(const char *id, uint64_t now, Result &cachedResult) const
+  {
+    uint32_t h = hashId(id);
+    const Entry *set = entries[h % SETS];
+
+    for (size_t i = 0; i < WAYS; i++)
+    {
+      const Entry &e = set[i];
+      if (e.used && e.hash == h && !expired(e, now) && strncmp(e.id, id, MAX_ID_LEN) == 0)
+      {
+        cachedResult = e.result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Registra un ID ejecutado (o actualiza su resultado); si no está,
+  // reemplaza una entrada vencida o la más antigua del conjunto
+  void remember(const char *id, Result result, uint64_t now)
+  {
+    uint32_t h = hashId(id);
+    Entry *set = entries[h % SETS];
+    Entry *victim = nullptr;
+
+    for (size_t i = 0; i < WAYS && !victim; i++)
+    {
+      if (set[i].used && set[i].hash == h && strncmp(set[i].id, id, MAX_ID_LEN) == 0)
+        victim = &set[i];
+    }
+    for (size_t i = 0; i < WAYS && !victim; i++)
+    {
+      if (!set[i].used || expired(set[i], now))
+        victim = &set[i];
+    }
+    if (!victim)
+    {
+      victim = &set[0];
+      for (size_t i = 1; i < WAYS; i++)
+      {
+        if (now - set[i].timestamp > now - victim->timestamp)
+          victim = &set[i];
+      }
+    }
+
+    victim->hash = h;
+    victim->timestamp = now;
+    victim->used = true;
+    victim->result = result;
+    strncpy(victim->id, id, MAX_ID_LEN);
+    victim->id[MAX_ID_LEN] = '\0';
+  }
+
+  void clear()
+  {
+    for (size_t s = 0; s < SETS; s++)
+    {
+      for (size_t i = 0; i < WAYS; i++)
+      {
+        entries[s][i].used = false;
+      }
+    }
+  }
+};
+
+#endif
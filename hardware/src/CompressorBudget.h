@@ -0,0 +1,348 @@
+#ifndef COMPRESSOR_BUDGET_H
+#define COMPRESSOR_BUDGET_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "Events.h"
+
+static const uint32_t FLEET_WAIT_BUCKETS_MS[] = {1000, 5000, 30000, 120000, 600000};
+static Counter metricFleetQueued("fleet_compressor_queued", "Arranques de compresor que pidieron lease");
+static Histogram<5> metricFleetWaitMs("fleet_compressor_wait_ms", "Espera de un arranque de compresor hasta obtener el lease", FLEET_WAIT_BUCKETS_MS);
+static Counter metricFleetLost("fleet_compressor_claims_lost", "Pedidos de lease perdidos contra otros dispositivos");
+static Counter metricFleetTimeouts("fleet_compressor_timeouts", "Arranques sin lease por superar FLEET_MAX_WAIT_MS");
+static Counter metricFleetOffline("fleet_compressor_offline_starts", "Arranques sin coordinar (sin broker o sin hora NTP)");
+static Gauge metricFleetHeld("fleet_compressor_leases_held", "Leases vigentes de otros dispositivos del grupo");
+
+// Lease propio a publicar (retained) en FLEET_TOPIC/lease/<device_id>
+struct CompressorLease
+{
+  bool present; // false: borrar el retained
+  bool held;    // false: pedido en curso
+  uint64_t sinceMs;   // UTC de entrada a la cola, orden entre pedidos
+  uint64_t expiresMs; // UTC
+};
+
+// Límite de arranques simultáneos de compresor en un grupo de equipos.
+// El backend publica retained FLEET_TOPIC/budget {"max_starts": N, "lease_s": S}
+// y cada dispositivo publica retained su lease en FLEET_TOPIC/lease/<id>.
+// Arrancar requiere un lease: con lugar libre se publica un pedido, se
+// esperan FLEET_CLAIM_SETTLE_MS los pedidos simultáneos y los ganan los de
+// entrada a la cola más antigua (desempate por device_id) hasta completar
+// los lugares que dejan los leases vigentes; el resto retira el pedido y
+// reintenta con jitter conservando su lugar en la cola (tomado con hora NTP:
+// sin ella cuenta desde la sincronización). El lease vence solo
+// a los S segundos (el pico de arranque ya pasó) y se borra el retained.
+// Sin broker o sin hora NTP no se puede coordinar: cada equipo arranca tras
+// un retraso fijo derivado de su ID (reparte un arranque masivo en
+// FLEET_OFFLINE_SPREAD_MS) y nadie espera más de FLEET_MAX_WAIT_MS.
+// Sin presupuesto publicado (o max_starts 0) no hay límite.
+// Se usa solo desde loop().
+class CompressorBudget
+{
+private:
+  enum class State : uint8_t
+  {
+    IDLE,
+    WAITING,  // En cola, sin pedido publicado
+    CLAIMING, // Pedido publicado, esperando pedidos simultáneos
+    HELD
+  };
+
+  struct Peer
+  {
+    bool used;
+    bool held;
+    uint64_t sinceMs;   // UTC
+    uint64_t expiresMs; // Monotónico
+    char device[FLEET_DEVICE_ID_MAX + 1];
+  };
+
+  const char *deviceId;
+  Peer peers[FLEET_LEASES_MAX];
+  uint8_t maxStarts; // 0: sin límite
+  uint32_t leaseMs;
+
+  State state;
+  uint64_t queuedMs;   // Monotónico, entrada a la cola
+  uint64_t sinceMs;    // UTC, entrada a la cola (0: sin hora NTP todavía)
+  uint64_t claimMs;    // Monotónico, último pedido publicado
+  uint64_t retryMs;    // Monotónico, próximo pedido posible
+  uint64_t expiresMs;  // Monotónico, vencimiento del lease propio
+  uint32_t offlineDelayMs;
+  bool leaseDirty;
+
+  static CompressorBudget *instance; // Destino de los eventos del grupo
+
+  // Orden de la cola: entrada más antigua primero, empate por ID
+  bool before(const Peer &peer) const
+  {
+    return peer.sinceMs < sinceMs || (peer.sinceMs == sinceMs && strcmp(peer.device, deviceId) < 0);
+  }
+
+  // Lugares ocupados por leases ajenos y pedidos que van antes que el propio
+  uint8_t ahead(uint64_t now)
+  {
+    uint8_t held = 0, count = 0;
+    for (Peer &peer : peers)
+    {
+      if (peer.used && now >= peer.expiresMs)
+        peer.used = false;
+      if (!peer.used)
+        continue;
+      if (peer.held)
+        held++;
+      if (peer.held || before(peer))
+        count++;
+    }
+    metricFleetHeld.set(held);
+    return count;
+  }
+
+  void grant(uint64_t now)
+  {
+    metricFleetWaitMs.observe((uint32_t)(now - queuedMs));
+    state = State::HELD;
+    expiresMs = now + leaseMs;
+    leaseDirty = true;
+  }
+
+  void release()
+  {
+    if (state == State::CLAIMING || state == State::HELD)
+      leaseDirty = true;
+    state = State::IDLE;
+  }
+
+  Peer *findPeer(const char *device)
+  {
+    Peer *freeSlot = nullptr;
+    uint64_t now = Clock::nowMs();
+    for (Peer &peer : peers)
+    {
+      if (peer.used && strcmp(peer.device, device) == 0)
+        return &peer;
+      if (!freeSlot && (!peer.used || now >= peer.expiresMs))
+        freeSlot = &peer;
+    }
+    return freeSlot;
+  }
+
+public:
+  CompressorBudget(const char *id)
+      : deviceId(id), maxStarts(0), leaseMs(FLEET_LEASE_DEFAULT_S * 1000UL), state(State::IDLE),
+        queuedMs(0), sinceMs(0), claimMs(0), retryMs(0), expiresMs(0), leaseDirty(false)
+  {
+    memset(peers, 0, sizeof(peers));
+    instance = this;
+
+    // FNV-1a del ID: mismo retraso en cada arranque sin broker
+    uint32_t h = 2166136261u;
+    for (const char *c = id; *c; c++)
+      h = (h ^ (uint8_t)*c) * 16777619u;
+    offlineDelayMs = FLEET_OFFLINE_SPREAD_MS ? h % FLEET_OFFLINE_SPREAD_MS : 0;
+  }
+
+  // FLEET_TOPIC/budget; maxStarts 0 quita el límite
+  void setBudget(uint8_t starts, uint32_t leaseDurationMs)
+  {
+    if (leaseDurationMs == 0 || leaseDurationMs > FLEET_LEASE_MAX_S * 1000UL)
+      leaseDurationMs = FLEET_LEASE_DEFAULT_S * 1000UL;
+    if (starts == maxStarts && leaseDurationMs == leaseMs)
+      return;
+
+    if (starts)
+      LOG_I("🏭 Grupo %s: %u arranques simultáneos, lease de %u s", FLEET_GROUP, starts, (unsigned)(leaseDurationMs / 1000));
+    else
+      LOG_I("🏭 Grupo %s: arranques sin límite", FLEET_GROUP);
+    maxStarts = starts;
+    leaseMs = leaseDurationMs;
+    if (starts == 0)
+      cancel(); // Un pedido en curso ya no hace falta
+  }
+
+  // FLEET_TOPIC/lease/<device>; present false = retained borrado
+  void onLease(const char *device, bool present, bool held, uint64_t since, uint64_t expiresUtcMs)
+  {
+    if (strcmp(device, deviceId) == 0 || strlen(device) > FLEET_DEVICE_ID_MAX)
+      return;
+
+    Peer *peer = findPeer(device);
+    if (!present || !Clock::isSynced())
+    {
+      if (peer && peer->used && strcmp(peer->device, device) == 0)
+        peer->used = false;
+      return;
+    }
+
+    uint64_t utcNow = Clock::utcMs();
+    if (expiresUtcMs <= utcNow)
+      return; // Retained de un equipo que no volvió a borrarlo
+    if (!peer)
+    {
+      LOG_W("⚠️ Tabla de leases llena (%u)", (unsigned)FLEET_LEASES_MAX);
+      return;
+    }
+
+    // Nadie espera más de FLEET_MAX_WAIT_MS: un since más viejo es de un
+    // reloj sin sincronizar y no se adelanta a los demás, va al final
+    if (since + FLEET_MAX_WAIT_MS + FLEET_CLAIM_SETTLE_MS < utcNow)
+      since = utcNow;
+
+    peer->used = true;
+    peer->held = held;
+    peer->sinceMs = since;
+    peer->expiresMs = Clock::nowMs() + min(expiresUtcMs - utcNow, (uint64_t)FLEET_LEASE_MAX_S * 1000);
+    strcpy(peer->device, device);
+  }
+
+  // Sesión nueva con el broker: los retained vuelven a llegar, y el lease
+  // propio se republica (o se borra el que quedó de antes de un reinicio)
+  void onConnected()
+  {
+    memset(peers, 0, sizeof(peers));
+    leaseDirty = true;
+    if (state == State::CLAIMING)
+      state = State::WAITING;
+  }
+
+  // Llamar mientras haya un arranque en cola; true cuando se puede arrancar.
+  // online: hay broker y hora NTP
+  bool request(bool online)
+  {
+    uint64_t now = Clock::nowMs();
+    if (maxStarts == 0 || state == State::HELD)
+      return true;
+
+    if (state == State::IDLE)
+    {
+      state = State::WAITING;
+      queuedMs = now;
+      sinceMs = Clock::isSynced() ? Clock::utcMs() : 0;
+      retryMs = now;
+      metricFleetQueued.inc();
+      LOG_I("⏳ Arranque de compresor en cola (límite %u en %s)", maxStarts, FLEET_GROUP);
+    }
+
+    if (now - queuedMs >= FLEET_MAX_WAIT_MS)
+    {
+      LOG_W("⚠️ Sin lease tras %u s, se arranca igual", (unsigned)(FLEET_MAX_WAIT_MS / 1000));
+      metricFleetTimeouts.inc();
+      grant(now);
+      return true;
+    }
+
+    if (!online)
+    {
+      // El pedido no se puede confirmar; se retira al reconectar
+      if (state == State::CLAIMING)
+        state = State::WAITING;
+      if (now - queuedMs < offlineDelayMs)
+        return false;
+      LOG_W("⚠️ Arranque sin coordinar tras %u ms de retraso", (unsigned)offlineDelayMs);
+      metricFleetOffline.inc();
+      grant(now);
+      return true;
+    }
+
+    // Sin hora al entrar a la cola, el lugar se toma al sincronizar: con el
+    // reloj desde el arranque quedaría décadas antes que el resto
+    if (sinceMs == 0)
+      sinceMs = Clock::utcMs();
+
+    if (state == State::WAITING)
+    {
+      if (now >= retryMs && ahead(now) < maxStarts)
+      {
+        state = State::CLAIMING;
+        claimMs = now;
+        leaseDirty = true;
+      }
+      return false;
+    }
+
+    // CLAIMING: decidir cuando pasó la ventana de pedidos simultáneos
+    if (now - claimMs < FLEET_CLAIM_SETTLE_MS)
+      return false;
+
+    uint8_t position = ahead(now);
+    if (position < maxStarts)
+    {
+      LOG_I("✓ Lease de arranque obtenido tras %u ms", (unsigned)(now - queuedMs));
+      grant(now);
+      return true;
+    }
+
+    LOG_D("Lease perdido (%u adelante), reintento", position);
+    metricFleetLost.inc();
+    state = State::WAITING;
+    retryMs = now + FLEET_RETRY_MIN_MS + esp_random() % (FLEET_RETRY_MAX_MS - FLEET_RETRY_MIN_MS);
+    leaseDirty = true;
+    return false;
+  }
+
+  // El arranque en cola se descartó (p. ej. llegó un apagado)
+  void cancel()
+  {
+    if (state == State::WAITING || state == State::CLAIMING)
+      release();
+  }
+
+  // Vencimiento del lease propio; llamar en cada loop()
+  void update()
+  {
+    if (state == State::HELD && Clock::nowMs() >= expiresMs)
+    {
+      LOG_D("Lease de arranque vencido");
+      release();
+    }
+  }
+
+  // Lease propio pendiente de publicar; llamar solo con conexión
+  bool pollLease(CompressorLease &lease)
+  {
+    if (!leaseDirty)
+      return false;
+    leaseDirty = false;
+
+    lease.present = state == State::CLAIMING || state == State::HELD;
+    lease.held = state == State::HELD;
+    lease.sinceMs = sinceMs;
+    uint64_t now = Clock::nowMs();
+    uint64_t remaining = lease.held ? (expiresMs > now ? expiresMs - now : 0) : 2 * FLEET_CLAIM_SETTLE_MS;
+    lease.expiresMs = Clock::utcMs() + remaining;
+    return true;
+  }
+
+  // Handlers del bus de eventos
+  static bool onBudgetEvent(const FleetBudgetEvent &event)
+  {
+    if (instance)
+      instance->setBudget(event.maxStarts, event.leaseMs);
+    return true;
+  }
+
+  static bool onLeaseEvent(const FleetLeaseEvent &event)
+  {
+    if (instance)
+      instance->onLease(event.device, event.present, event.held, event.sinceMs, event.expiresMs);
+    return true;
+  }
+
+  static bool onConnectedEvent(const MqttConnectedEvent &)
+  {
+    if (instance)
+      instance->onConnected();
+    return true;
+  }
+};
+
+CompressorBudget *CompressorBudget::instance = nullptr;
+
+EVENT_SUBSCRIBE(FleetBudgetEvent, 0, CompressorBudget::onBudgetEvent);
+EVENT_SUBSCRIBE(FleetLeaseEvent, 0, CompressorBudget::onLeaseEvent);
+EVENT_SUBSCRIBE(MqttConnectedEvent, 0, CompressorBudget::onConnectedEvent);
+
+#endif
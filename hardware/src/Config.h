@@ -6,19 +6,159 @@
 // ============================================
 #define WIFI_SSID "FereCasa_IoT"
 #define WIFI_PASSWORD "0042070239"
+#define WIFI_BOOT_TIMEOUT_MS 15000  // Espera inicial; luego sigue en segundo plano
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+#define WIFI_FAST_RECONNECT true    // Reconectar directo al último BSSID/canal
 
 // ============================================
 // CONFIGURACIÓN MQTT
 // ============================================
-#define MQTT_BROKER "192.168.0.105"
+#ifndef MQTT_USE_TLS
+#define MQTT_USE_TLS 0              // 1: TLS (generar certificados con tools/tls_certs.sh)
+#endif
+#if MQTT_USE_TLS
+#define MQTT_PORT 8883
+#else
 #define MQTT_PORT 1883
+#endif
+// Brokers en orden de preferencia: primario y standby (puente al primario,
+// ver backend/mosquitto-standby.conf). Para probar con dos brokers locales:
+// docker compose --profile standby up -d y {"192.168.0.105", 1884} como standby
+#define MQTT_BROKERS {{"192.168.0.105", MQTT_PORT}, {"192.168.0.106", MQTT_PORT}}
+#define MQTT_BROKERS_MAX 4
+#define MQTT_TLS_SERVER_NAME "mqtt.local" // CN/SAN del certificado del broker
+#define TLS_HANDSHAKE_TIMEOUT_MS 10000
 #define DEVICE_ID "room_01"
+#define MQTT_RETRY_INTERVAL_MS 5000
+#define DEDUP_CACHE_SETS 8          // 8 conjuntos x 4 = 32 IDs recientes
+#define DEDUP_TTL_MS 300000         // 5 minutos de ventana de reentrega
+#define MQTT_BUFFER_SIZE 640        // Paquete máximo (comando OTA con URL, hashes y firma)
+#define MQTT_KEEPALIVE_S 15         // Un broker muerto sin cerrar el socket se detecta en ~22 s
+#define MQTT_FAILOVER_RETRY_MS 1000 // Reintento mientras quede algún broker sano
+#define MQTT_BROKER_FAIL_THRESHOLD 2
+#define MQTT_BROKER_FAIL_PENALTY_MS 2000  // Puntaje: latencia + fallos + posición
+#define MQTT_BROKER_PRIORITY_MS 500
+#define MQTT_BROKER_QUARANTINE_MS 30000   // Se duplica por fallo hasta el máximo
+#define MQTT_BROKER_QUARANTINE_MAX_MS 300000
+#define MQTT_FAILBACK_PROBE_MS 20000      // Sondeo TCP del preferido estando en otro
+#define MQTT_FAILBACK_PROBE_TIMEOUT_MS 1000
+#define MQTT_PROBE_TASK_STACK 3072        // Tarea del sondeo (connect() bloqueante)
+#define MQTT_FAILBACK_PROBES 3            // Sondeos exitosos seguidos para volver
+#define MQTT_FAILBACK_MIN_STAY_MS 60000
+// Comandos firmados con HMAC-SHA256 (ver CommandAuth.h). Clave vacía: sin
+// verificación. Con clave y CMD_AUTH_REQUIRED 0 se aceptan comandos sin
+// firma (migración) pero se rechazan las firmas inválidas
+#ifndef CMD_AUTH_KEY
+#define CMD_AUTH_KEY ""             // Misma que MQTT_COMMAND_KEY del backend
+#endif
+#define CMD_AUTH_REQUIRED 1
+#define CMD_AUTH_WINDOW_S 60        // Desfase máximo del timestamp del comando
+#define CMD_AUTH_NONCE_SETS 16      // 16 x 4 = 64 nonces recordados por ventana
+#ifndef CMD_AUTH_BENCHMARK
+#define CMD_AUTH_BENCHMARK 0        // 1: medir la verificación al arrancar
+#endif
+
+// ============================================
+// LÍMITE DE ARRANQUES DE COMPRESOR (FLOTA)
+// ============================================
+// Arranques simultáneos por grupo (ver CompressorBudget.h). El límite lo
+// publica el backend; sin él no hay coordinación
+#define FLEET_GROUP "building_a"    // Equipos que comparten el presupuesto
+#define FLEET_TOPIC "fleet/" FLEET_GROUP "/compressor"
+#define FLEET_LEASES_MAX 32         // Leases ajenos seguidos a la vez
+#define FLEET_DEVICE_ID_MAX 23
+#define FLEET_LEASE_DEFAULT_S 120   // Si el presupuesto no trae lease_s
+#define FLEET_LEASE_MAX_S 900
+#define FLEET_CLAIM_SETTLE_MS 2000  // Espera de pedidos simultáneos (latencia del broker)
+#define FLEET_RETRY_MIN_MS 1000     // Nuevo pedido tras perder, con jitter
+#define FLEET_RETRY_MAX_MS 5000
+#define FLEET_MAX_WAIT_MS 600000    // Arrancar igual tras 10 min en cola
+#define FLEET_OFFLINE_SPREAD_MS 60000 // Sin broker: retraso fijo por equipo (0-60 s)
+
+// ============================================
+// DEMAND RESPONSE (FLOTA)
+// ============================================
+// Señal retained del backend para todo el grupo:
+// {"level": 0-3, "duration_s": S, "start": UTC s, "event_id": "..."}
+#define FLEET_DR_TOPIC "fleet/" FLEET_GROUP "/demand_response"
+#define DR_SETPOINT_OFFSETS {1, 2, 3} // °C por nivel: suma en frío, resta en calor
+#define DR_FAN_CYCLE_PCT {0, 0, 33}   // % de cada período en solo ventilación, por nivel
+#define DR_FAN_CYCLE_PERIOD_S 900
+#define DR_MAX_DURATION_S 14400       // Tope de una señal (4 h)
+
+// ============================================
+// MÉTRICAS
+// ============================================
+#define METRICS_HTTP_PORT 9100      // GET /metrics (OpenMetrics)
+#define METRICS_SNAPSHOT_MAX 2048   // Snapshot MQTT; si no entra no se publica (ver el log)
+#define TASK_STATS_MAX 24           // Tareas FreeRTOS relevadas por heartbeat
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1             // 0 elimina las trazas en compilación
+#endif
+#define TRACE_BUFFER_EVENTS 512     // 16 bytes por evento
+
+// ============================================
+// ENERGÍA
+// ============================================
+#define CPU_FREQ_MIN_MHZ 80         // En reposo; igual a MAX desactiva el escalado
+#define CPU_FREQ_MAX_MHZ 240        // Durante un CpuBoost
+
+// ============================================
+// MEMORIA
+// ============================================
+#define JSON_POOL_SMALL_BYTES 384   // Comandos y publicaciones simples
+#define JSON_POOL_SMALL_COUNT 3     // Comando + estado AC + ack anidados
+#define JSON_POOL_LARGE_BYTES 1024  // Mínimo; crece a calibración y tareas (ver MemoryPool.h)
+#define JSON_POOL_LARGE_COUNT 1
+#define MSG_ARENA_BYTES 1024        // Payload entrante, topics y JSON serializado
+
+// ============================================
+// OTA
+// ============================================
+#define OTA_URL_MAX 160
+#define OTA_HS_WINDOW_BITS 12       // Igual que tools/ota_build.py (4 KB de ventana)
+#define OTA_HS_LOOKAHEAD_BITS 5
+#define OTA_WRITE_BUFFER 4096       // Escrituras a flash de un sector
+#define OTA_TASK_STACK 8192
+#define OTA_HTTP_TIMEOUT_MS 15000
+#define OTA_PROGRESS_BYTES 65536    // Publicar progreso cada 64 KB descargados
+#define OTA_RESTART_DELAY_MS 3000   // Margen para publicar el resultado
+#define OTA_TRIAL_BOOTS 3           // Arranques sin confirmar antes de volver atrás
+#define OTA_CONFIRM_MS 60000        // MQTT conectado este tiempo = imagen sana
+
+// ============================================
+// LOGGING
+// ============================================
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 4                 // 4=debug ... 1=error; -DLOG_LEVEL=2 en producción
+#endif
+#define LOG_QUEUE_LEN 32            // Registros pendientes de escribir
+#define LOG_MAX_ARGS 6
+#define LOG_LINE_MAX 160
+// Copia de los argumentos %s de un registro (compartida entre todos). En
+// debug alcanza para una línea entera (topic + payload de LOG_D); más no
+// se vería. Multiplica LOG_QUEUE_LEN en RAM
+#if LOG_LEVEL >= 4
+#define LOG_STRING_BYTES LOG_LINE_MAX
+#else
+#define LOG_STRING_BYTES 64
+#endif
+#define LOG_TASK_STACK 3072
+#define LOG_RATE_BURST 5            // Mensajes seguidos por punto de llamada
+#define LOG_RATE_INTERVAL_MS 1000   // Recarga de un mensaje por intervalo
+#ifndef LOG_TOKENIZED
+#define LOG_TOKENIZED 0             // 1: logs binarios tokenizados (ver tools/detokenize.py)
+#endif
+#define LOG_REMOTE_BATCH 512        // Bytes de logs tokenizados pendientes para MQTT
+#define LOG_REMOTE_FLUSH_MS 2000
 
 // ============================================
 // PINES HARDWARE
 // ============================================
 #define IR_SEND_PIN 4
 #define DHT_PIN 5
+#define DHT_PINS {DHT_PIN}          // Sensores de la habitación, p. ej. {DHT_PIN, 19, 21}
 #define PIN_RED 16
 #define PIN_GREEN 17
 #define PIN_BLUE 18
@@ -28,13 +168,39 @@
 // ============================================
 #define SAMPLES_FOR_AVERAGE 10
 #define SAMPLE_INTERVAL_MS 30000    // 30 segundos entre mediciones
+#define SAMPLE_INTERVAL_MAX_S 3600  // Tope de sample_interval por /config/update
+#define SAMPLE_ALIGN_TO_UTC true    // Muestrear en múltiplos UTC del intervalo (:00, :30)
+#define SAMPLE_QUEUE_LEN 4          // Muestras pendientes de publicar
+#define OFFLINE_BUFFER_LEN 120      // Mediciones guardadas sin conexión (1 h a 30 s)
+#define OFFLINE_FLUSH_BATCH 8       // Mediciones offline publicadas por loop()
+#define SAMPLING_TASK_STACK 4096
+#define SAMPLING_TASK_PRIORITY 3    // Por encima de loop() (prioridad 1)
+#define SENSOR_MIN_READ_INTERVAL_MS 2000 // El DHT22 no admite lecturas más seguidas
+#define SENSOR_READ_WAIT_MS 3000    // Espera máxima de una lectura a pedido (sin bloquear loop())
 #define HEARTBEAT_INTERVAL_MS 60000 // 1 minuto - heartbeat del sistema
+#define CAL_MAX_POINTS 8            // Puntos por curva de calibración
+#define CAL_LUT_CELLS 128           // Celdas de la tabla compilada (~0.9 °C / 0.8 %HR)
+#define DHT_POWER_PINS {-1}        // GPIO que alimenta cada sensor (-1: sin control)
+#define SENSOR_STUCK_MS 1800000     // Lecturas crudas idénticas durante 30 min = sospecha de congelado
+#define SENSOR_FLATLINE_MS 14400000 // Ventana de línea plana (4 h)
+#define SENSOR_FAULT_MIN_SAMPLES 10 // Lecturas mínimas en la ventana (intervalos largos)
+#define SENSOR_FLATLINE_TEMP_RANGE 0.15f // Rango menor en la ventana = sin variación (1 LSB del DHT22)
+#define SENSOR_FLATLINE_HUM_RANGE 0.25f
+#define SENSOR_RECOVERY_BACKOFF_MIN_MS 30000
+#define SENSOR_RECOVERY_BACKOFF_MAX_MS 1800000
+#define SENSOR_POWER_OFF_MS 1000
+#define SENSOR_POWER_ON_SETTLE_MS 2000 // El DHT22 necesita ~1-2 s antes de la primera lectura
+#define SENSOR_MAX 4                // Sensores fusionables (uno por entrada de DHT_PINS)
+#define FUSION_TEMP_BASE_VAR 0.25f  // Varianza nominal del DHT22 (±0.5 °C)
+#define FUSION_HUM_BASE_VAR 4.0f    // (±2 %HR)
+#define FUSION_RESIDUAL_ALPHA 0.1f  // Peso de la última muestra en las EWMA
+#define FUSION_RESIDUAL_CLAMP 25.0f // Residuo² máximo por muestra, en varianzas base
 
 // ============================================
 // NTP para sincronización de tiempo
 // ============================================
 #define NTP_SERVER "pool.ntp.org"
-#define NTP_OFFSET 0              // UTC
-#define NTP_UPDATE_INTERVAL 60000 // Actualizar cada minuto
+#define NTP_UPDATE_INTERVAL 60000 // Resincronizar SNTP cada minuto
+#define NTP_SYNC_TIMEOUT_MS 5000  // Espera máxima en el arranque
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Heatshrink.h"
+
+// Aplicación de parches binarios estilo bsdiff en streaming.
+// Formato (little endian), generado por tools/ota_build.py:
+//
+//   "BSD1" | largo nuevo (u32)
+//   repetir: diff (u32) | extra (u32) | seek (i32) | diff bytes | extra bytes
+//
+// Cada byte de diff se suma al byte de la imagen base en la posición
+// actual; los extra se copian tal cual; luego la posición base avanza seek.
+// El parche llega una sola vez y en orden: la base se lee a demanda y la
+// salida se entrega a un sink, así que no hace falta tener ninguna de las
+// dos imágenes completas en RAM.
+
+// Lectura de la imagen base (la partición en ejecución)
+typedef bool (*PatchSourceReader)(uint32_t offset, uint8_t *data, size_t len, void *ctx);
+
+class DeltaPatcher
+{
+private:
+  enum State : uint8_t
+  {
+    HEADER,
+    CONTROL,
+    DIFF,
+    EXTRA,
+    DONE,
+    FAILED
+  };
+
+  static const uint32_t MAGIC = 0x31445342; // "BSD1"
+
+  State state;
+  uint8_t field[12]; // Cabecera o control en curso
+  size_t fieldLen;
+
+  uint32_t newSize;
+  uint32_t newPos;
+  uint32_t oldSize;
+  uint32_t oldPos;
+  uint32_t diffLeft;
+  uint32_t extraLeft;
+  int32_t seek;
+
+  uint8_t scratch[256];
+
+  PatchSourceReader reader;
+  ByteSink sink;
+  void *ctx;
+
+  static uint32_t readU32(const uint8_t *p)
+  {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  void nextBlock()
+  {
+    oldPos += seek;
+    state = newPos >= newSize ? DONE : CONTROL;
+  }
+
+  void applyDiff(const uint8_t *data, size_t n)
+  {
+    if (oldPos + n > oldSize || !reader(oldPos, scratch, n, ctx))
+    {
+      state = FAILED;
+      return;
+    }
+    for (size_t i = 0; i < n; i++)
+      scratch[i] += data[i];
+    sink(scratch, n, ctx);
+    oldPos += n;
+    newPos += n;
+  }
+
+public:
+  DeltaPatcher() : reader(nullptr), sink(nullptr), ctx(nullptr) { reset(0, nullptr, nullptr, nullptr); }
+
+  void reset(uint32_t baseSize, PatchSourceReader baseReader, ByteSink outSink, void *outCtx)
+  {
+    state = HEADER;
+    fieldLen = 0;
+    newSize = newPos = 0;
+    oldSize = baseSize;
+    oldPos = 0;
+    diffLeft = extraLeft = 0;
+    seek = 0;
+    reader = baseReader;
+    sink = outSink;
+    ctx = outCtx;
+  }
+
+  void feed(const uint8_t *data, size_t len)
+  {
+    while (len > 0 && state != DONE && state != FAILED)
+    {
+      if (state == HEADER || state == CONTROL)
+      {
+        size_t need = (state == HEADER ? 8 : 12) - fieldLen;
+        size_t n = len < need ? len : need;
+        memcpy(field + fieldLen, data, n);
+        fieldLen += n;
+        data += n;
+        len -= n;
+        if (fieldLen < (state == HEADER ? 8u : 12u))
+          continue;
+        fieldLen = 0;
+
+        if (state == HEADER)
+        {
+          if (readU32(field) != MAGIC)
+          {
+            state = FAILED;
+            continue;
+          }
+          newSize = readU32(field + 4);
+          state = newSize > 0 ? CONTROL : DONE;
+        }
+        else
+        {
+          diffLeft = readU32(field);
+          extraLeft = readU32(field + 4);
+          seek = (int32_t)readU32(field + 8);
+          if (newPos + diffLeft + extraLeft > newSize)
+            state = FAILED;
+          else
+            state = diffLeft > 0 ? DIFF : (extraLeft > 0 ? EXTRA : CONTROL);
+          if (state == CONTROL)
+            nextBlock();
+        }
+      }
+      else if (state == DIFF)
+      {
+        size_t n = len < diffLeft ? len : diffLeft;
+        if (n > sizeof(scratch))
+          n = sizeof(scratch);
+        applyDiff(data, n);
+        data += n;
+        len -= n;
+        diffLeft -= n;
+        if (state == DIFF && diffLeft == 0)
+        {
+          if (extraLeft > 0)
+            state = EXTRA;
+          else
+            nextBlock();
+        }
+      }
+      else if (state == EXTRA)
+      {
+        size_t n = len < extraLeft ? len : extraLeft;
+        sink(data, n, ctx);
+        newPos += n;
+        data += n;
+        len -= n;
+        extraLeft -= n;
+        if (extraLeft == 0)
+          nextBlock();
+      }
+    }
+
+    // Bytes sobrantes después del final: parche corrupto
+    if (len > 0 && state == DONE)
+      state = FAILED;
+  }
+
+  bool isDone() const { return state == DONE; }
+  bool hasFailed() const { return state == FAILED; }
+  uint32_t getNewSize() const { return newSize; }
+};
+
+#endif
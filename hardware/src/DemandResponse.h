@@ -0,0 +1,239 @@
+#ifndef DEMAND_RESPONSE_H
+#define DEMAND_RESPONSE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "AcController.h"
+#include "Events.h"
+
+static const uint32_t DR_REACTION_BUCKETS_MS[] = {10, 50, 100, 500, 1000};
+static Gauge metricDrLevel("dr_level", "Nivel de demand response vigente (0: ninguno)");
+static Counter metricDrEvents("dr_events", "Señales de demand response aplicadas");
+static Histogram<5> metricDrReactionMs("dr_reaction_ms", "Demora entre la señal y el comando IR que la aplica", DR_REACTION_BUCKETS_MS);
+
+// Estado del equipo de aire (pedido por el usuario o enviado)
+struct AcTarget
+{
+  bool on;
+  uint8_t temp;
+  char mode[8];
+  char fan[8];
+
+  void set(bool powerOn, uint8_t temperature, const char *modeStr, const char *fanStr)
+  {
+    on = powerOn;
+    temp = temperature;
+    memset(mode, 0, sizeof(mode));
+    memset(fan, 0, sizeof(fan));
+    strncpy(mode, modeStr, sizeof(mode) - 1);
+    strncpy(fan, fanStr, sizeof(fan) - 1);
+  }
+
+  bool operator==(const AcTarget &other) const
+  {
+    return on == other.on && temp == other.temp && strcmp(mode, other.mode) == 0 && strcmp(fan, other.fan) == 0;
+  }
+};
+
+// Demand response local: una señal por grupo (FLEET_DR_TOPIC) con nivel y
+// duración, y cada equipo aplica su política (DR_SETPOINT_OFFSETS y
+// DR_FAN_CYCLE_PCT por nivel) sobre el estado que pidió el usuario. Los
+// comandos del usuario durante la ventana cambian ese estado y se siguen
+// aplicando con la reducción encima; al vencer la ventana (o con nivel 0)
+// se vuelve al estado pedido. Solo se toca el equipo si está encendido en
+// un modo con compresor.
+// La señal es retained: un equipo que se conecta a mitad de la ventana
+// aplica lo que queda, y una señal ya vencida no hace nada. Sin hora NTP
+// no se puede saber cuánto queda (una señal vieja repetida duraría
+// duration_s enteros), así que se guarda hasta sincronizar.
+// Se usa solo desde loop() (comandos MQTT y señal se procesan ahí).
+class DemandResponse
+{
+private:
+  AcController &ac;
+  AcTarget user; // Pedido por el usuario
+  AcTarget sent; // Último pedido a AcController (enviado o en cola)
+  uint8_t level;
+  uint64_t startMs; // Monotónico, inicio del ciclo de ventilación
+  uint64_t endMs;   // Monotónico
+  uint64_t signalUs; // Señal aún sin aplicar (0: ninguna)
+  char eventId[33];
+
+  // Señal con start recibida antes de sincronizar NTP
+  bool deferred;
+  uint8_t deferredLevel;
+  uint32_t deferredStartUtcS;
+  uint32_t deferredDurationS;
+  char deferredId[33];
+
+  static DemandResponse *instance; // Destino de la señal del grupo
+
+  // Estado efectivo: el del usuario con la política del nivel
+  void effective(AcTarget &out, uint64_t now) const
+  {
+    out = user;
+    if (level == 0 || !out.on || strcmp(out.mode, "fan") == 0)
+      return;
+
+    static const uint8_t offsets[] = DR_SETPOINT_OFFSETS;
+    static const uint8_t fanPct[] = DR_FAN_CYCLE_PCT;
+    size_t index = min((size_t)level, sizeof(offsets)) - 1;
+
+    if (strcmp(out.mode, "heat") == 0)
+      out.temp = (uint8_t)max(17, out.temp - offsets[index]);
+    else
+      out.temp = (uint8_t)min(30, out.temp + offsets[index]);
+
+    // Ciclo de ventilación: la parte sin compresor va primero en cada período
+    uint64_t periodMs = DR_FAN_CYCLE_PERIOD_S * 1000ULL;
+    if ((now - startMs) % periodMs < periodMs * fanPct[index] / 100)
+    {
+      memset(out.mode, 0, sizeof(out.mode));
+      strncpy(out.mode, "fan", sizeof(out.mode) - 1);
+    }
+  }
+
+public:
+  DemandResponse(AcController &controller)
+      : ac(controller), level(0), startMs(0), endMs(0), signalUs(0), deferred(false),
+        deferredLevel(0), deferredStartUtcS(0), deferredDurationS(0)
+  {
+    memset(eventId, 0, sizeof(eventId));
+    memset(deferredId, 0, sizeof(deferredId));
+    instance = this;
+  }
+
+  void begin()
+  {
+    user.set(ac.estaEncendido(), ac.getTemperatura(), ac.getModoStr(), ac.getFanStr());
+    sent = user;
+  }
+
+  // Comando del usuario: se guarda como estado a restaurar y se aplica con
+  // la reducción vigente. Un comando rechazado no cambia nada
+  AcSendResult command(bool powerOn, uint8_t temp, const char *modeStr, const char *fanStr)
+  {
+    AcTarget previous = user;
+    user.set(powerOn, temp, modeStr, fanStr);
+
+    AcTarget target;
+    effective(target, Clock::nowMs());
+    AcSendResult result = ac.solicitar(target.on, target.temp, target.mode, target.fan);
+    if (result == AcSendResult::REJECTED)
+      user = previous;
+    else
+      sent = target;
+    return result;
+  }
+
+  // startUtcS 0: la duración corre desde ahora. Con start y sin hora NTP
+  // se aplica al sincronizar (nivel 0 restaura ya, no hace falta esperar)
+  void signal(uint8_t newLevel, uint32_t startUtcS, uint32_t durationS, const char *id)
+  {
+    if (startUtcS && newLevel && !Clock::isSynced())
+    {
+      LOG_I("⚡ Demand response nivel %u en espera de hora NTP", newLevel);
+      deferred = true;
+      deferredLevel = newLevel;
+      deferredStartUtcS = startUtcS;
+      deferredDurationS = durationS;
+      memset(deferredId, 0, sizeof(deferredId));
+      strncpy(deferredId, id, sizeof(deferredId) - 1);
+      return;
+    }
+    deferred = false;
+
+    durationS = min(durationS, (uint32_t)DR_MAX_DURATION_S);
+    uint64_t remainingMs = durationS * 1000ULL;
+    if (startUtcS)
+    {
+      uint64_t endUtcMs = (startUtcS + (uint64_t)durationS) * 1000;
+      uint64_t utcNow = Clock::utcMs();
+      remainingMs = endUtcMs > utcNow ? endUtcMs - utcNow : 0;
+    }
+    if (remainingMs == 0)
+      newLevel = 0;
+
+    uint64_t now = Clock::nowMs();
+    bool sameEvent = level > 0 && newLevel == level && strncmp(id, eventId, sizeof(eventId) - 1) == 0;
+    if (sameEvent)
+    {
+      endMs = now + remainingMs; // Reentrega del retained: sigue el mismo ciclo
+      return;
+    }
+    if (newLevel == 0 && level == 0)
+      return;
+
+    if (newLevel)
+      LOG_I("⚡ Demand response nivel %u por %u s (%s)", newLevel, (unsigned)(remainingMs / 1000), id);
+    else
+      LOG_I("⚡ Demand response terminado, se restaura el estado pedido");
+
+    level = newLevel;
+    startMs = now;
+    endMs = now + remainingMs;
+    signalUs = Clock::nowUs();
+    memset(eventId, 0, sizeof(eventId));
+    strncpy(eventId, id, sizeof(eventId) - 1);
+    metricDrLevel.set(level);
+    if (level)
+      metricDrEvents.inc();
+  }
+
+  // Llamar en cada loop(). Devuelve true si envió un comando IR, con el
+  // resultado en success
+  bool loop(bool &success)
+  {
+    if (deferred && Clock::isSynced())
+      signal(deferredLevel, deferredStartUtcS, deferredDurationS, deferredId);
+
+    uint64_t now = Clock::nowMs();
+    if (level && now >= endMs)
+    {
+      LOG_I("⚡ Ventana de demand response vencida, se restaura el estado pedido");
+      level = 0;
+      memset(eventId, 0, sizeof(eventId));
+      metricDrLevel.set(0);
+    }
+
+    AcTarget target;
+    effective(target, now);
+    if (target == sent || !ac.puedeEnviar())
+      return false;
+
+    AcSendResult result = ac.solicitar(target.on, target.temp, target.mode, target.fan);
+    if (result == AcSendResult::REJECTED)
+      return false;
+
+    sent = target;
+    if (signalUs)
+    {
+      metricDrReactionMs.observe((uint32_t)((Clock::nowUs() - signalUs) / 1000));
+      signalUs = 0;
+    }
+    success = true;
+    return result == AcSendResult::SENT;
+  }
+
+  uint8_t getLevel() const
+  {
+    return level;
+  }
+
+  // Se aplica en loop(), en esta misma vuelta
+  static bool onSignalEvent(const DemandResponseEvent &event)
+  {
+    if (instance)
+      instance->signal(event.level, event.startUtcS, event.durationS, event.eventId);
+    return true;
+  }
+};
+
+DemandResponse *DemandResponse::instance = nullptr;
+
+EVENT_SUBSCRIBE(DemandResponseEvent, 0, DemandResponse::onSignalEvent);
+
+#endif
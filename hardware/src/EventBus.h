@@ -0,0 +1,58 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+// Bus de eventos resuelto en compilación.
+// Cada tipo de evento tiene EVENT_BUS_SLOTS lugares de suscripción; quien
+// reacciona ocupa uno con EVENT_SUBSCRIBE junto a su handler, en su propio
+// header. publish() se expande a llamadas directas que el compilador puede
+// inlinear (los lugares vacíos desaparecen): sin tablas, sin punteros en
+// RAM y sin heap.
+// Un suscriptor es bool handler(const Evento &); publish() llama a todos en
+// orden de lugar y devuelve el AND de los resultados (true si no hay
+// suscriptores). Dos suscripciones al mismo lugar no compilan.
+// Una suscripción tiene que verse antes del primer publish() del evento:
+// los módulos que reaccionan se incluyen antes que los que publican.
+static const unsigned EVENT_BUS_SLOTS = 8;
+
+// Lugar vacío
+template <typename Event, unsigned Slot>
+struct Subscription
+{
+  static inline bool handle(const Event &) { return true; }
+};
+
+#define EVENT_SUBSCRIBE(EventType, Slot, Handler)                                    \
+  static_assert((Slot) < EVENT_BUS_SLOTS, "Lugar de suscripción fuera de rango");   \
+  template <>                                                                        \
+  struct Subscription<EventType, Slot>                                               \
+  {                                                                                  \
+    static inline bool handle(const EventType &event) { return Handler(event); }     \
+  }
+
+// Recorrido de los lugares en orden: todos corren aunque uno falle
+template <typename Event, unsigned Slot>
+struct SlotChain
+{
+  static inline bool dispatch(const Event &event)
+  {
+    bool ok = Subscription<Event, Slot>::handle(event);
+    return SlotChain<Event, Slot + 1>::dispatch(event) && ok;
+  }
+};
+
+template <typename Event>
+struct SlotChain<Event, EVENT_BUS_SLOTS>
+{
+  static inline bool dispatch(const Event &) { return true; }
+};
+
+namespace EventBus
+{
+  template <typename Event>
+  inline bool publish(const Event &event)
+  {
+    return SlotChain<Event, 0>::dispatch(event);
+  }
+}
+
+#endif
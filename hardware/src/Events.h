@@ -0,0 +1,115 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <Arduino.h>
+#include "EventBus.h"
+#include "Calibration.h"
+#include "SamplingTask.h"
+
+// ============================================
+// EVENTOS
+// ============================================
+// Solo los tipos: cada módulo que reacciona declara su suscripción junto a
+// su handler (EVENT_SUBSCRIBE, ver EventBus.h)
+
+// Resultado de un comando AC en /ac/ack
+enum class AcAckStatus : uint8_t
+{
+  FAILED,
+  APPLIED,
+  QUEUED // Arranque esperando lease; el ack final sale al aplicarse o descartarse
+};
+
+// Comandos recibidos por MQTT (punteros válidos solo durante la publicación)
+struct AcCommandEvent
+{
+  bool turnOn;
+  uint8_t temperature;
+  const char *mode;
+  const char *fanSpeed;
+  const char *commandId; // "" sin ID
+  AcAckStatus *status;   // Lo completa el handler
+};
+
+struct LedCommandEvent
+{
+  uint8_t r, g, b;
+  bool enabled;
+};
+
+struct ConfigUpdateEvent
+{
+  int sampleIntervalS;
+  int avgSamples;
+};
+
+struct CalibrationEvent
+{
+  uint8_t sensor;
+  CalChannel channel;
+  const CalPoint *points;
+  size_t count;
+};
+
+struct SensorReadEvent
+{
+  uint32_t maxAgeMs;
+};
+
+struct OtaCommandEvent
+{
+  const char *url;
+  const char *sha256;
+  const char *format;
+  const char *baseSha256;
+};
+
+// Resultado de un comando AC ya aplicado
+struct AcAppliedEvent
+{
+  bool success;
+};
+
+// Arranque de compresor en cola hasta obtener lease
+struct AcQueuedEvent
+{
+};
+
+// Presupuesto de arranques del grupo (FLEET_TOPIC/budget)
+struct FleetBudgetEvent
+{
+  uint8_t maxStarts; // 0: sin límite
+  uint32_t leaseMs;
+};
+
+// Lease de otro equipo del grupo (FLEET_TOPIC/lease/<device>)
+struct FleetLeaseEvent
+{
+  const char *device;
+  bool present; // false: retained borrado
+  bool held;
+  uint64_t sinceMs;   // UTC
+  uint64_t expiresMs; // UTC
+};
+
+// Señal de demand response del grupo (FLEET_DR_TOPIC)
+struct DemandResponseEvent
+{
+  uint8_t level;      // 0: terminar
+  uint32_t startUtcS; // 0: la duración corre desde ahora
+  uint32_t durationS;
+  const char *eventId;
+};
+
+// Sesión nueva con un broker, antes de suscribirse
+struct MqttConnectedEvent
+{
+};
+
+// Muestra de la tarea de muestreo, entregada en loop()
+struct SampleEvent
+{
+  const SampleResult &sample;
+};
+
+#endif
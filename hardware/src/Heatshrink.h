@@ -0,0 +1,131 @@
+#ifndef HEATSHRINK_H
+#define HEATSHRINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Descompresor heatshrink (LZSS) en streaming, sin memoria dinámica.
+// El flujo es una secuencia de bits MSB primero: un bit de tag 1 seguido de
+// un literal de 8 bits, o un tag 0 seguido de la distancia (WINDOW_BITS) y
+// el largo (LOOKAHEAD_BITS), ambos guardados como valor - 1.
+// Compatible con heatshrink -w WINDOW_BITS -l LOOKAHEAD_BITS y con
+// tools/ota_build.py. No depende de Arduino para poder probarlo en el host.
+
+typedef void (*ByteSink)(const uint8_t *data, size_t len, void *ctx);
+
+template <uint8_t WINDOW_BITS, uint8_t LOOKAHEAD_BITS>
+class HeatshrinkDecoder
+{
+private:
+  static const uint16_t WINDOW_SIZE = 1 << WINDOW_BITS;
+
+  enum State : uint8_t
+  {
+    TAG,
+    LITERAL,
+    INDEX,
+    COUNT
+  };
+
+  uint8_t window[WINDOW_SIZE];
+  uint16_t head;
+
+  uint32_t bits;
+  uint8_t bitCount;
+  State state;
+  uint16_t index;
+
+  uint8_t out[256];
+  size_t outLen;
+  size_t produced;
+
+  ByteSink sink;
+  void *ctx;
+
+  uint16_t take(uint8_t n)
+  {
+    bitCount -= n;
+    return (bits >> bitCount) & ((1u << n) - 1);
+  }
+
+  void emit(uint8_t c)
+  {
+    window[head++ & (WINDOW_SIZE - 1)] = c;
+    out[outLen++] = c;
+    produced++;
+    if (outLen == sizeof(out))
+      flush();
+  }
+
+  void flush()
+  {
+    if (outLen > 0)
+    {
+      sink(out, outLen, ctx);
+      outLen = 0;
+    }
+  }
+
+public:
+  HeatshrinkDecoder() : sink(nullptr), ctx(nullptr) { reset(nullptr, nullptr); }
+
+  void reset(ByteSink outSink, void *outCtx)
+  {
+    memset(window, 0, sizeof(window));
+    head = 0;
+    bits = 0;
+    bitCount = 0;
+    state = TAG;
+    index = 0;
+    outLen = 0;
+    produced = 0;
+    sink = outSink;
+    ctx = outCtx;
+  }
+
+  void feed(const uint8_t *data, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+    {
+      bits = (bits << 8) | data[i];
+      bitCount += 8;
+
+      // Consumir todos los campos completos disponibles
+      for (;;)
+      {
+        if (state == TAG && bitCount >= 1)
+        {
+          state = take(1) ? LITERAL : INDEX;
+        }
+        else if (state == LITERAL && bitCount >= 8)
+        {
+          emit((uint8_t)take(8));
+          state = TAG;
+        }
+        else if (state == INDEX && bitCount >= WINDOW_BITS)
+        {
+          index = take(WINDOW_BITS) + 1;
+          state = COUNT;
+        }
+        else if (state == COUNT && bitCount >= LOOKAHEAD_BITS)
+        {
+          uint16_t count = take(LOOKAHEAD_BITS) + 1;
+          for (uint16_t n = 0; n < count; n++)
+            emit(window[(uint16_t)(head - index) & (WINDOW_SIZE - 1)]);
+          state = TAG;
+        }
+        else
+        {
+          break;
+        }
+      }
+    }
+    flush();
+  }
+
+  // Bytes descomprimidos desde reset()
+  size_t getProduced() const { return produced; }
+};
+
+#endif
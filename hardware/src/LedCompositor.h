@@ -0,0 +1,204 @@
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Clock.h"
+#include "RgbLed.h"
+#include "Events.h"
+
+// Capas de estado, de menor a mayor prioridad
+enum class LedLayer : uint8_t
+{
+  USER,         // Color elegido por el usuario (/led/command)
+  SENSOR_ERROR, // Sensores caídos
+  COMMAND,      // Confirmación de comandos AC
+  BOOT,         // Señal de arranque
+  COUNT
+};
+
+// Compositor del LED: cada subsistema publica su capa (color, opacidad,
+// parpadeo y vencimiento) y el LED muestra la mezcla, de la capa de menor
+// prioridad a la de mayor. Un parpadeo en su fase apagada es transparente,
+// así que se ve la capa de abajo y el color del usuario vuelve solo cuando
+// vencen las demás.
+// update() no hace nada hasta que una capa cambia o llega el próximo
+// cambio de fase o vencimiento; RgbLed escribe solo los canales distintos.
+// Se usa solo desde loop() (comandos MQTT y muestras se procesan ahí).
+class LedCompositor
+{
+private:
+  struct Layer
+  {
+    bool active;
+    uint8_t r, g, b;
+    uint8_t alpha;
+    uint16_t halfPeriodMs; // 0: fijo
+    uint64_t startMs;
+    uint64_t expiresMs;    // 0: sin vencimiento
+  };
+
+  RgbLed &led;
+  Layer layers[(size_t)LedLayer::COUNT];
+  bool enabled;
+  bool dirty;
+  uint64_t nextChangeMs;
+
+  static LedCompositor *instance; // Destino de la realimentación por eventos
+
+  static uint8_t mix(uint8_t below, uint8_t above, uint8_t alpha)
+  {
+    return (uint8_t)((below * (255 - alpha) + above * alpha + 127) / 255);
+  }
+
+  static bool visible(const Layer &layer, uint64_t now)
+  {
+    return layer.halfPeriodMs == 0 || ((now - layer.startMs) / layer.halfPeriodMs) % 2 == 0;
+  }
+
+  Layer &at(LedLayer layer)
+  {
+    return layers[(size_t)layer];
+  }
+
+public:
+  LedCompositor(RgbLed &output)
+      : led(output), enabled(true), dirty(true), nextChangeMs(0)
+  {
+    memset(layers, 0, sizeof(layers));
+    instance = this;
+  }
+
+  void begin()
+  {
+    led.begin();
+  }
+
+  // Color fijo; ttlMs 0 lo deja hasta clear()
+  void show(LedLayer layer, uint8_t r, uint8_t g, uint8_t b, uint32_t ttlMs = 0, uint8_t alpha = 255)
+  {
+    uint64_t now = Clock::nowMs();
+    at(layer) = {true, r, g, b, alpha, 0, now, ttlMs ? now + ttlMs : 0};
+    dirty = true;
+  }
+
+  // times parpadeos de delayMs encendido y delayMs transparente
+  void blink(LedLayer layer, uint8_t r, uint8_t g, uint8_t b, uint8_t times = 3, uint16_t delayMs = 200)
+  {
+    uint64_t now = Clock::nowMs();
+    at(layer) = {true, r, g, b, 255, delayMs, now, now + (uint64_t)times * 2 * delayMs};
+    dirty = true;
+  }
+
+  void clear(LedLayer layer)
+  {
+    if (!at(layer).active)
+      return;
+    at(layer).active = false;
+    dirty = true;
+  }
+
+  bool isActive(LedLayer layer)
+  {
+    return at(layer).active;
+  }
+
+  // Deshabilitado el LED queda apagado; las capas siguen vigentes
+  void setEnabled(bool value)
+  {
+    if (enabled == value)
+      return;
+    enabled = value;
+    dirty = true;
+  }
+
+  bool isEnabled() const
+  {
+    return enabled;
+  }
+
+  // Color de una capa (p. ej. el del usuario para /led/status)
+  void getColor(LedLayer layer, uint8_t &r, uint8_t &g, uint8_t &b) const
+  {
+    const Layer &l = layers[(size_t)layer];
+    r = l.r;
+    g = l.g;
+    b = l.b;
+  }
+
+  void update()
+  {
+    uint64_t now = Clock::nowMs();
+    if (!dirty && now < nextChangeMs)
+      return;
+
+    uint8_t r = 0, g = 0, b = 0;
+    uint64_t next = UINT64_MAX;
+    for (Layer &layer : layers)
+    {
+      if (layer.active && layer.expiresMs && now >= layer.expiresMs)
+        layer.active = false;
+      if (!layer.active)
+        continue;
+
+      if (layer.expiresMs)
+        next = min(next, layer.expiresMs);
+      if (layer.halfPeriodMs)
+        next = min(next, layer.startMs + ((now - layer.startMs) / layer.halfPeriodMs + 1) * layer.halfPeriodMs);
+
+      if (visible(layer, now))
+      {
+        r = mix(r, layer.r, layer.alpha);
+        g = mix(g, layer.g, layer.alpha);
+        b = mix(b, layer.b, layer.alpha);
+      }
+    }
+
+    if (!enabled)
+      r = g = b = 0;
+    led.setColor(r, g, b);
+    nextChangeMs = next;
+    dirty = false;
+  }
+
+  // Realimentación de comandos y muestras
+  static bool onAcAppliedEvent(const AcAppliedEvent &event)
+  {
+    if (!instance)
+      return true;
+    // Verde si se aplicó, rojo si falló
+    if (event.success)
+      instance->blink(LedLayer::COMMAND, 0, 255, 0, 2, 150);
+    else
+      instance->blink(LedLayer::COMMAND, 255, 0, 0, 3, 100);
+    return true;
+  }
+
+  static bool onAcQueuedEvent(const AcQueuedEvent &)
+  {
+    // Ámbar mientras el arranque espera lease; lo reemplaza la confirmación
+    if (instance)
+      instance->show(LedLayer::COMMAND, 255, 120, 0, FLEET_MAX_WAIT_MS);
+    return true;
+  }
+
+  static bool onSampleEvent(const SampleEvent &event)
+  {
+    if (!instance)
+      return true;
+    // Error en lectura - LED rojo hasta la próxima lectura válida
+    if (!event.sample.ok && event.sample.sensorError)
+      instance->show(LedLayer::SENSOR_ERROR, 255, 0, 0);
+    else if (event.sample.ok)
+      instance->clear(LedLayer::SENSOR_ERROR);
+    return true;
+  }
+};
+
+LedCompositor *LedCompositor::instance = nullptr;
+
+EVENT_SUBSCRIBE(AcAppliedEvent, 0, LedCompositor::onAcAppliedEvent);
+EVENT_SUBSCRIBE(AcQueuedEvent, 0, LedCompositor::onAcQueuedEvent);
+EVENT_SUBSCRIBE(SampleEvent, 2, LedCompositor::onSampleEvent);
+
+#endif
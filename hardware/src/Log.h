@@ -0,0 +1,519 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include "Config.h"
+#include "Clock.h"
+
+// Logging diferido.
+// Las macros LOG_E/W/I/D no formatean ni tocan la UART: copian el puntero
+// al formato y los argumentos (con su tipo) en un registro que va a una cola.
+// Una tarea de baja prioridad los formatea y escribe por Serial.
+// Niveles por encima de LOG_LEVEL se eliminan en compilación, y cada punto
+// de llamada tiene su propio limitador de tasa.
+//
+// Con LOG_TOKENIZED el formato no llega al binario: se reemplaza en
+// compilación por su hash FNV-1a de 32 bits y cada registro sale como
+// token + argumentos en varint ("$" + base64 por Serial, binario por MQTT).
+// tools/log_tokens.py arma la base de strings en cada build y
+// tools/detokenize.py la usa para reconstruir los mensajes.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#ifndef LOG_TOKENIZED
+#define LOG_TOKENIZED 0
+#endif
+
+// Token de un formato: FNV-1a de 32 bits sobre los bytes del literal.
+// Debe coincidir con tools/log_tokens.py.
+constexpr uint32_t logToken(const char *s, uint32_t h = 2166136261u)
+{
+  return *s ? logToken(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+enum class LogArgType : uint8_t
+{
+  INT,
+  UINT,
+  U64,   // Ocupa dos valores
+  FLOAT,
+  STR    // Offset dentro de LogRecord::strings
+};
+
+struct LogRecord
+{
+  uint32_t timestampMs;
+  const char *fmt;     // nullptr en modo tokenizado
+  uint32_t token;
+  uint8_t level;
+  uint8_t nargs;
+  uint16_t suppressed; // Mensajes descartados por el limitador antes de este
+  LogArgType types[LOG_MAX_ARGS];
+  uint32_t values[LOG_MAX_ARGS];
+  char strings[LOG_STRING_BYTES];
+};
+
+// Token bucket por punto de llamada
+class LogRateLimiter
+{
+private:
+  uint32_t lastRefillMs;
+  uint8_t tokens;
+  uint16_t suppressed;
+
+public:
+  LogRateLimiter() : lastRefillMs(0), tokens(LOG_RATE_BURST), suppressed(0) {}
+
+  // Devuelve true si se puede emitir; en ese caso dropped recibe cuántos se descartaron
+  bool allow(uint32_t nowMs, uint16_t &dropped)
+  {
+    uint32_t refill = (nowMs - lastRefillMs) / LOG_RATE_INTERVAL_MS;
+    if (refill > 0)
+    {
+      tokens = min<uint32_t>(LOG_RATE_BURST, tokens + refill);
+      lastRefillMs = nowMs;
+    }
+
+    if (tokens == 0)
+    {
+      if (suppressed < UINT16_MAX)
+        suppressed++;
+      return false;
+    }
+
+    tokens--;
+    dropped = suppressed;
+    suppressed = 0;
+    return true;
+  }
+};
+
+class Log
+{
+private:
+  static QueueHandle_t queue;
+  static uint32_t droppedFull;
+
+  // ---- Captura de argumentos ----
+  struct Packer
+  {
+    LogRecord &r;
+    size_t strPos;
+
+    void add(LogArgType type, uint32_t value)
+    {
+      if (r.nargs < LOG_MAX_ARGS)
+      {
+        r.types[r.nargs] = type;
+        r.values[r.nargs] = value;
+        r.nargs++;
+      }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && (sizeof(T) <= 4)>::type
+    pack(T v)
+    {
+      add(std::is_signed<T>::value ? LogArgType::INT : LogArgType::UINT, (uint32_t)v);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 4)>::type
+    pack(T v)
+    {
+      if (r.nargs + 2 > LOG_MAX_ARGS)
+        return;
+      add(LogArgType::U64, (uint32_t)((uint64_t)v >> 32));
+      add(LogArgType::U64, (uint32_t)v);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    pack(T v)
+    {
+      float f = (float)v;
+      uint32_t bits;
+      memcpy(&bits, &f, sizeof(bits));
+      add(LogArgType::FLOAT, bits);
+    }
+
+    // Un string que no entra se corta con "~" al final, para que se note
+    void pack(const char *s)
+    {
+      if (!s)
+        s = "(null)";
+      size_t room = sizeof(r.strings) - strPos;
+      size_t full = strlen(s);
+      size_t len = min(full, room > 0 ? room - 1 : 0);
+      if (room > 0)
+      {
+        memcpy(r.strings + strPos, s, len);
+        if (len < full && len > 0)
+          r.strings[strPos + len - 1] = '~';
+        r.strings[strPos + len] = '\0';
+      }
+      add(LogArgType::STR, (uint32_t)strPos);
+      strPos = min(strPos + len + 1, sizeof(r.strings));
+    }
+
+    void pack(char *s) { pack((const char *)s); }
+    void pack(const String &s) { pack(s.c_str()); }
+
+    void packAll() {}
+
+    template <typename T, typename... Rest>
+    void packAll(const T &first, const Rest &...rest)
+    {
+      pack(first);
+      packAll(rest...);
+    }
+  };
+
+  // ---- Formateo diferido (en la tarea de logging) ----
+
+  // Reescribe una conversión de printf con el modificador de largo del tipo guardado
+  static int formatArg(char *out, size_t size, const char *spec, size_t specLen,
+                       const LogRecord &r, uint8_t &arg)
+  {
+    char conv = spec[specLen - 1];
+    char fmt[16];
+    size_t n = 0;
+    for (size_t i = 0; i < specLen - 1 && n < sizeof(fmt) - 4; i++)
+    {
+      char c = spec[i];
+      if (c != 'l' && c != 'h' && c != 'z' && c != 'j' && c != 't' && c != 'L')
+        fmt[n++] = c;
+    }
+
+    if (arg >= r.nargs)
+      return snprintf(out, size, "?");
+
+    LogArgType type = r.types[arg];
+    if (type == LogArgType::U64)
+    {
+      fmt[n++] = 'l';
+      fmt[n++] = 'l';
+    }
+    fmt[n++] = conv;
+    fmt[n] = '\0';
+
+    uint32_t v = r.values[arg++];
+    switch (type)
+    {
+    case LogArgType::INT:
+      return snprintf(out, size, fmt, (int)v);
+    case LogArgType::UINT:
+      return snprintf(out, size, fmt, (unsigned)v);
+    case LogArgType::U64:
+    {
+      uint64_t wide = ((uint64_t)v << 32) | (arg < r.nargs ? r.values[arg++] : 0);
+      return snprintf(out, size, fmt, (unsigned long long)wide);
+    }
+    case LogArgType::FLOAT:
+    {
+      float f;
+      memcpy(&f, &v, sizeof(f));
+      return snprintf(out, size, fmt, (double)f);
+    }
+    case LogArgType::STR:
+      return snprintf(out, size, fmt, r.strings + v);
+    }
+    return 0;
+  }
+
+  static size_t format(const LogRecord &r, char *out, size_t size)
+  {
+    static const char levelChars[] = "-EWID";
+    size_t pos = snprintf(out, size, "[%6u.%03u] %c ",
+                          (unsigned)(r.timestampMs / 1000), (unsigned)(r.timestampMs % 1000),
+                          levelChars[r.level]);
+
+    uint8_t arg = 0;
+    const char *p = r.fmt;
+    while (*p && pos < size - 1)
+    {
+      if (*p != '%')
+      {
+        out[pos++] = *p++;
+        continue;
+      }
+      if (p[1] == '%')
+      {
+        out[pos++] = '%';
+        p += 2;
+        continue;
+      }
+
+      // Buscar el carácter de conversión
+      const char *start = p++;
+      while (*p && !strchr("diouxXeEfFgGcsp", *p))
+        p++;
+      if (!*p)
+        break;
+      p++;
+
+      int written = formatArg(out + pos, size - pos, start, p - start, r, arg);
+      if (written > 0)
+        pos = min(pos + written, size - 1);
+    }
+
+    if (r.suppressed > 0 && pos < size - 1)
+      pos += snprintf(out + pos, size - pos, " (+%u suprimidos)", (unsigned)r.suppressed);
+    pos = min(pos, size - 2);
+    out[pos++] = '\n';
+    out[pos] = '\0';
+    return pos;
+  }
+
+#if LOG_TOKENIZED
+  // ---- Codificación binaria (modo tokenizado) ----
+  static uint8_t remoteBatch[LOG_REMOTE_BATCH];
+  static size_t remoteLen;
+  static portMUX_TYPE remoteMux;
+
+  static size_t putVarint(uint8_t *out, size_t pos, size_t size, uint64_t v)
+  {
+    while (pos < size)
+    {
+      uint8_t b = v & 0x7F;
+      v >>= 7;
+      out[pos++] = v ? (b | 0x80) : b;
+      if (!v)
+        break;
+    }
+    return pos;
+  }
+
+  // token(4, LE) | varint ts | varint suprimidos | argumentos
+  // Enteros de 32 bits en zigzag, 64 bits en varint, float en 4 bytes LE,
+  // strings con largo varint. El host deduce los tipos del formato.
+  static size_t encode(const LogRecord &r, uint8_t *out, size_t size)
+  {
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++)
+      out[pos++] = (r.token >> (8 * i)) & 0xFF;
+    pos = putVarint(out, pos, size, r.timestampMs);
+    pos = putVarint(out, pos, size, r.suppressed);
+
+    for (uint8_t i = 0; i < r.nargs && pos < size; i++)
+    {
+      uint32_t v = r.values[i];
+      switch (r.types[i])
+      {
+      case LogArgType::INT:
+      case LogArgType::UINT:
+      {
+        int32_t s = (int32_t)v;
+        pos = putVarint(out, pos, size, (uint32_t)((s << 1) ^ (s >> 31)));
+        break;
+      }
+      case LogArgType::U64:
+      {
+        uint64_t wide = ((uint64_t)v << 32) | (i + 1 < r.nargs ? r.values[++i] : 0);
+        pos = putVarint(out, pos, size, wide);
+        break;
+      }
+      case LogArgType::FLOAT:
+        for (int b = 0; b < 4 && pos < size; b++)
+          out[pos++] = (v >> (8 * b)) & 0xFF;
+        break;
+      case LogArgType::STR:
+      {
+        const char *s = r.strings + v;
+        size_t len = min(strlen(s), size - pos > 1 ? size - pos - 1 : 0);
+        pos = putVarint(out, pos, size, len);
+        memcpy(out + pos, s, len);
+        pos += len;
+        break;
+      }
+      }
+    }
+    return min(pos, size);
+  }
+
+  static size_t base64(const uint8_t *in, size_t len, char *out, size_t size)
+  {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t pos = 0;
+    for (size_t i = 0; i < len && pos + 4 < size; i += 3)
+    {
+      uint32_t chunk = in[i] << 16;
+      if (i + 1 < len)
+        chunk |= in[i + 1] << 8;
+      if (i + 2 < len)
+        chunk |= in[i + 2];
+      out[pos++] = table[(chunk >> 18) & 0x3F];
+      out[pos++] = table[(chunk >> 12) & 0x3F];
+      out[pos++] = i + 1 < len ? table[(chunk >> 6) & 0x3F] : '=';
+      out[pos++] = i + 2 < len ? table[chunk & 0x3F] : '=';
+    }
+    return pos;
+  }
+
+  // Encolar para MQTT: varint largo + registro; si no entra, se descarta
+  static void appendRemote(const uint8_t *data, size_t len)
+  {
+    uint8_t header[5];
+    size_t headerLen = putVarint(header, 0, sizeof(header), len);
+
+    portENTER_CRITICAL(&remoteMux);
+    if (remoteLen + headerLen + len <= sizeof(remoteBatch))
+    {
+      memcpy(remoteBatch + remoteLen, header, headerLen);
+      memcpy(remoteBatch + remoteLen + headerLen, data, len);
+      remoteLen += headerLen + len;
+    }
+    else
+    {
+      droppedFull++;
+    }
+    portEXIT_CRITICAL(&remoteMux);
+  }
+
+  static void emit(const LogRecord &r)
+  {
+    uint8_t bin[LOG_LINE_MAX / 2];
+    char line[LOG_LINE_MAX];
+    size_t binLen = encode(r, bin, sizeof(bin));
+
+    line[0] = '$';
+    size_t len = 1 + base64(bin, binLen, line + 1, sizeof(line) - 2);
+    line[len++] = '\n';
+    Serial.write((const uint8_t *)line, len);
+
+    appendRemote(bin, binLen);
+  }
+#else
+  static void emit(const LogRecord &r)
+  {
+    char line[LOG_LINE_MAX];
+    size_t len = format(r, line, sizeof(line));
+    Serial.write((const uint8_t *)line, len);
+  }
+#endif
+
+  static void taskEntry(void *)
+  {
+    LogRecord r;
+    for (;;)
+    {
+      if (xQueueReceive(queue, &r, portMAX_DELAY) == pdTRUE)
+        emit(r);
+    }
+  }
+
+public:
+  static void begin()
+  {
+    queue = xQueueCreate(LOG_QUEUE_LEN, sizeof(LogRecord));
+    xTaskCreatePinnedToCore(taskEntry, "log", LOG_TASK_STACK, nullptr,
+                            tskIDLE_PRIORITY + 1, nullptr, 0);
+  }
+
+  template <typename... Args>
+  static void write(uint8_t level, uint16_t suppressed, uint32_t token, const char *fmt,
+                    const Args &...args)
+  {
+    if (!queue)
+      return;
+
+    LogRecord r;
+    r.timestampMs = (uint32_t)Clock::nowMs();
+    r.fmt = fmt;
+    r.token = token;
+    r.level = level;
+    r.nargs = 0;
+    r.suppressed = suppressed;
+
+    Packer packer = {r, 0};
+    packer.packAll(args...);
+
+    if (xQueueSend(queue, &r, 0) != pdTRUE)
+      droppedFull++;
+  }
+
+  static uint32_t getDropped() { return droppedFull; }
+
+#if LOG_TOKENIZED
+  // Retirar los registros codificados pendientes para publicarlos por MQTT
+  static size_t takeRemoteBatch(uint8_t *out, size_t size)
+  {
+    portENTER_CRITICAL(&remoteMux);
+    size_t len = remoteLen <= size ? remoteLen : 0;
+    memcpy(out, remoteBatch, len);
+    remoteLen -= len;
+    portEXIT_CRITICAL(&remoteMux);
+    return len;
+  }
+#endif
+};
+
+// Inicializar miembros estáticos
+QueueHandle_t Log::queue = nullptr;
+uint32_t Log::droppedFull = 0;
+#if LOG_TOKENIZED
+uint8_t Log::remoteBatch[LOG_REMOTE_BATCH];
+size_t Log::remoteLen = 0;
+portMUX_TYPE Log::remoteMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+// En modo tokenizado el literal solo se usa en compilación (integral_constant),
+// así que no ocupa flash
+#if LOG_TOKENIZED
+#define LOG_FORMAT_ARGS(fmt) std::integral_constant<uint32_t, logToken(fmt)>::value, nullptr
+#else
+#define LOG_FORMAT_ARGS(fmt) 0, fmt
+#endif
+
+#define LOG_AT(level, fmt, ...)                                           \
+  do                                                                      \
+  {                                                                       \
+    static LogRateLimiter logLimiter_;                                    \
+    uint16_t logDropped_ = 0;                                             \
+    if (logLimiter_.allow((uint32_t)Clock::nowMs(), logDropped_))         \
+      Log::write(level, logDropped_, LOG_FORMAT_ARGS(fmt), ##__VA_ARGS__); \
+  } while (0)
+
+// Nivel desactivado: no genera código, pero los argumentos siguen
+// "usados" (sin avisos de variables que solo se loguean)
+#define LOG_DISCARD(fmt, ...)                                        \
+  do                                                                 \
+  {                                                                  \
+    if (false)                                                       \
+      Log::write(0, 0, LOG_FORMAT_ARGS(fmt), ##__VA_ARGS__);         \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Config.h"
+#include "Metrics.h"
+#include "Log.h"
+
+// Plan de memoria estático para mensajes.
+// Los documentos JSON salen de pools de bloques fijos y los bytes de cada
+// mensaje (payload, topics, JSON serializado) de una arena que se rebobina
+// al terminar de procesarlo. Todo está en .bss: el uso de heap y de stack
+// no depende del tráfico y no hay fragmentación con el paso de los meses.
+
+static Counter metricPoolExhausted("mem_pool_exhausted", "Pedidos rechazados por pool o arena llena");
+
+// Base común: uso, pico y rechazos, enlazados para el reporte de arranque
+class MemoryPool
+{
+private:
+  static MemoryPool *head;
+  MemoryPool *next;
+
+protected:
+  const char *name;
+  size_t unitBytes; // Tamaño de bloque (1 para arenas)
+  size_t units;
+  size_t used;
+  size_t peak;
+  uint32_t failures;
+
+  void track(size_t nowUsed)
+  {
+    used = nowUsed;
+    if (used > peak)
+      peak = used;
+  }
+
+  void fail(size_t requested)
+  {
+    failures++;
+    metricPoolExhausted.inc();
+    LOG_W("⚠️ Pool %s lleno (pedido %u bytes)", name, requested);
+  }
+
+public:
+  MemoryPool(const char *name, size_t unitBytes, size_t units)
+      : next(head), name(name), unitBytes(unitBytes), units(units), used(0), peak(0), failures(0)
+  {
+    head = this;
+  }
+
+  size_t getUsed() const { return used; }
+  size_t getPeak() const { return peak; }
+  uint32_t getFailures() const { return failures; }
+
+  // Dimensionamiento y pico de cada pool desde el arranque
+  static void report()
+  {
+    LOG_I("🧠 Plan de memoria estático:");
+    for (MemoryPool *p = head; p; p = p->next)
+    {
+      LOG_I("   %s: pico %u/%u x %u B, rechazos %u",
+            p->name, p->peak, p->units, p->unitBytes, p->failures);
+    }
+  }
+};
+
+MemoryPool *MemoryPool::head = nullptr;
+
+// Pool de COUNT bloques de BLOCK bytes con lista libre intrusiva.
+// acquire/release son O(1) y seguros entre tareas.
+template <size_t BLOCK, size_t COUNT>
+class BlockPool : public MemoryPool
+{
+private:
+  // Tamaño redondeado para que cada bloque quede alineado a 8
+  static const size_t STRIDE = (BLOCK + 7) & ~(size_t)7;
+
+  alignas(8) uint8_t storage[STRIDE * COUNT];
+  void *freeList;
+  portMUX_TYPE mux;
+
+public:
+  BlockPool(const char *name) : MemoryPool(name, BLOCK, COUNT), freeList(nullptr)
+  {
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    for (size_t i = COUNT; i-- > 0;)
+    {
+      void *block = storage + i * STRIDE;
+      *(void **)block = freeList;
+      freeList = block;
+    }
+  }
+
+  void *acquire()
+  {
+    portENTER_CRITICAL(&mux);
+    void *block = freeList;
+    if (block)
+    {
+      freeList = *(void **)block;
+      track(used + 1);
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (!block)
+      fail(BLOCK);
+    return block;
+  }
+
+  void release(void *block)
+  {
+    if (!block)
+      return;
+    portENTER_CRITICAL(&mux);
+    *(void **)block = freeList;
+    freeList = block;
+    used--;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  bool owns(const void *p) const
+  {
+    return p >= storage && p < storage + sizeof(storage);
+  }
+};
+
+// Arena de asignación lineal. Sin locks: la usa una sola tarea.
+// Se libera en bloque rebobinando a una marca (ver ArenaScope).
+class Arena : public MemoryPool
+{
+private:
+  uint8_t *storage;
+  size_t top;
+
+public:
+  Arena(const char *name, uint8_t *storage, size_t capacity)
+      : MemoryPool(name, 1, capacity), storage(storage), top(0) {}
+
+  void *alloc(size_t size, size_t align = 4)
+  {
+    size_t start = (top + align - 1) & ~(align - 1);
+    if (start + size > units)
+    {
+      fail(size);
+      return nullptr;
+    }
+    top = start + size;
+    track(top);
+    return storage + start;
+  }
+
+  // Copia terminada en '\0'
+  char *copy(const char *data, size_t len)
+  {
+    char *out = (char *)alloc(len + 1, 1);
+    if (out)
+    {
+      memcpy(out, data, len);
+      out[len] = '\0';
+    }
+    return out;
+  }
+
+  // a + b, para armar topics sin String temporales
+  char *concat(const char *a, const char *b)
+  {
+    size_t lenA = strlen(a);
+    size_t lenB = strlen(b);
+    char *out = (char *)alloc(lenA + lenB + 1, 1);
+    if (out)
+    {
+      memcpy(out, a, lenA);
+      memcpy(out + lenA, b, lenB + 1);
+    }
+    return out;
+  }
+
+  size_t mark() const { return top; }
+
+  void rewind(size_t m)
+  {
+    top = m;
+    track(top);
+  }
+};
+
+template <size_t BYTES>
+class StaticArena : public Arena
+{
+private:
+  alignas(8) uint8_t data[BYTES];
+
+public:
+  StaticArena(const char *name) : Arena(name, data, BYTES) {}
+};
+
+// Todo lo asignado dentro del bloque se libera al salir
+class ArenaScope
+{
+private:
+  Arena &arena;
+  size_t saved;
+
+public:
+  ArenaScope(Arena &arena) : arena(arena), saved(arena.mark()) {}
+  ~ArenaScope() { arena.rewind(saved); }
+};
+
+// ============================================
+// DOCUMENTOS JSON
+// ============================================
+// Capacidad de los documentos grandes según el tamaño de slot de la
+// plataforma (16 B en el ESP32, el doble en el banco de 64 bits). El bloque
+// grande alcanza para el mayor de ellos.
+// Calibración completa: sensor, dos canales, timestamp, nonce y firma, con
+// CAL_MAX_POINTS pares por canal (payload sin copiar: sin strings)
+static const size_t JSON_CALIBRATION_CAPACITY =
+    JSON_OBJECT_SIZE(6) + 2 * JSON_ARRAY_SIZE(CAL_MAX_POINTS) + 2 * CAL_MAX_POINTS * JSON_ARRAY_SIZE(2);
+// Estadísticas de tareas: idle_pct, tasks, tasks_total y truncated, con
+// TASK_STATS_MAX objetos de 4 campos (nombres por puntero)
+static const size_t JSON_TASK_STATS_CAPACITY =
+    JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(TASK_STATS_MAX) + TASK_STATS_MAX * JSON_OBJECT_SIZE(4);
+static const size_t JSON_LARGE_DOC_BYTES =
+    JSON_CALIBRATION_CAPACITY > JSON_TASK_STATS_CAPACITY ? JSON_CALIBRATION_CAPACITY : JSON_TASK_STATS_CAPACITY;
+static const size_t JSON_LARGE_BLOCK_BYTES =
+    JSON_LARGE_DOC_BYTES > JSON_POOL_LARGE_BYTES ? JSON_LARGE_DOC_BYTES : JSON_POOL_LARGE_BYTES;
+
+static BlockPool<JSON_POOL_SMALL_BYTES, JSON_POOL_SMALL_COUNT> jsonSmallPool("json_small");
+static BlockPool<JSON_LARGE_BLOCK_BYTES, JSON_POOL_LARGE_COUNT> jsonLargePool("json_large");
+
+// Allocator de ArduinoJson sobre los pools: la capacidad del documento
+// elige el tamaño de bloque. Si no hay bloque el documento queda con
+// capacidad 0 y deserializeJson devuelve NoMemory.
+struct JsonPoolAllocator
+{
+  void *allocate(size_t size)
+  {
+    if (size <= JSON_POOL_SMALL_BYTES)
+      return jsonSmallPool.acquire();
+    if (size <= JSON_LARGE_BLOCK_BYTES)
+      return jsonLargePool.acquire();
+    return nullptr;
+  }
+
+  void deallocate(void *p)
+  {
+    if (jsonSmallPool.owns(p))
+      jsonSmallPool.release(p);
+    else
+      jsonLargePool.release(p);
+  }
+
+  // Solo se puede achicar dentro del mismo bloque
+  void *reallocate(void *p, size_t size)
+  {
+    size_t capacity = jsonSmallPool.owns(p) ? JSON_POOL_SMALL_BYTES : JSON_LARGE_BLOCK_BYTES;
+    return size <= capacity ? p : nullptr;
+  }
+};
+
+typedef BasicJsonDocument<JsonPoolAllocator> PooledJsonDocument;
+
+#endif
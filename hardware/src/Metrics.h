@@ -0,0 +1,224 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <atomic>
+
+// Registro estático de métricas.
+// Cada módulo declara sus métricas como objetos globales; el constructor las
+// enlaza en una lista intrusiva, sin memoria dinámica. Actualizar una métrica
+// es una operación atómica relajada (unos pocos ciclos).
+//
+//   static Counter irSends("ac_ir_sends", "Tramas IR enviadas");
+//   irSends.inc();
+
+enum class MetricType : uint8_t
+{
+  COUNTER,
+  GAUGE,
+  HISTOGRAM
+};
+
+// Destino de la exportación: recibe fragmentos de texto ya formateados
+typedef void (*MetricsSink)(const char *data, size_t len, void *ctx);
+
+class Metric
+{
+private:
+  static Metric *head;
+  Metric *next;
+
+protected:
+  const char *name;
+  const char *help;
+  MetricType type;
+
+  // Los nombres y textos van directo al sink (sin largo máximo); emit()
+  // formatea solo la parte numérica de cada línea
+  static void put(MetricsSink sink, void *ctx, const char *text)
+  {
+    sink(text, strlen(text), ctx);
+  }
+
+  static void emit(MetricsSink sink, void *ctx, const char *fmt, ...)
+  {
+    char line[48];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0)
+      sink(line, min<size_t>(len, sizeof(line) - 1), ctx);
+  }
+
+public:
+  Metric(const char *name, const char *help, MetricType type)
+      : next(head), name(name), help(help), type(type)
+  {
+    head = this;
+  }
+
+  virtual ~Metric() {}
+
+  // Muestras en formato OpenMetrics (sin las líneas # TYPE / # HELP)
+  virtual void writeSamples(MetricsSink sink, void *ctx) const = 0;
+
+  // Valor compacto para el snapshot JSON ("nombre":valor)
+  virtual void writeCompact(MetricsSink sink, void *ctx) const = 0;
+
+  static const Metric *first() { return head; }
+  const Metric *getNext() const { return next; }
+  const char *getName() const { return name; }
+
+  // Exposición completa en formato OpenMetrics, terminada en # EOF
+  static void writeOpenMetrics(MetricsSink sink, void *ctx)
+  {
+    static const char *typeNames[] = {"counter", "gauge", "histogram"};
+    for (const Metric *m = head; m; m = m->next)
+    {
+      put(sink, ctx, "# TYPE ");
+      put(sink, ctx, m->name);
+      put(sink, ctx, " ");
+      put(sink, ctx, typeNames[(int)m->type]);
+      put(sink, ctx, "\n# HELP ");
+      put(sink, ctx, m->name);
+      put(sink, ctx, " ");
+      put(sink, ctx, m->help);
+      put(sink, ctx, "\n");
+      m->writeSamples(sink, ctx);
+    }
+    put(sink, ctx, "# EOF\n");
+  }
+
+  // Snapshot compacto: {"nombre":valor,...}
+  static void writeCompactJson(MetricsSink sink, void *ctx)
+  {
+    sink("{", 1, ctx);
+    for (const Metric *m = head; m; m = m->next)
+    {
+      m->writeCompact(sink, ctx);
+      if (m->next)
+        sink(",", 1, ctx);
+    }
+    sink("}", 1, ctx);
+  }
+};
+
+class Counter : public Metric
+{
+private:
+  std::atomic<uint32_t> value;
+
+public:
+  Counter(const char *name, const char *help) : Metric(name, help, MetricType::COUNTER), value(0) {}
+
+  void inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+  uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+  void writeSamples(MetricsSink sink, void *ctx) const override
+  {
+    put(sink, ctx, name);
+    emit(sink, ctx, "_total %u\n", (unsigned)get());
+  }
+
+  void writeCompact(MetricsSink sink, void *ctx) const override
+  {
+    put(sink, ctx, "\"");
+    put(sink, ctx, name);
+    emit(sink, ctx, "\":%u", (unsigned)get());
+  }
+};
+
+class Gauge : public Metric
+{
+private:
+  std::atomic<int32_t> value;
+
+public:
+  Gauge(const char *name, const char *help) : Metric(name, help, MetricType::GAUGE), value(0) {}
+
+  void set(int32_t v) { value.store(v, std::memory_order_relaxed); }
+  void inc(int32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+  void dec(int32_t n = 1) { value.fetch_sub(n, std::memory_order_relaxed); }
+  int32_t get() const { return value.load(std::memory_order_relaxed); }
+
+  void writeSamples(MetricsSink sink, void *ctx) const override
+  {
+    put(sink, ctx, name);
+    emit(sink, ctx, " %d\n", (int)get());
+  }
+
+  void writeCompact(MetricsSink sink, void *ctx) const override
+  {
+    put(sink, ctx, "\"");
+    put(sink, ctx, name);
+    emit(sink, ctx, "\":%d", (int)get());
+  }
+};
+
+// Histograma con límites fijos (valores enteros, ej. microsegundos)
+template <size_t BUCKETS>
+class Histogram : public Metric
+{
+private:
+  const uint32_t (&bounds)[BUCKETS];
+  std::atomic<uint32_t> counts[BUCKETS + 1]; // +1 para +Inf
+  std::atomic<uint32_t> sum;
+
+public:
+  Histogram(const char *name, const char *help, const uint32_t (&bounds)[BUCKETS])
+      : Metric(name, help, MetricType::HISTOGRAM), bounds(bounds), sum(0)
+  {
+    for (size_t i = 0; i <= BUCKETS; i++)
+      counts[i].store(0, std::memory_order_relaxed);
+  }
+
+  void observe(uint32_t v)
+  {
+    size_t i = 0;
+    while (i < BUCKETS && v > bounds[i])
+      i++;
+    counts[i].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  uint32_t count() const
+  {
+    uint32_t total = 0;
+    for (size_t i = 0; i <= BUCKETS; i++)
+      total += counts[i].load(std::memory_order_relaxed);
+    return total;
+  }
+
+  void writeSamples(MetricsSink sink, void *ctx) const override
+  {
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+      cumulative += counts[i].load(std::memory_order_relaxed);
+      put(sink, ctx, name);
+      emit(sink, ctx, "_bucket{le=\"%u\"} %u\n", (unsigned)bounds[i], (unsigned)cumulative);
+    }
+    cumulative += counts[BUCKETS].load(std::memory_order_relaxed);
+    put(sink, ctx, name);
+    emit(sink, ctx, "_bucket{le=\"+Inf\"} %u\n", (unsigned)cumulative);
+    put(sink, ctx, name);
+    emit(sink, ctx, "_sum %u\n", (unsigned)sum.load(std::memory_order_relaxed));
+    put(sink, ctx, name);
+    emit(sink, ctx, "_count %u\n", (unsigned)cumulative);
+  }
+
+  void writeCompact(MetricsSink sink, void *ctx) const override
+  {
+    put(sink, ctx, "\"");
+    put(sink, ctx, name);
+    emit(sink, ctx, "\":[%u,%u]", (unsigned)count(), (unsigned)sum.load(std::memory_order_relaxed));
+  }
+};
+
+// Inicializar cabeza de la lista (inicialización constante, antes que
+// cualquier constructor de métrica)
+Metric *Metric::head = nullptr;
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "Metrics.h"
+#include "Log.h"
+
+// Endpoint HTTP local GET /metrics en formato OpenMetrics, para que el
+// monitoreo haga scrape de todos los dispositivos de la misma forma
+class MetricsServer
+{
+private:
+  WebServer server;
+
+  // Agrupa los fragmentos para no mandar un paquete TCP por línea
+  struct ChunkBuffer
+  {
+    WebServer *server;
+    char data[512];
+    size_t len;
+
+    void flush()
+    {
+      if (len > 0)
+      {
+        server->sendContent(data, len);
+        len = 0;
+      }
+    }
+  };
+
+  static void bufferSink(const char *data, size_t len, void *ctx)
+  {
+    ChunkBuffer *chunk = static_cast<ChunkBuffer *>(ctx);
+    if (chunk->len + len > sizeof(chunk->data))
+      chunk->flush();
+    if (len > sizeof(chunk->data))
+    {
+      chunk->server->sendContent(data, len);
+      return;
+    }
+    memcpy(chunk->data + chunk->len, data, len);
+    chunk->len += len;
+  }
+
+  void handleMetrics()
+  {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/openmetrics-text; version=1.0.0; charset=utf-8", "");
+
+    ChunkBuffer chunk;
+    chunk.server = &server;
+    chunk.len = 0;
+    Metric::writeOpenMetrics(bufferSink, &chunk);
+    chunk.flush();
+    server.sendContent("");
+  }
+
+public:
+  MetricsServer(uint16_t port) : server(port) {}
+
+  void begin()
+  {
+    server.on("/metrics", HTTP_GET, [this]()
+              { handleMetrics(); });
+    server.begin();
+    LOG_I("✓ Servidor de métricas iniciado");
+  }
+
+  void loop()
+  {
+    server.handleClient();
+  }
+};
+
+#endif
@@ -5,138 +5,503 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
-
-// Forward declarations para callbacks
-typedef void (*AcCommandCallback)(bool turnOn, uint8_t temperature, const String& mode, const String& fanSpeed);
-typedef void (*LedCommandCallback)(uint8_t r, uint8_t g, uint8_t b, bool enabled);
-typedef void (*ConfigUpdateCallback)(int sampleInterval, int avgSamples);
+#include "Config.h"
+#include "CommandDedup.h"
+#include "CommandAuth.h"
+#include "Clock.h"
+#include "SampleScheduler.h"
+#include "Metrics.h"
+#include "TaskStats.h"
+#include "Trace.h"
+#include "Log.h"
+#include "MemoryPool.h"
+#include "PowerManager.h"
+#include "BrokerSelector.h"
+#include "Calibration.h"
+#include "SensorFusion.h"
+#include "SamplingTask.h"
+#include "CompressorBudget.h"
+#include "Events.h"
+#if MQTT_USE_TLS
+#include "TlsClient.h"
+#include "Certificates.h"
+#endif
+
+static Gauge metricMqttConnected("mqtt_connected", "1 si hay sesion con el broker");
+static Counter metricMqttConnects("mqtt_connects", "Conexiones exitosas al broker");
+static Counter metricMqttConnectFailures("mqtt_connect_failures", "Intentos de conexion fallidos");
+static Counter metricMqttMessages("mqtt_messages_received", "Mensajes de comando recibidos");
+static Counter metricMqttDuplicates("mqtt_commands_duplicate", "Comandos AC reentregados y omitidos");
+static Counter metricMqttParseErrors("mqtt_parse_errors", "Mensajes descartados por JSON invalido o sin memoria");
+static Gauge metricMqttConnectMs("mqtt_connect_ms", "Duracion de la ultima conexion (TCP + TLS + CONNECT)");
+static Gauge metricMqttBroker("mqtt_broker_index", "Broker en uso (posicion en MQTT_BROKERS)");
+static Counter metricMqttFailovers("mqtt_broker_switches", "Cambios de broker (failover y vuelta)");
+static Gauge metricFreeHeap("free_heap_bytes", "Heap libre");
 
 class MqttManager
 {
 private:
-  WiFiClient wifiClient;
+#if MQTT_USE_TLS
+  TlsClient netClient;
+#else
+  WiFiClient netClient;
+#endif
   PubSubClient mqtt;
   String deviceId;
-
-  // Callbacks
-  AcCommandCallback acCallback;
-  LedCommandCallback ledCallback;
-  ConfigUpdateCallback configCallback;
-
-  // Para hacer accesible el callback estático
-  static MqttManager *instance;
-
+  BrokerSelector brokers;
+  size_t currentBroker;     // size() mientras no hubo ninguna conexión
+  uint64_t connectedSinceMs;
+  uint64_t lastProbe;
+  bool wasConnected;
+  bool resyncPending;
+
+  // Sondeo TCP del broker preferido en una tarea aparte: connect() bloquea
+  // hasta MQTT_FAILBACK_PROBE_TIMEOUT_MS y loop() no puede esperarlo
+  TaskHandle_t probeTask; // nullptr sin sondeo en curso
+  volatile bool probeDone;
+  volatile bool probeOk;
+  size_t probeCandidate;
+  uint64_t probeStartMs;
+
+  // IDs de comandos AC ya ejecutados (reentregas QoS 1)
+  CommandDedupCache<DEDUP_CACHE_SETS, 4, AcAckStatus> commandCache;
+
+  // Firma HMAC, timestamp y nonce de los comandos entrantes
+  CommandAuth commandAuth;
+
+  // Bytes de cada mensaje; se rebobina al terminar de procesarlo
+  StaticArena<MSG_ARENA_BYTES> arena;
+
+  uint64_t lastReconnectAttempt; // ms monotónicos
+  uint64_t lastLogFlush;
+
+  // Un intento por llamada contra el mejor broker según BrokerSelector;
+  // loop() lo reintenta cada MQTT_FAILOVER_RETRY_MS mientras quede alguno
+  // sano, o cada MQTT_RETRY_INTERVAL_MS si están todos en cuarentena
   void reconnect()
   {
-    int retries = 0;
-    while (!mqtt.connected() && retries < 3)
+    lastReconnectAttempt = Clock::nowMs();
+    if (!mqtt.connected())
     {
-      Serial.print("Conectando a MQTT...");
+      size_t index = brokers.select(lastReconnectAttempt);
+      const BrokerEndpoint &broker = brokers.get(index);
+      mqtt.setServer(broker.host, broker.port);
+
+      ArenaScope scope(arena);
 
       // Last Will Testament: avisa si se desconecta inesperadamente
-      String lwt = deviceId + "/system/status";
+      const char *statusTopic = topic("/system/status");
+      if (!statusTopic)
+        return;
 
-      if (mqtt.connect(deviceId.c_str(), lwt.c_str(), 1, true, "offline"))
+      uint64_t start = Clock::nowMs();
+      if (mqtt.connect(deviceId.c_str(), statusTopic, 1, true, "offline"))
       {
-        Serial.println(" ✓ conectado");
+        uint32_t elapsedMs = (uint32_t)(Clock::nowMs() - start);
+        LOG_I("Conectando a MQTT %s:%u... ✓ conectado en %u ms", broker.host, broker.port, elapsedMs);
+        metricMqttConnects.inc();
+        metricMqttConnectMs.set(elapsedMs);
+        brokers.reportSuccess(index, elapsedMs);
+
+        // En otro broker los retained de estado pueden faltar o ser viejos
+        if (index != currentBroker)
+        {
+          if (currentBroker < brokers.size())
+          {
+            LOG_W("🔀 Broker cambiado: %s -> %s", brokers.get(currentBroker).host, broker.host);
+            metricMqttFailovers.inc();
+          }
+          resyncPending = true;
+        }
+        currentBroker = index;
+        connectedSinceMs = Clock::nowMs();
+        lastProbe = connectedSinceMs;
+        wasConnected = true;
+        metricMqttBroker.set(index);
 
         // Publicar que estamos online
-        String statusTopic = deviceId + "/system/status";
-        mqtt.publish(statusTopic.c_str(), "online", true);
+        mqtt.publish(statusTopic, "online", true);
 
+        EventBus::publish(MqttConnectedEvent{});
         subscribeToTopics();
       }
       else
       {
-        Serial.print(" ✗ falló, rc=");
-        Serial.println(mqtt.state());
-        retries++;
-        delay(2000);
+        LOG_W("Conectando a MQTT %s:%u... ✗ falló, rc=%d", broker.host, broker.port, mqtt.state());
+        metricMqttConnectFailures.inc();
+        brokers.reportFailure(index, Clock::nowMs());
       }
     }
   }
 
+  // Estando fuera del broker preferido, sondearlo por TCP cada
+  // MQTT_FAILBACK_PROBE_MS y volver cuando BrokerSelector lo da por estable
+  static void probeEntry(void *arg)
+  {
+    MqttManager *self = static_cast<MqttManager *>(arg);
+    const BrokerEndpoint &broker = self->brokers.get(self->probeCandidate);
+    WiFiClient probe;
+    self->probeOk = probe.connect(broker.host, broker.port, MQTT_FAILBACK_PROBE_TIMEOUT_MS);
+    probe.stop();
+    self->probeDone = true;
+    vTaskDelete(nullptr);
+  }
+
+  void checkFailback()
+  {
+    uint64_t now = Clock::nowMs();
+    if (probeTask)
+    {
+      if (probeDone)
+      {
+        probeTask = nullptr;
+        finishProbe(now);
+      }
+      return;
+    }
+
+    if (now - lastProbe < MQTT_FAILBACK_PROBE_MS)
+      return;
+    lastProbe = now;
+
+    size_t candidate = brokers.failbackCandidate(currentBroker, now);
+    if (candidate >= brokers.size())
+      return;
+
+    probeCandidate = candidate;
+    probeDone = false;
+    probeStartMs = now;
+    if (xTaskCreatePinnedToCore(probeEntry, "probe", MQTT_PROBE_TASK_STACK, this, 1, &probeTask, 0) != pdPASS)
+      probeTask = nullptr;
+  }
+
+  void finishProbe(uint64_t now)
+  {
+    const BrokerEndpoint &broker = brokers.get(probeCandidate);
+    uint32_t probeMs = (uint32_t)(now - probeStartMs);
+    brokers.reportProbe(probeCandidate, probeOk, probeMs, now);
+    LOG_D("Sondeo broker %s:%u %s (%u ms)", broker.host, broker.port, probeOk ? "✓" : "✗", probeMs);
+
+    if (!mqtt.connected() || !brokers.failbackReady(probeCandidate, currentBroker, now - connectedSinceMs))
+      return;
+
+    // Sin "offline" retained en el broker de respaldo: con puente entre
+    // brokers podría llegar al preferido después del "online" nuevo. La
+    // desconexión es limpia, así que tampoco se publica el LWT
+    LOG_I("🔀 Volviendo al broker preferido %s:%u", broker.host, broker.port);
+    brokers.resetProbes(probeCandidate);
+    mqtt.disconnect();
+    wasConnected = false;
+    reconnect();
+  }
+
   void subscribeToTopics()
   {
-    mqtt.subscribe((deviceId + "/ac/command").c_str(), 1);
-    mqtt.subscribe((deviceId + "/led/command").c_str(), 1);
-    mqtt.subscribe((deviceId + "/config/update").c_str(), 1);
-    mqtt.subscribe((deviceId + "/system/reboot").c_str(), 1);
+    static const struct
+    {
+      const char *suffix;
+      uint8_t qos;
+    } subscriptions[] = {
+        {"/ac/command", 1},
+        {"/led/command", 1},
+        {"/config/update", 1},
+        {"/calibration/update", 1},
+        {"/sensor/read", 0},
+        {"/system/reboot", 1},
+        {"/trace/dump", 0},
+        {"/ota/update", 1},
+    };
+
+    for (size_t i = 0; i < sizeof(subscriptions) / sizeof(subscriptions[0]); i++)
+    {
+      ArenaScope scope(arena);
+      const char *t = topic(subscriptions[i].suffix);
+      if (t)
+        mqtt.subscribe(t, subscriptions[i].qos);
+    }
+
+    // Presupuesto y leases del grupo (topics sin device_id)
+    mqtt.subscribe(FLEET_TOPIC "/budget", 1);
+    mqtt.subscribe(FLEET_TOPIC "/lease/+", 1);
+    mqtt.subscribe(FLEET_DR_TOPIC, 1);
+
+    LOG_D("Suscrito a topics de comando");
+  }
+
+  // deviceId + sufijo, en la arena del mensaje en curso
+  const char *topic(const char *suffix)
+  {
+    return arena.concat(deviceId.c_str(), suffix);
+  }
+
+  static bool topicEndsWith(const char *topic, const char *suffix)
+  {
+    size_t lenTopic = strlen(topic);
+    size_t lenSuffix = strlen(suffix);
+    return lenTopic >= lenSuffix && strcmp(topic + lenTopic - lenSuffix, suffix) == 0;
+  }
+
+  // Serializar en la arena y publicar en un solo paquete
+  bool publishJson(const char *suffix, const JsonDocument &doc, bool retained)
+  {
+    ArenaScope scope(arena);
+    const char *t = topic(suffix);
+    return t && publishJsonTo(t, doc, retained);
+  }
+
+  // sign: agregar la firma HMAC (mensajes que leen otros dispositivos)
+  bool publishJsonTo(const char *t, const JsonDocument &doc, bool retained, bool sign = false)
+  {
+    ArenaScope scope(arena);
+    size_t len = measureJson(doc);
+    char *buffer = (char *)arena.alloc(len + CommandAuth::TRAILER_LEN + 1, 1);
+    if (!buffer)
+      return false;
+
+    serializeJson(doc, buffer, len + 1);
+    if (sign)
+      len = commandAuth.sign(t, buffer, len);
+    return mqtt.publish(t, (const uint8_t *)buffer, len, retained);
+  }
+
+  struct MetricsSnapshot
+  {
+    char data[METRICS_SNAPSHOT_MAX];
+    size_t len;
+    size_t needed; // Largo completo; mayor que len si no entró
+  };
+
+  // Un snapshot cortado sería JSON inválido: se cuenta lo que falta y no se publica
+  static void snapshotSink(const char *data, size_t len, void *ctx)
+  {
+    MetricsSnapshot *snapshot = static_cast<MetricsSnapshot *>(ctx);
+    snapshot->needed += len;
+    if (snapshot->needed > sizeof(snapshot->data))
+      return;
+    memcpy(snapshot->data + snapshot->len, data, len);
+    snapshot->len += len;
+  }
+
+  static void countSink(const char *, size_t len, void *ctx)
+  {
+    *static_cast<size_t *>(ctx) += len;
+  }
 
-    Serial.println("Suscrito a topics de comando");
+  static void writeSink(const char *data, size_t len, void *ctx)
+  {
+    static_cast<PubSubClient *>(ctx)->write((const uint8_t *)data, len);
   }
 
-  static void messageCallback(char *topic, byte *payload, unsigned int length)
+  // Presupuesto (lo firma el backend) y leases de otros equipos (los firma
+  // cada dispositivo con la misma clave, así un cliente cualquiera del
+  // broker no puede bloquear los arranques del grupo). Son retained: sin
+  // control de timestamp ni nonce; un lease vencido se descarta igual.
+  // Payload vacío: retained borrado, que en el presupuesto quita el límite
+  void handleFleetMessage(const char *topic, const char *suffix, char *message, size_t length)
   {
-    if (instance)
+    bool isLease = strncmp(suffix, "lease/", 6) == 0;
+    if (!isLease && strcmp(suffix, "budget") != 0)
+      return;
+
+    if (length == 0)
+    {
+      if (isLease)
+        EventBus::publish(FleetLeaseEvent{suffix + 6, false, false, 0, 0});
+      else
+        EventBus::publish(FleetBudgetEvent{0, 0});
+      return;
+    }
+
+    AuthResult auth = commandAuth.verifySignature(topic, message, length);
+    if (!commandAuth.allowed(auth))
     {
-      instance->handleMessage(topic, payload, length);
+      LOG_W("🔒 %s rechazado: %s", isLease ? "Lease" : "Presupuesto", CommandAuth::describe(auth));
+      return;
     }
+
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    if (deserializeJson(doc, message, length))
+      return;
+
+    if (isLease)
+      EventBus::publish(FleetLeaseEvent{suffix + 6, true, doc["held"] | false,
+                                        doc["since"] | (uint64_t)0, doc["expires"] | (uint64_t)0});
+    else
+      EventBus::publish(FleetBudgetEvent{doc["max_starts"] | (uint8_t)0,
+                                         (doc["lease_s"] | (uint32_t)FLEET_LEASE_DEFAULT_S) * 1000});
+  }
+
+  // Demand response: firmado y retained como el presupuesto. La vigencia
+  // sale de start + duration_s, así que una señal vieja repetida no aplica
+  void handleDemandResponse(const char *topic, char *message, size_t length)
+  {
+    if (length == 0)
+      return;
+
+    AuthResult auth = commandAuth.verifySignature(topic, message, length);
+    if (!commandAuth.allowed(auth))
+    {
+      LOG_W("🔒 Demand response rechazado: %s", CommandAuth::describe(auth));
+      return;
+    }
+
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    if (deserializeJson(doc, message, length))
+      return;
+
+    EventBus::publish(DemandResponseEvent{doc["level"] | (uint8_t)0, doc["start"] | (uint32_t)0,
+                                          doc["duration_s"] | (uint32_t)0, doc["event_id"] | ""});
   }
 
   void handleMessage(char *topic, byte *payload, unsigned int length)
   {
+    TRACE_SCOPE("handleMessage");
+    CpuBoost boost; // Misma latencia de comandos que a frecuencia fija
+    ArenaScope scope(arena); // Todo lo del mensaje se libera al salir
+
     // Convertir payload a string
-    char message[length + 1];
-    memcpy(message, payload, length);
-    message[length] = '\0';
+    char *message = arena.copy((const char *)payload, length);
+    if (!message)
+      return;
 
-    Serial.print("📨 Mensaje recibido [");
-    Serial.print(topic);
-    Serial.print("]: ");
-    Serial.println(message);
+    LOG_D("📨 Mensaje recibido [%s]: %s", topic, message);
+    metricMqttMessages.inc();
 
-    String topicStr = String(topic);
+    if (strncmp(topic, FLEET_TOPIC "/", sizeof(FLEET_TOPIC)) == 0)
+    {
+      handleFleetMessage(topic, topic + sizeof(FLEET_TOPIC), message, length);
+      return;
+    }
+    if (strcmp(topic, FLEET_DR_TOPIC) == 0)
+    {
+      handleDemandResponse(topic, message, length);
+      return;
+    }
+
+    // La firma va sobre los bytes recibidos: se verifica antes de parsear,
+    // que modifica message
+    AuthResult auth = commandAuth.verifySignature(topic, message, length);
 
-    // Parsear JSON
-    StaticJsonDocument<256> doc;
-    DeserializationError error = deserializeJson(doc, message);
+    // Parsear JSON (sin copia: las cadenas apuntan a message). Una
+    // calibración con todos sus puntos no entra en un bloque chico
+    bool isCalibration = topicEndsWith(topic, "/calibration/update");
+    PooledJsonDocument doc(isCalibration ? JSON_CALIBRATION_CAPACITY : JSON_POOL_SMALL_BYTES);
+    DeserializationError error = deserializeJson(doc, message, length);
 
     if (error)
     {
-      Serial.print("Error parseando JSON: ");
-      Serial.println(error.c_str());
+      LOG_W("Error parseando JSON [%s]: %s", topic, error.c_str());
+      metricMqttParseErrors.inc();
+      return;
+    }
+
+    // Reentrega QoS1 de un comando AC ya ejecutado: responder sin reenviar
+    // IR. Va antes del control de nonce, que ya se consumió en la primera
+    // entrega; basta con que la firma sea válida
+    bool isAcCommand = topicEndsWith(topic, "/ac/command");
+    const char *commandId = isAcCommand ? (doc["command_id"] | "") : "";
+    bool hasId = commandId[0] != '\0';
+    AcAckStatus cachedResult;
+    if (hasId && CommandAuth::acceptable(auth) && commandCache.lookup(commandId, Clock::nowMs(), cachedResult))
+    {
+      LOG_I("↩️ Comando %s duplicado, se omite", commandId);
+      metricMqttDuplicates.inc();
+      publishCommandAck(commandId, cachedResult, true);
+      return;
+    }
+
+    if (auth == AuthResult::OK && commandAuth.isEnabled())
+      auth = commandAuth.checkFreshness(doc["timestamp"] | 0u, doc["nonce"] | "");
+    if (!commandAuth.allowed(auth))
+    {
+      LOG_W("🔒 Comando rechazado [%s]: %s", topic, CommandAuth::describe(auth));
       return;
     }
 
     // Manejar comandos
-    if (topicStr.endsWith("/ac/command"))
+    if (isAcCommand)
     {
-      String action = doc["action"].as<String>();
+      const char *action = doc["action"] | "";
       uint8_t temperature = doc["temperature"] | 24;
-      String mode = doc["mode"] | "cool";
-      String fanSpeed = doc["fan_speed"] | "auto";
+      const char *mode = doc["mode"] | "cool";
+      const char *fanSpeed = doc["fan_speed"] | "auto";
 
-      if (acCallback)
+      AcAckStatus status = AcAckStatus::FAILED;
+      EventBus::publish(AcCommandEvent{strcmp(action, "on") == 0, temperature, mode, fanSpeed, commandId, &status});
+      if (hasId)
       {
-        acCallback(action == "on", temperature, mode, fanSpeed);
+        commandCache.remember(commandId, status, Clock::nowMs());
+        publishCommandAck(commandId, status, false);
       }
     }
-    else if (topicStr.endsWith("/led/command"))
+    else if (topicEndsWith(topic, "/led/command"))
     {
-      if (ledCallback)
-      {
-        uint8_t r = doc["r"] | 0;
-        uint8_t g = doc["g"] | 0;
-        uint8_t b = doc["b"] | 0;
-        bool enabled = doc["enabled"] | true;
-        ledCallback(r, g, b, enabled);
-      }
+      uint8_t r = doc["r"] | 0;
+      uint8_t g = doc["g"] | 0;
+      uint8_t b = doc["b"] | 0;
+      bool enabled = doc["enabled"] | true;
+      EventBus::publish(LedCommandEvent{r, g, b, enabled});
     }
-    else if (topicStr.endsWith("/config/update"))
+    else if (topicEndsWith(topic, "/config/update"))
     {
-      if (configCallback)
+      int interval = doc["sample_interval"] | 30;
+      int samples = doc["avg_samples"] | 10;
+      EventBus::publish(ConfigUpdateEvent{interval, samples});
+    }
+    else if (isCalibration)
+    {
+      // {"sensor": 0, "temperature": [[crudo, referencia], ...], "humidity": [...]};
+      // un canal ausente no se toca, una lista vacía quita la corrección
+      uint8_t sensor = doc["sensor"] | 0;
+      static const struct
+      {
+        const char *key;
+        CalChannel channel;
+      } channels[] = {{"temperature", CalChannel::TEMPERATURE}, {"humidity", CalChannel::HUMIDITY}};
+
+      for (size_t c = 0; c < 2; c++)
       {
-        int interval = doc["sample_interval"] | 30;
-        int samples = doc["avg_samples"] | 10;
-        configCallback(interval, samples);
+        JsonArrayConst list = doc[channels[c].key];
+        if (list.isNull())
+          continue;
+
+        CalPoint points[CAL_MAX_POINTS];
+        size_t n = 0;
+        bool valid = list.size() <= CAL_MAX_POINTS;
+        for (JsonVariantConst pair : list)
+        {
+          if (!valid || pair.size() != 2)
+          {
+            valid = false;
+            break;
+          }
+          points[n].raw = pair[0] | NAN;
+          points[n].ref = pair[1] | NAN;
+          n++;
+        }
+
+        bool ok = valid && EventBus::publish(CalibrationEvent{sensor, channels[c].channel, points, n});
+        if (!ok)
+          LOG_W("✗ Calibración de %s rechazada", channels[c].key);
       }
     }
-    else if (topicStr.endsWith("/system/reboot"))
+    else if (topicEndsWith(topic, "/sensor/read"))
+    {
+      EventBus::publish(SensorReadEvent{doc["max_age_ms"] | (uint32_t)SAMPLE_INTERVAL_MS});
+    }
+    else if (topicEndsWith(topic, "/trace/dump"))
+    {
+      publishTrace(doc["clear"] | false);
+    }
+    else if (topicEndsWith(topic, "/ota/update"))
+    {
+      EventBus::publish(OtaCommandEvent{doc["url"] | "", doc["sha256"] | "", doc["format"] | "full", doc["base"] | ""});
+    }
+    else if (topicEndsWith(topic, "/system/reboot"))
     {
       if (doc["confirm"] == true)
       {
-        Serial.println("🔄 Reiniciando por comando remoto...");
+        LOG_W("🔄 Reiniciando por comando remoto...");
         delay(1000);
         ESP.restart();
       }
@@ -144,29 +509,66 @@ private:
   }
 
 public:
-  MqttManager(const char *broker, int port, String devId)
-      : mqtt(wifiClient), deviceId(devId),
-        acCallback(nullptr), ledCallback(nullptr), configCallback(nullptr)
+  MqttManager(const BrokerEndpoint *brokerList, size_t brokerCount, String devId)
+      : mqtt(netClient), deviceId(devId), brokers(brokerList, brokerCount),
+        currentBroker(brokerCount), connectedSinceMs(0), lastProbe(0), wasConnected(false), resyncPending(false),
+        probeTask(nullptr), probeDone(false), probeOk(false), probeCandidate(0), probeStartMs(0),
+        commandCache(DEDUP_TTL_MS), arena("mqtt_arena"), lastReconnectAttempt(0), lastLogFlush(0)
   {
-    mqtt.setServer(broker, port);
-    mqtt.setCallback(messageCallback);
-    mqtt.setKeepAlive(60);
+#if MQTT_USE_TLS
+    netClient.setCACert(MQTT_CA_CERT);
+    netClient.setServerName(MQTT_TLS_SERVER_NAME);
+#endif
+    // PubSubClient guarda un std::function en ESP32; capturar solo this
+    // entra en su almacenamiento interno, sin heap
+    mqtt.setCallback([this](char *topic, byte *payload, unsigned int length)
+                     { handleMessage(topic, payload, length); });
+    mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+    mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
     mqtt.setSocketTimeout(15);
-    instance = this;
   }
 
   void begin()
   {
-    reconnect();
+    commandAuth.begin(CMD_AUTH_KEY);
+    if (WiFi.status() == WL_CONNECTED)
+      reconnect();
   }
 
   void loop()
   {
+    // Sin WiFi no tiene sentido insistir con el broker
+    if (WiFi.status() != WL_CONNECTED)
+      return;
+
     if (!mqtt.connected())
     {
+      metricMqttConnected.set(0);
+      uint64_t now = Clock::nowMs();
+      if (wasConnected)
+      {
+        // Caída de la sesión: cuenta como fallo y se reintenta ya mismo
+        LOG_W("Conexión MQTT perdida con %s", brokers.get(currentBroker).host);
+        wasConnected = false;
+        brokers.reportFailure(currentBroker, now);
+      }
+      else
+      {
+        uint32_t retryMs = brokers.allQuarantined(now) ? MQTT_RETRY_INTERVAL_MS : MQTT_FAILOVER_RETRY_MS;
+        if (now - lastReconnectAttempt < retryMs)
+          return;
+      }
       reconnect();
     }
+    else
+    {
+      checkFailback();
+    }
+    metricMqttConnected.set(mqtt.connected() ? 1 : 0);
     mqtt.loop();
+#if LOG_TOKENIZED
+    publishLogs();
+#endif
   }
 
   bool isConnected()
@@ -174,71 +576,207 @@ public:
     return mqtt.connected();
   }
 
+  // true una vez tras conectar a un broker distinto del anterior: hay que
+  // volver a publicar los retained de estado (AC, LED)
+  bool consumeResync()
+  {
+    bool pending = resyncPending && mqtt.connected();
+    if (pending)
+      resyncPending = false;
+    return pending;
+  }
+
+  const char *getBrokerHost()
+  {
+    return currentBroker < brokers.size() ? brokers.get(currentBroker).host : "";
+  }
+
   // Publicar temperatura individual
-  void publishTemperature(float temp, float hum, unsigned long timestamp)
+  bool publishTemperature(float temp, float hum, uint64_t timestampMs)
   {
+    TRACE_SCOPE("publishTemperature");
     if (!mqtt.connected())
-      return;
+      return false;
 
-    StaticJsonDocument<128> doc;
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
     doc["temperature"] = round(temp * 10) / 10.0; // 1 decimal
     doc["humidity"] = round(hum * 10) / 10.0;
-    doc["timestamp"] = timestamp;
+    doc["timestamp"] = (uint32_t)(timestampMs / 1000);
+    doc["timestamp_ms"] = timestampMs;
+
+    return publishJson("/sensor/raw", doc, false);
+  }
+
+  // Medición fusionada y aporte de cada sensor
+  void publishFusion(const FusionSnapshot &fusion, float temp, float hum, uint64_t timestampMs)
+  {
+    TRACE_SCOPE("publishFusion");
+    if (!mqtt.connected())
+      return;
+
+    PooledJsonDocument doc(JSON_POOL_LARGE_BYTES); // Hasta SENSOR_MAX objetos
+    doc["temperature"] = round(temp * 10) / 10.0;
+    doc["humidity"] = round(hum * 10) / 10.0;
+    doc["sensors_ok"] = fusion.sensorsOk;
+    doc["timestamp_ms"] = timestampMs;
+
+    JsonArray sensors = doc.createNestedArray("sensors");
+    for (size_t i = 0; i < fusion.count; i++)
+    {
+      const SensorContribution &c = fusion.sensors[i];
+      JsonObject s = sensors.createNestedObject();
+      s["pin"] = c.pin;
+      s["ok"] = c.ok;
+      if (c.ok)
+      {
+        s["t"] = round(c.temperatura * 10) / 10.0;
+        s["h"] = round(c.humedad * 10) / 10.0;
+      }
+      s["w_t"] = round(c.pesoTemp * 100) / 100.0;
+      s["w_h"] = round(c.pesoHum * 100) / 100.0;
+      s["health"] = c.salud;
+    }
+
+    publishJson("/sensor/fusion", doc, false);
+  }
+
+  // Respuesta a /sensor/read desde la cache de lecturas
+  void publishCurrentReading(const SensorReading &reading, bool fresh)
+  {
+    TRACE_SCOPE("publishCurrentReading");
+    if (!mqtt.connected() || !reading.valid)
+      return;
 
-    char buffer[150];
-    serializeJson(doc, buffer);
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    doc["ok"] = reading.ok;
+    doc["temperature"] = round(reading.temperatura * 10) / 10.0;
+    doc["humidity"] = round(reading.humedad * 10) / 10.0;
+    doc["timestamp_ms"] = reading.timestampMs;
+    doc["age_ms"] = (uint32_t)(Clock::nowMs() - reading.monoMs);
+    doc["fresh"] = fresh;
 
-    String topic = deviceId + "/sensor/raw";
-    mqtt.publish(topic.c_str(), buffer, false);
+    publishJson("/sensor/current", doc, false);
+  }
+
+  // Disponibilidad, latencia de lectura y recuperaciones por sensor
+  void publishSensorHealth(SensorFusion &fusion)
+  {
+    TRACE_SCOPE("publishSensorHealth");
+    if (!mqtt.connected())
+      return;
+
+    PooledJsonDocument doc(JSON_POOL_LARGE_BYTES);
+    JsonArray sensors = doc.createNestedArray("sensors");
+    for (size_t i = 0; i < fusion.size(); i++)
+    {
+      TemperatureSensor &sensor = fusion.getSensor(i);
+      const SensorHealthStats &stats = sensor.getStats();
+      JsonObject s = sensors.createNestedObject();
+      s["pin"] = sensor.getPin();
+      s["reads"] = stats.reads;
+      s["errors"] = stats.errors;
+      s["stuck"] = stats.stuckEvents;
+      s["recoveries"] = stats.recoveries;
+      s["recovered"] = stats.recovered;
+      s["read_us"] = stats.lastReadUs;
+      s["read_max_us"] = stats.maxReadUs;
+      s["healthy_s"] = (uint32_t)(stats.healthyMs / 1000);
+      s["availability"] = stats.totalMs ? round(1000.0 * stats.healthyMs / stats.totalMs) / 10.0 : 0.0;
+    }
+
+    publishJson("/sensor/health", doc, false);
   }
 
   // Publicar promedio
-  void publishAverage(float avgTemp, float avgHum, int samples, unsigned long timestamp)
+  void publishAverage(float avgTemp, float avgHum, int samples, uint64_t timestampMs)
   {
+    TRACE_SCOPE("publishAverage");
     if (!mqtt.connected())
       return;
 
-    StaticJsonDocument<128> doc;
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
     doc["temp"] = round(avgTemp * 10) / 10.0;
     doc["hum"] = round(avgHum * 10) / 10.0;
     doc["samples"] = samples;
-    doc["timestamp"] = timestamp;
+    doc["timestamp"] = (uint32_t)(timestampMs / 1000);
+    doc["timestamp_ms"] = timestampMs;
 
-    char buffer[150];
-    serializeJson(doc, buffer);
+    publishJson("/sensor/avg", doc, false);
 
-    String topic = deviceId + "/sensor/avg";
-    mqtt.publish(topic.c_str(), buffer, false);
-
-    Serial.print("📊 Promedio enviado: ");
-    Serial.print(avgTemp);
-    Serial.print("°C, ");
-    Serial.print(avgHum);
-    Serial.println("%");
+    LOG_I("📊 Promedio enviado: %.2f°C, %.2f%%", avgTemp, avgHum);
   }
 
   // Publicar estado del AC (con retained flag)
-  void publishAcStatus(bool isOn, uint8_t temperature, const String& mode, const String& fanSpeed, unsigned long timestamp)
+  void publishAcStatus(bool isOn, uint8_t temperature, const char *mode, const char *fanSpeed, uint8_t drLevel, uint64_t timestampMs)
   {
+    TRACE_SCOPE("publishAcStatus");
     if (!mqtt.connected())
       return;
 
-    StaticJsonDocument<256> doc;
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
     doc["state"] = isOn ? "on" : "off";
     doc["temperature"] = temperature;
     doc["mode"] = mode;
     doc["fan_speed"] = fanSpeed;
+    doc["dr_level"] = drLevel; // > 0: estado reducido por demand response
     doc["confirmed"] = true;
-    doc["timestamp"] = timestamp;
+    doc["timestamp"] = (uint32_t)(timestampMs / 1000);
+    doc["timestamp_ms"] = timestampMs;
 
-    char buffer[256];
-    serializeJson(doc, buffer);
+    publishJson("/ac/status", doc, true); // retained = true
 
-    String topic = deviceId + "/ac/status";
-    mqtt.publish(topic.c_str(), buffer, true); // retained = true
+    LOG_I("❄️ Estado AC publicado: %s, %d°C, %s, %s",
+          isOn ? "ON" : "OFF", temperature, mode, fanSpeed);
+  }
 
-    Serial.printf("❄️ Estado AC publicado: %s, %d°C, %s, %s\n",
-                  isOn ? "ON" : "OFF", temperature, mode.c_str(), fanSpeed.c_str());
+  // Confirmar un comando con ID de idempotencia
+  void publishCommandAck(const char *commandId, AcAckStatus status, bool duplicate)
+  {
+    if (!mqtt.connected())
+      return;
+
+    static const char *const names[] = {"failed", "applied", "queued"};
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    doc["command_id"] = commandId;
+    doc["success"] = status == AcAckStatus::APPLIED;
+    doc["status"] = names[(uint8_t)status];
+    doc["duplicate"] = duplicate;
+
+    publishJson("/ac/ack", doc, false);
+  }
+
+  // Ack final de un comando que quedó en cola (aplicado o descartado); una
+  // reentrega posterior recibe este resultado
+  void completeCommandAck(const char *commandId, bool success)
+  {
+    AcAckStatus status = success ? AcAckStatus::APPLIED : AcAckStatus::FAILED;
+    commandCache.remember(commandId, status, Clock::nowMs());
+    publishCommandAck(commandId, status, false);
+  }
+
+  // Lease propio de arranque de compresor (retained en el topic del grupo)
+  void publishCompressorLease(const CompressorLease &lease)
+  {
+    if (!mqtt.connected())
+      return;
+
+    ArenaScope scope(arena);
+    const char *t = arena.concat(FLEET_TOPIC "/lease/", deviceId.c_str());
+    if (!t)
+      return;
+
+    if (!lease.present)
+    {
+      mqtt.publish(t, (const uint8_t *)"", 0, true); // Borra el retained
+      return;
+    }
+
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    doc["held"] = lease.held;
+    doc["since"] = lease.sinceMs;
+    doc["expires"] = lease.expiresMs;
+
+    publishJsonTo(t, doc, true, true);
   }
 
   // Publicar estado del LED
@@ -247,52 +785,184 @@ public:
     if (!mqtt.connected())
       return;
 
-    StaticJsonDocument<128> doc;
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
     doc["r"] = r;
     doc["g"] = g;
     doc["b"] = b;
     doc["enabled"] = enabled;
 
-    char buffer[128];
-    serializeJson(doc, buffer);
+    publishJson("/led/status", doc, true); // retained = true
+  }
+
+  // Progreso y resultado de una actualización OTA
+  void publishOtaStatus(const char *state, uint32_t downloaded, uint32_t total,
+                        uint32_t written, uint32_t durationMs, const char *error)
+  {
+    if (!mqtt.connected())
+      return;
+
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
+    doc["state"] = state;
+    doc["downloaded"] = downloaded;
+    if (total > 0)
+      doc["total"] = total;
+    doc["written"] = written;
+    doc["duration_ms"] = durationMs;
+    if (error)
+      doc["error"] = error;
 
-    String topic = deviceId + "/led/status";
-    mqtt.publish(topic.c_str(), buffer, true); // retained = true
+    publishJson("/ota/status", doc, false);
   }
 
   // Heartbeat del sistema
-  void publishHeartbeat(unsigned long uptime, int rssi)
+  void publishHeartbeat(uint32_t uptime, int rssi, const SamplingStats &sampling,
+                        uint32_t offlineSeconds, uint32_t wifiDisconnects)
   {
+    TRACE_SCOPE("publishHeartbeat");
     if (!mqtt.connected())
       return;
 
-    StaticJsonDocument<128> doc;
+    PooledJsonDocument doc(JSON_POOL_SMALL_BYTES);
     doc["uptime"] = uptime;
     doc["wifi_rssi"] = rssi;
     doc["free_heap"] = ESP.getFreeHeap();
+    doc["align_err_ms"] = sampling.lastAlignErrorMs;
+    doc["align_err_max_ms"] = sampling.maxAlignErrorMs;
+    doc["sample_late_us"] = sampling.lastLatenessUs;
+    doc["sample_late_max_us"] = sampling.maxLatenessUs;
+    doc["sample_jitter_us"] = (uint32_t)sampling.jitterUs();
+    doc["samples_missed"] = sampling.missed;
+    doc["offline_s"] = offlineSeconds;
+    doc["wifi_disconnects"] = wifiDisconnects;
+    doc["mqtt_broker"] = getBrokerHost();
+
+    uint64_t maxFreqMs, minFreqMs;
+    PowerManager::getTimes(maxFreqMs, minFreqMs);
+    doc["cpu_mhz"] = getCpuFrequencyMhz();
+    doc["cpu_max_freq_s"] = (uint32_t)(maxFreqMs / 1000);
+    doc["cpu_min_freq_s"] = (uint32_t)(minFreqMs / 1000);
+
+    publishJson("/system/heartbeat", doc, false);
+  }
+
+  // Snapshot compacto del registro de métricas
+  void publishMetrics()
+  {
+    TRACE_SCOPE("publishMetrics");
+    if (!mqtt.connected())
+      return;
+    CpuBoost boost;
 
-    char buffer[150];
-    serializeJson(doc, buffer);
+    metricFreeHeap.set(ESP.getFreeHeap());
 
-    String topic = deviceId + "/system/heartbeat";
-    mqtt.publish(topic.c_str(), buffer, false);
+    static MetricsSnapshot snapshot; // Fuera del stack de loop()
+    snapshot.len = 0;
+    snapshot.needed = 0;
+    Metric::writeCompactJson(snapshotSink, &snapshot);
+    if (snapshot.needed > snapshot.len)
+    {
+      LOG_E("✗ Snapshot de métricas de %u bytes, METRICS_SNAPSHOT_MAX es %u: no se publica",
+            (unsigned)snapshot.needed, (unsigned)METRICS_SNAPSHOT_MAX);
+      return;
+    }
+
+    // Se publica en streaming: el snapshot puede superar el buffer de PubSubClient
+    ArenaScope scope(arena);
+    const char *t = topic("/system/metrics");
+    if (!t)
+      return;
+    mqtt.beginPublish(t, snapshot.len, false);
+    mqtt.write((const uint8_t *)snapshot.data, snapshot.len);
+    mqtt.endPublish();
   }
 
-  // Setters para callbacks
-  void setAcCommandCallback(AcCommandCallback callback)
+  // Uso de CPU y stack por tarea
+  void publishTaskStats(const TaskStats &stats)
   {
-    acCallback = callback;
+    TRACE_SCOPE("publishTaskStats");
+    if (!mqtt.connected())
+      return;
+    CpuBoost boost;
+
+    // truncated va primero: al final solo cambia de valor, sin pedir slots
+    PooledJsonDocument doc(JSON_TASK_STATS_CAPACITY);
+    doc["truncated"] = false;
+    doc["tasks_total"] = stats.getTotal();
+    doc["idle_pct"] = stats.getIdlePermille() / 10.0;
+    JsonArray tasks = doc.createNestedArray("tasks");
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+      const TaskStats::Entry &e = stats.at(i);
+      JsonObject task = tasks.createNestedObject();
+      task["name"] = e.name; // Buffer estable: ArduinoJson guarda el puntero
+      task["cpu"] = e.cpuPermille / 10.0;
+      task["stack_free"] = e.stackFree;
+      task["prio"] = e.priority;
+    }
+    if (doc.overflowed() || stats.getTotal() > stats.size())
+    {
+      LOG_W("⚠️ Estadísticas de %u tareas, se publican %u", (unsigned)stats.getTotal(), (unsigned)tasks.size());
+      doc["truncated"] = true;
+    }
+
+    ArenaScope scope(arena);
+    const char *t = topic("/system/tasks");
+    if (!t)
+      return;
+    mqtt.beginPublish(t, measureJson(doc), false);
+    serializeJson(doc, mqtt);
+    mqtt.endPublish();
   }
 
-  void setLedCommandCallback(LedCommandCallback callback)
+  // Volcado del anillo de trazas (texto, ver tools/trace_to_chrome.py)
+  void publishTrace(bool clearAfter)
   {
-    ledCallback = callback;
+    if (!mqtt.connected())
+      return;
+
+    ArenaScope scope(arena);
+    const char *t = topic("/trace/data");
+    if (!t)
+      return;
+
+    // Pausado durante las dos pasadas para que el largo coincida
+    bool wasEnabled = Tracer::isEnabled();
+    Tracer::setEnabled(false);
+
+    size_t len = 0;
+    Tracer::dump(countSink, &len);
+
+    mqtt.beginPublish(t, len, false);
+    Tracer::dump(writeSink, &mqtt);
+    mqtt.endPublish();
+
+    if (clearAfter)
+      Tracer::clear();
+    Tracer::setEnabled(wasEnabled);
   }
 
-  void setConfigUpdateCallback(ConfigUpdateCallback callback)
+#if LOG_TOKENIZED
+  // Logs tokenizados pendientes (ver tools/detokenize.py)
+  void publishLogs()
   {
-    configCallback = callback;
+    if (!mqtt.connected() || Clock::nowMs() - lastLogFlush < LOG_REMOTE_FLUSH_MS)
+      return;
+    lastLogFlush = Clock::nowMs();
+
+    static uint8_t batch[LOG_REMOTE_BATCH];
+    size_t len = Log::takeRemoteBatch(batch, sizeof(batch));
+    if (len == 0)
+      return;
+
+    ArenaScope scope(arena);
+    const char *t = topic("/system/log");
+    if (!t)
+      return;
+    mqtt.beginPublish(t, len, false);
+    mqtt.write(batch, len);
+    mqtt.endPublish();
   }
+#endif
 
   String getDeviceId()
   {
@@ -300,7 +970,4 @@ public:
   }
 };
 
-// Inicializar puntero estático
-MqttManager *MqttManager::instance = nullptr;
-
 #endif
\ No newline at end of file
@@ -0,0 +1,458 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Heatshrink.h"
+#include "DeltaPatch.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "PowerManager.h"
+#include "Events.h"
+
+static Counter metricOtaUpdates("ota_updates", "Actualizaciones OTA aplicadas");
+static Counter metricOtaFailures("ota_failures", "Actualizaciones OTA fallidas");
+static Counter metricOtaRollbacks("ota_rollbacks", "Vueltas a la imagen anterior");
+static Gauge metricOtaDownloadBytes("ota_last_download_bytes", "Bytes descargados en la ultima OTA");
+static Gauge metricOtaFlashBytes("ota_last_flash_bytes", "Bytes escritos en flash en la ultima OTA");
+static Gauge metricOtaDurationMs("ota_last_duration_ms", "Duracion de la ultima OTA");
+
+// Sin esto el core de Arduino da la imagen por válida apenas arranca;
+// la confirmación la hace OtaUpdater cuando el sistema quedó sano
+extern "C" bool verifyRollbackLater()
+{
+  return true;
+}
+
+enum class OtaFormat : uint8_t
+{
+  FULL,       // Imagen tal cual
+  HEATSHRINK, // Imagen comprimida
+  DELTA       // Parche BSD1 comprimido contra la imagen en ejecución
+};
+
+enum class OtaState : uint8_t
+{
+  IDLE,
+  DOWNLOADING,
+  SUCCESS, // Imagen verificada, reinicia en OTA_RESTART_DELAY_MS
+  FAILED
+};
+
+struct OtaStatus
+{
+  OtaState state;
+  uint32_t downloaded; // Bytes recibidos por HTTP
+  uint32_t written;    // Bytes escritos en la partición
+  uint32_t total;      // Largo del recurso HTTP (0 si no se conoce)
+  uint32_t durationMs;
+  const char *error;
+};
+
+// Actualización A/B por OTA.
+// La imagen se descarga por HTTP en una tarea propia y pasa por una cadena
+// de etapas en streaming: HTTP -> heatshrink -> parche delta -> SHA-256 ->
+// partición inactiva. Recién con el hash verificado se cambia la partición
+// de arranque. La imagen nueva arranca a prueba: si no confirma (MQTT
+// conectado durante OTA_CONFIRM_MS) en OTA_TRIAL_BOOTS arranques, se vuelve
+// a la anterior.
+class OtaUpdater
+{
+private:
+  // Pedido en curso (copiado: el payload MQTT no sobrevive al callback)
+  char url[OTA_URL_MAX];
+  uint8_t expectedSha[32];
+  uint8_t baseSha[32];
+  bool checkBase;
+  OtaFormat format;
+
+  OtaStatus status;
+  uint32_t statusSeq;
+  portMUX_TYPE mux;
+  TaskHandle_t task;
+  uint64_t startMs;
+  uint64_t restartAtMs;
+
+  // Etapas de la cadena
+  HeatshrinkDecoder<OTA_HS_WINDOW_BITS, OTA_HS_LOOKAHEAD_BITS> decoder;
+  DeltaPatcher patcher;
+  mbedtls_sha256_context sha;
+  esp_ota_handle_t handle;
+  const esp_partition_t *target;
+  const esp_partition_t *running;
+  uint8_t chunk[1024];
+  uint8_t writeBuffer[OTA_WRITE_BUFFER];
+  size_t writeLen;
+  bool writeFailed;
+
+  // Arranque a prueba tras una OTA
+  Preferences prefs;
+  bool trial;
+  uint64_t healthySinceMs;
+
+  static bool hexToBytes(const char *hex, uint8_t *out, size_t len)
+  {
+    if (strlen(hex) != len * 2)
+      return false;
+    for (size_t i = 0; i < len; i++)
+    {
+      char byteHex[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+      char *end;
+      out[i] = (uint8_t)strtoul(byteHex, &end, 16);
+      if (*end != '\0')
+        return false;
+    }
+    return true;
+  }
+
+  void setStatus(OtaState state, const char *error)
+  {
+    portENTER_CRITICAL(&mux);
+    status.state = state;
+    status.error = error;
+    status.durationMs = (uint32_t)(Clock::nowMs() - startMs);
+    statusSeq++;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  void flushWrite()
+  {
+    if (writeLen == 0 || writeFailed)
+      return;
+    if (esp_ota_write(handle, writeBuffer, writeLen) != ESP_OK)
+      writeFailed = true;
+    status.written += writeLen;
+    writeLen = 0;
+  }
+
+  // Última etapa: hash y escritura por sectores completos
+  static void imageSink(const uint8_t *data, size_t len, void *ctx)
+  {
+    OtaUpdater *self = static_cast<OtaUpdater *>(ctx);
+    mbedtls_sha256_update_ret(&self->sha, data, len);
+    while (len > 0)
+    {
+      size_t n = min(len, sizeof(self->writeBuffer) - self->writeLen);
+      memcpy(self->writeBuffer + self->writeLen, data, n);
+      self->writeLen += n;
+      data += n;
+      len -= n;
+      if (self->writeLen == sizeof(self->writeBuffer))
+        self->flushWrite();
+    }
+  }
+
+  static void patchSink(const uint8_t *data, size_t len, void *ctx)
+  {
+    static_cast<OtaUpdater *>(ctx)->patcher.feed(data, len);
+  }
+
+  static bool baseReader(uint32_t offset, uint8_t *data, size_t len, void *ctx)
+  {
+    OtaUpdater *self = static_cast<OtaUpdater *>(ctx);
+    return esp_partition_read(self->running, offset, data, len) == ESP_OK;
+  }
+
+  void feed(const uint8_t *data, size_t len)
+  {
+    switch (format)
+    {
+    case OtaFormat::FULL:
+      imageSink(data, len, this);
+      break;
+    case OtaFormat::HEATSHRINK:
+    case OtaFormat::DELTA:
+      decoder.feed(data, len);
+      break;
+    }
+  }
+
+  static void taskEntry(void *arg)
+  {
+    OtaUpdater *self = static_cast<OtaUpdater *>(arg);
+    const char *error;
+    {
+      CpuBoost boost; // Descompresión, parche y SHA-256 de toda la imagen
+      error = self->download();
+    }
+    if (error)
+    {
+      metricOtaFailures.inc();
+      LOG_E("✗ OTA falló: %s", error);
+      self->setStatus(OtaState::FAILED, error);
+    }
+    else
+    {
+      metricOtaUpdates.inc();
+      LOG_I("✓ OTA verificada (%u bytes descargados, %u escritos, %u ms)",
+            self->status.downloaded, self->status.written, self->status.durationMs);
+      self->restartAtMs = Clock::nowMs() + OTA_RESTART_DELAY_MS;
+      self->setStatus(OtaState::SUCCESS, nullptr);
+    }
+
+    metricOtaDownloadBytes.set(self->status.downloaded);
+    metricOtaFlashBytes.set(self->status.written);
+    metricOtaDurationMs.set(self->status.durationMs);
+
+    self->task = nullptr;
+    vTaskDelete(nullptr);
+  }
+
+  // Devuelve nullptr si la imagen quedó escrita, verificada y activada
+  const char *download()
+  {
+    running = esp_ota_get_running_partition();
+    target = esp_ota_get_next_update_partition(nullptr);
+    if (!target)
+      return "sin particion OTA";
+
+    if (format == OtaFormat::DELTA && (!checkBase ||
+        memcmp(esp_ota_get_app_description()->app_elf_sha256, baseSha, 32) != 0))
+      return "el delta no corresponde a la imagen en ejecucion";
+
+    HTTPClient http;
+    http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+    if (!http.begin(url))
+      return "URL invalida";
+
+    int code = http.GET();
+    if (code != HTTP_CODE_OK)
+    {
+      http.end();
+      return "respuesta HTTP inesperada";
+    }
+
+    int size = http.getSize();
+    status.total = size > 0 ? size : 0;
+
+    if (esp_ota_begin(target, OTA_SIZE_UNKNOWN, &handle) != ESP_OK)
+    {
+      http.end();
+      return "esp_ota_begin";
+    }
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    writeLen = 0;
+    writeFailed = false;
+    decoder.reset(format == OtaFormat::DELTA ? patchSink : imageSink, this);
+    patcher.reset(running->size, baseReader, imageSink, this);
+
+    // Bucle de descarga: cada fragmento recorre toda la cadena
+    WiFiClient *stream = http.getStreamPtr();
+    uint64_t lastDataMs = Clock::nowMs();
+    const char *error = nullptr;
+    while (!error && (size < 0 || status.downloaded < (uint32_t)size))
+    {
+      size_t available = stream->available();
+      if (available == 0)
+      {
+        if (!http.connected() && size < 0)
+          break; // Fin del cuerpo sin Content-Length
+        if (Clock::nowMs() - lastDataMs > OTA_HTTP_TIMEOUT_MS)
+          error = "timeout de descarga";
+        delay(1);
+        continue;
+      }
+
+      int n = stream->readBytes(chunk, min(available, sizeof(chunk)));
+      lastDataMs = Clock::nowMs();
+      portENTER_CRITICAL(&mux);
+      status.downloaded += n;
+      if (status.downloaded % OTA_PROGRESS_BYTES < (uint32_t)n)
+        statusSeq++;
+      portEXIT_CRITICAL(&mux);
+
+      feed(chunk, n);
+      if (writeFailed)
+        error = "escritura en flash";
+      else if (patcher.hasFailed())
+        error = "parche invalido";
+    }
+    http.end();
+    flushWrite();
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (!error && writeFailed)
+      error = "escritura en flash";
+    if (!error && format == OtaFormat::DELTA && !patcher.isDone())
+      error = "parche incompleto";
+    if (!error && memcmp(digest, expectedSha, sizeof(digest)) != 0)
+      error = "SHA-256 no coincide";
+
+    if (error)
+    {
+      esp_ota_abort(handle);
+      return error;
+    }
+
+    // esp_ota_end valida además la estructura de la imagen
+    if (esp_ota_end(handle) != ESP_OK)
+      return "imagen invalida";
+    if (esp_ota_set_boot_partition(target) != ESP_OK)
+      return "esp_ota_set_boot_partition";
+
+    prefs.putBool("pending", true);
+    prefs.putUChar("boots", 0);
+    return nullptr;
+  }
+
+  void rollback()
+  {
+    const esp_partition_t *previous = esp_ota_get_next_update_partition(nullptr);
+    prefs.putBool("pending", false);
+    metricOtaRollbacks.inc();
+    LOG_E("↩️ Imagen nueva sin confirmar, volviendo a %s", previous ? previous->label : "?");
+    if (previous && esp_ota_set_boot_partition(previous) == ESP_OK)
+    {
+      delay(100);
+      ESP.restart();
+    }
+  }
+
+  static OtaUpdater *instance; // Destino de los comandos OTA
+
+public:
+  OtaUpdater()
+      : checkBase(false), format(OtaFormat::FULL), statusSeq(0), task(nullptr),
+        startMs(0), restartAtMs(0), handle(0), target(nullptr), running(nullptr),
+        writeLen(0), writeFailed(false), trial(false), healthySinceMs(0)
+  {
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    memset(&status, 0, sizeof(status));
+    url[0] = '\0';
+    instance = this;
+  }
+
+  // Llamar temprano en setup(): decide si la imagen actual está a prueba
+  void begin()
+  {
+    prefs.begin("ota", false);
+    if (!prefs.getBool("pending", false))
+      return;
+
+    uint8_t boots = prefs.getUChar("boots", 0) + 1;
+    prefs.putUChar("boots", boots);
+    if (boots > OTA_TRIAL_BOOTS)
+    {
+      rollback();
+      return;
+    }
+
+    trial = true;
+    LOG_W("🧪 Imagen OTA a prueba (arranque %u de %u)", boots, OTA_TRIAL_BOOTS);
+  }
+
+  // format: "full", "heatshrink" o "delta"; sha256 y base en hex
+  bool request(const char *newUrl, const char *sha256, const char *formatStr, const char *base)
+  {
+    if (task)
+    {
+      LOG_W("⚠️ OTA en curso, se ignora el pedido");
+      return false;
+    }
+
+    if (strcmp(formatStr, "heatshrink") == 0)
+      format = OtaFormat::HEATSHRINK;
+    else if (strcmp(formatStr, "delta") == 0)
+      format = OtaFormat::DELTA;
+    else
+      format = OtaFormat::FULL;
+
+    memset(&status, 0, sizeof(status));
+    startMs = Clock::nowMs();
+
+    if (strlen(newUrl) >= sizeof(url) || !hexToBytes(sha256, expectedSha, sizeof(expectedSha)))
+    {
+      setStatus(OtaState::FAILED, "pedido invalido");
+      return false;
+    }
+    strcpy(url, newUrl);
+    checkBase = hexToBytes(base, baseSha, sizeof(baseSha));
+
+    LOG_I("⬇️ OTA %s desde %s", formatStr, url);
+    setStatus(OtaState::DOWNLOADING, nullptr);
+    xTaskCreatePinnedToCore(taskEntry, "ota", OTA_TASK_STACK, this, 1, &task, 0);
+    return true;
+  }
+
+  // Confirma la imagen a prueba y reinicia tras una OTA exitosa
+  void loop(bool healthy)
+  {
+    uint64_t now = Clock::nowMs();
+
+    if (trial)
+    {
+      if (!healthy)
+      {
+        healthySinceMs = 0;
+      }
+      else if (healthySinceMs == 0)
+      {
+        healthySinceMs = now;
+      }
+      else if (now - healthySinceMs >= OTA_CONFIRM_MS)
+      {
+        trial = false;
+        prefs.putBool("pending", false);
+        esp_ota_mark_app_valid_cancel_rollback();
+        LOG_I("✓ Imagen OTA confirmada");
+      }
+    }
+
+    if (status.state == OtaState::SUCCESS && now >= restartAtMs)
+    {
+      LOG_W("🔄 Reiniciando en la imagen nueva...");
+      delay(100);
+      ESP.restart();
+    }
+  }
+
+  // Copia del estado si cambió desde la última consulta
+  bool pollStatus(OtaStatus &out, uint32_t &lastSeq)
+  {
+    portENTER_CRITICAL(&mux);
+    bool changed = statusSeq != lastSeq;
+    out = status;
+    lastSeq = statusSeq;
+    portEXIT_CRITICAL(&mux);
+    return changed;
+  }
+
+  bool isTrial() const { return trial; }
+
+  static const char *stateStr(OtaState state)
+  {
+    switch (state)
+    {
+    case OtaState::DOWNLOADING:
+      return "downloading";
+    case OtaState::SUCCESS:
+      return "success";
+    case OtaState::FAILED:
+      return "failed";
+    default:
+      return "idle";
+    }
+  }
+
+  static bool onCommandEvent(const OtaCommandEvent &event)
+  {
+    LOG_I("📦 Comando OTA recibido: %s (%s)", event.url, event.format);
+    return instance && instance->request(event.url, event.sha256, event.format, event.baseSha256);
+  }
+};
+
+OtaUpdater *OtaUpdater::instance = nullptr;
+
+EVENT_SUBSCRIBE(OtaCommandEvent, 0, OtaUpdater::onCommandEvent);
+
+#endif
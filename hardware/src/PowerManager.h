@@ -0,0 +1,128 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <sdkconfig.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+#include "Config.h"
+#include "Clock.h"
+#include "Log.h"
+
+// Escalado dinámico de frecuencia de CPU.
+// En reposo la CPU corre a CPU_FREQ_MIN_MHZ; las secciones pesadas o con
+// temporización por software (handshake TLS, JSON grandes, IR, DHT, OTA,
+// arranque) piden CPU_FREQ_MAX_MHZ con un CpuBoost mientras duran.
+// Si el core trae CONFIG_PM_ENABLE se usa un lock ESP_PM_CPU_FREQ_MAX de
+// ESP-IDF (DFS); si no, se cambia la frecuencia con setCpuFrequencyMhz()
+// al tomar el primer boost y al soltar el último.
+// No bajar de 80 MHz: por debajo cambia el APB y con él UART y LEDC.
+class PowerManager
+{
+private:
+  static SemaphoreHandle_t mutex;
+  static uint32_t boosts;      // Secciones activas (anidables, varias tareas)
+  static uint64_t startUs;
+  static uint64_t boostSinceUs;
+  static uint64_t boostedUs;   // Tiempo acumulado a frecuencia máxima
+  static bool useIdfPm;
+#if CONFIG_PM_ENABLE
+  static esp_pm_lock_handle_t pmLock;
+#endif
+
+public:
+  static void begin()
+  {
+    mutex = xSemaphoreCreateMutex();
+    startUs = Clock::nowUs();
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = CPU_FREQ_MAX_MHZ;
+    config.min_freq_mhz = CPU_FREQ_MIN_MHZ;
+    config.light_sleep_enable = false;
+    useIdfPm = esp_pm_configure(&config) == ESP_OK &&
+               esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "boost", &pmLock) == ESP_OK;
+#endif
+    if (!useIdfPm)
+      setCpuFrequencyMhz(CPU_FREQ_MIN_MHZ);
+
+    LOG_I("⚡ Frecuencia CPU %u-%u MHz (%s)", CPU_FREQ_MIN_MHZ, CPU_FREQ_MAX_MHZ,
+          useIdfPm ? "PM de ESP-IDF" : "manual");
+  }
+
+  static void acquire()
+  {
+    if (!mutex)
+      return; // Antes de begin() ya corre a frecuencia máxima
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (boosts++ == 0)
+    {
+      boostSinceUs = Clock::nowUs();
+#if CONFIG_PM_ENABLE
+      if (useIdfPm)
+        esp_pm_lock_acquire(pmLock);
+#endif
+      if (!useIdfPm)
+        setCpuFrequencyMhz(CPU_FREQ_MAX_MHZ);
+    }
+    xSemaphoreGive(mutex);
+  }
+
+  static void release()
+  {
+    if (!mutex)
+      return;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (boosts > 0 && --boosts == 0)
+    {
+      boostedUs += Clock::nowUs() - boostSinceUs;
+#if CONFIG_PM_ENABLE
+      if (useIdfPm)
+        esp_pm_lock_release(pmLock);
+#endif
+      if (!useIdfPm)
+        setCpuFrequencyMhz(CPU_FREQ_MIN_MHZ);
+    }
+    xSemaphoreGive(mutex);
+  }
+
+  // Tiempo desde begin() a cada frecuencia, en ms
+  static void getTimes(uint64_t &maxFreqMs, uint64_t &minFreqMs)
+  {
+    uint64_t now = Clock::nowUs();
+    uint64_t boosted = boostedUs;
+    if (mutex)
+    {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+      boosted = boostedUs + (boosts > 0 ? now - boostSinceUs : 0);
+      xSemaphoreGive(mutex);
+    }
+    maxFreqMs = boosted / 1000;
+    minFreqMs = (now - startUs - boosted) / 1000;
+  }
+};
+
+// Inicializar miembros estáticos
+SemaphoreHandle_t PowerManager::mutex = nullptr;
+uint32_t PowerManager::boosts = 0;
+uint64_t PowerManager::startUs = 0;
+uint64_t PowerManager::boostSinceUs = 0;
+uint64_t PowerManager::boostedUs = 0;
+bool PowerManager::useIdfPm = false;
+#if CONFIG_PM_ENABLE
+esp_pm_lock_handle_t PowerManager::pmLock = nullptr;
+#endif
+
+// Frecuencia máxima mientras dura el bloque
+class CpuBoost
+{
+public:
+  CpuBoost() { PowerManager::acquire(); }
+  ~CpuBoost() { PowerManager::release(); }
+};
+
+#endif
@@ -2,7 +2,13 @@
 #define RGB_LED_H
 
 #include <Arduino.h>
+#include "Metrics.h"
+#include "Log.h"
 
+static Counter metricLedWrites("led_pwm_writes", "Escrituras a los canales PWM del LED");
+
+// Salida PWM del LED RGB. Solo escribe los canales que cambian; quién
+// decide el color es LedCompositor.
 class RgbLed
 {
 private:
@@ -17,11 +23,19 @@ private:
   uint8_t currentR;
   uint8_t currentG;
   uint8_t currentB;
-  bool enabledFeedback = true;
 
   static const uint16_t PWM_FREQ = 5000;
   static const uint8_t PWM_RESOLUTION = 8;
 
+  static void writeChannel(uint8_t channel, uint8_t &current, uint8_t value)
+  {
+    if (current == value)
+      return;
+    current = value;
+    ledcWrite(channel, value);
+    metricLedWrites.inc();
+  }
+
 public:
   RgbLed(uint8_t red, uint8_t green, uint8_t blue,
          uint8_t chRed = 0, uint8_t chGreen = 1, uint8_t chBlue = 2)
@@ -42,61 +56,27 @@ public:
     ledcAttachPin(pinBlue, channelBlue);
 
     // Apagar el LED al inicio
-    setColor(0, 0, 0);
+    ledcWrite(channelRed, 0);
+    ledcWrite(channelGreen, 0);
+    ledcWrite(channelBlue, 0);
+    currentR = currentG = currentB = 0;
 
-    Serial.println("✓ LED RGB iniciado");
-  }
-
-  void setEnabledFeedback(bool enabled)
-  {
-    enabledFeedback = enabled;
+    LOG_I("✓ LED RGB iniciado");
   }
 
   void setColor(uint8_t red, uint8_t green, uint8_t blue)
   {
-    if (!enabledFeedback)
-      return;
-
-    currentR = red;
-    currentG = green;
-    currentB = blue;
-
-    ledcWrite(channelRed, red);
-    ledcWrite(channelGreen, green);
-    ledcWrite(channelBlue, blue);
+    writeChannel(channelRed, currentR, red);
+    writeChannel(channelGreen, currentG, green);
+    writeChannel(channelBlue, currentB, blue);
   }
 
-  void getColor(uint8_t &red, uint8_t &green, uint8_t &blue)
+  void getColor(uint8_t &red, uint8_t &green, uint8_t &blue) const
   {
     red = currentR;
     green = currentG;
     blue = currentB;
   }
-
-  // Colores predefinidos
-  void setRojo() { setColor(255, 0, 0); }
-  void setVerde() { setColor(0, 255, 0); }
-  void setAzul() { setColor(0, 0, 255); }
-  void setAmarillo() { setColor(255, 255, 0); }
-  void setMagenta() { setColor(255, 0, 255); }
-  void setCian() { setColor(0, 255, 255); }
-  void setBlanco() { setColor(255, 255, 255); }
-  void setApagado() { setColor(0, 0, 0); }
-
-  // Efecto de parpadeo
-  void blink(uint8_t r, uint8_t g, uint8_t b, int times = 3, int delayMs = 200)
-  {
-    if (!enabledFeedback)
-      return;
-
-    for (int i = 0; i < times; i++)
-    {
-      setColor(r, g, b);
-      delay(delayMs);
-      setApagado();
-      delay(delayMs);
-    }
-  }
 };
 
-#endif
\ No newline at end of file
+#endif
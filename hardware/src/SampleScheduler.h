@@ -0,0 +1,158 @@
+#ifndef SAMPLE_SCHEDULER_H
+#define SAMPLE_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Clock.h"
+
+// Estadísticas de temporización del muestreo
+struct SamplingStats
+{
+  uint32_t samples;
+  uint32_t missed;          // Slots perdidos por llegar tarde
+  int32_t lastAlignErrorMs; // Muestra real - slot UTC nominal
+  int32_t maxAlignErrorMs;
+  uint32_t lastLatenessUs;  // Despertar real - deadline
+  uint32_t maxLatenessUs;
+  float meanLatenessUs;
+  float m2LatenessUs;       // Acumulador de Welford para la varianza
+
+  SamplingStats() { reset(); }
+
+  void reset()
+  {
+    samples = 0;
+    missed = 0;
+    lastAlignErrorMs = 0;
+    maxAlignErrorMs = 0;
+    lastLatenessUs = 0;
+    maxLatenessUs = 0;
+    meanLatenessUs = 0;
+    m2LatenessUs = 0;
+  }
+
+  void recordLateness(uint32_t latenessUs)
+  {
+    samples++;
+    lastLatenessUs = latenessUs;
+    if (latenessUs > maxLatenessUs)
+      maxLatenessUs = latenessUs;
+
+    float delta = latenessUs - meanLatenessUs;
+    meanLatenessUs += delta / samples;
+    m2LatenessUs += delta * (latenessUs - meanLatenessUs);
+  }
+
+  // Desvío estándar de la latencia = jitter del muestreo
+  float jitterUs() const
+  {
+    return samples > 1 ? sqrtf(m2LatenessUs / (samples - 1)) : 0;
+  }
+};
+
+// Planificador del muestreo.
+// En modo alineado las muestras caen en múltiplos UTC del intervalo
+// (ej. :00 y :30 con 30 s), iguales en todos los dispositivos, y el
+// timestamp publicado es el del slot nominal. Sin hora NTP todavía,
+// funciona en modo libre relativo al arranque. En ambos modos los
+// deadlines son absolutos, así que un despertar tardío no corre los siguientes.
+// El intervalo nunca baja de SENSOR_MIN_READ_INTERVAL_MS (con 0 el modo
+// alineado dividiría por cero y el libre no saldría nunca de schedule()).
+class SampleScheduler
+{
+private:
+  uint32_t intervalMs;
+  bool aligned;
+
+  uint64_t nextDueUs;   // Próxima muestra (µs monotónicos)
+  uint64_t slotUtcMs;   // Slot UTC de la próxima muestra (0 = no alineada)
+
+  SamplingStats stats;
+
+  void schedule(uint64_t nowUs)
+  {
+    uint64_t intervalUs = (uint64_t)intervalMs * 1000;
+
+    if (aligned && Clock::isSynced())
+    {
+      uint64_t utcNow = Clock::toUtcMs(nowUs);
+      uint64_t nextSlot = (utcNow / intervalMs + 1) * intervalMs;
+      // Un paso atrás de SNTP puede dejar utcNow antes del slot recién
+      // tomado: sin el tope se muestrearía (y publicaría) el mismo slot dos veces
+      if (slotUtcMs != 0 && nextSlot < slotUtcMs + intervalMs)
+        nextSlot = slotUtcMs + intervalMs;
+      if (slotUtcMs != 0 && nextSlot > slotUtcMs + intervalMs)
+        stats.missed += (nextSlot - slotUtcMs) / intervalMs - 1;
+
+      slotUtcMs = nextSlot;
+      nextDueUs = nowUs + (slotUtcMs - utcNow) * 1000;
+    }
+    else
+    {
+      slotUtcMs = 0;
+      nextDueUs += intervalUs;
+      while (nextDueUs <= nowUs)
+      {
+        nextDueUs += intervalUs;
+        stats.missed++;
+      }
+    }
+  }
+
+  static uint32_t clampInterval(uint32_t interval)
+  {
+    return interval < SENSOR_MIN_READ_INTERVAL_MS ? SENSOR_MIN_READ_INTERVAL_MS : interval;
+  }
+
+public:
+  SampleScheduler(uint32_t interval, bool alignToUtc)
+      : intervalMs(clampInterval(interval)), aligned(alignToUtc), nextDueUs(0), slotUtcMs(0) {}
+
+  // La primera muestra es inmediata; las siguientes se alinean
+  void begin()
+  {
+    nextDueUs = Clock::nowUs();
+    slotUtcMs = 0;
+  }
+
+  // Reinicia la planificación desde ahora con el nuevo intervalo
+  void setInterval(uint32_t interval)
+  {
+    uint64_t nowUs = Clock::nowUs();
+    intervalMs = clampInterval(interval);
+    nextDueUs = nowUs;
+    slotUtcMs = 0;
+    schedule(nowUs);
+  }
+
+  bool isDue(uint64_t nowUs) const
+  {
+    return nowUs >= nextDueUs;
+  }
+
+  // Marca la muestra tomada en nowUs y devuelve su timestamp UTC (ms)
+  uint64_t markSampled(uint64_t nowUs)
+  {
+    uint64_t timestamp = Clock::toUtcMs(nowUs);
+
+    if (slotUtcMs != 0)
+    {
+      stats.lastAlignErrorMs = (int32_t)((int64_t)timestamp - (int64_t)slotUtcMs);
+      int32_t absError = stats.lastAlignErrorMs < 0 ? -stats.lastAlignErrorMs : stats.lastAlignErrorMs;
+      if (absError > stats.maxAlignErrorMs)
+        stats.maxAlignErrorMs = absError;
+      timestamp = slotUtcMs;
+    }
+
+    // Si el NTP se sincroniza recién ahora, la siguiente muestra ya cae alineada
+    schedule(nowUs);
+    return timestamp;
+  }
+
+  uint64_t getNextDueUs() const { return nextDueUs; }
+  uint32_t getInterval() const { return intervalMs; }
+  bool isAligned() const { return aligned && slotUtcMs != 0; }
+  SamplingStats &getStats() { return stats; }
+};
+
+#endif
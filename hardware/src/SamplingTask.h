@@ -0,0 +1,265 @@
+#ifndef SAMPLING_TASK_H
+#define SAMPLING_TASK_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "Config.h"
+#include "Clock.h"
+#include "SampleScheduler.h"
+#include "SensorFusion.h"
+#include "Log.h"
+#include "Metrics.h"
+
+static Counter metricSensorConversions("sensor_conversions", "Adquisiciones reales del bus de sensores");
+static Counter metricSensorCacheHits("sensor_cache_hits", "Lecturas servidas desde la cache sin tocar el bus");
+
+// Resultado de una adquisición, entregado a loop() por cola
+struct SampleResult
+{
+  uint64_t timestampMs; // UTC del slot de muestreo
+  float temperatura;
+  float humedad;
+  bool ok;
+  bool sensorError;     // Todos los sensores con errores consecutivos
+};
+
+// Última adquisición, compartida con todos los consumidores
+struct SensorReading
+{
+  uint64_t timestampMs; // UTC de la adquisición
+  uint64_t monoMs;      // Clock::nowMs() de la adquisición, para la antigüedad
+  float temperatura;
+  float humedad;
+  bool ok;
+  bool valid;           // Hubo al menos una adquisición
+};
+
+// Muestreo disparado por esp_timer.
+// El timer (one-shot, rearmado al deadline absoluto siguiente) notifica a
+// una tarea dedicada que lee el sensor y deja el resultado en una cola.
+// Así el período no depende de que loop() esté bloqueado por IR, MQTT o LED.
+// La tarea es la única dueña del bus: cualquier otro consumidor pide la
+// lectura con latest()/requestRead() y recibe la cache. Las peticiones que llegan
+// juntas se unen en una sola conversión (bits de notificación) y nunca se
+// lee antes de SENSOR_MIN_READ_INTERVAL_MS desde la anterior; si el timer
+// vence dentro de ese margen, la muestra sale de la cache.
+class SamplingTask
+{
+private:
+  static const uint32_t NOTIFY_SAMPLE = 1 << 0;
+  static const uint32_t NOTIFY_RECONFIG = 1 << 1;
+  static const uint32_t NOTIFY_READ = 1 << 2;
+
+  SensorFusion &sensor;
+  SampleScheduler scheduler;
+
+  esp_timer_handle_t timer;
+  TaskHandle_t task;
+  QueueHandle_t results;
+  portMUX_TYPE mux;
+
+  volatile uint32_t pendingInterval;
+  uint32_t droppedResults;
+
+  SensorReading cached;
+  volatile uint32_t generation; // Se incrementa con cada conversión
+
+  // Convierte si la cache venció el intervalo mínimo del sensor
+  void acquire()
+  {
+    portENTER_CRITICAL(&mux);
+    bool fresh = cached.valid && Clock::nowMs() - cached.monoMs < SENSOR_MIN_READ_INTERVAL_MS;
+    portEXIT_CRITICAL(&mux);
+    if (fresh)
+    {
+      metricSensorCacheHits.inc();
+      return;
+    }
+
+    SensorReading reading;
+    reading.ok = sensor.leer();
+    reading.temperatura = sensor.getTemperatura();
+    reading.humedad = sensor.getHumedad();
+    reading.monoMs = Clock::nowMs();
+    reading.timestampMs = Clock::utcMs();
+    reading.valid = true;
+    metricSensorConversions.inc();
+
+    if (reading.ok)
+      sensor.imprimirDatos();
+
+    portENTER_CRITICAL(&mux);
+    cached = reading;
+    generation++;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  static void onTimer(void *arg)
+  {
+    SamplingTask *self = static_cast<SamplingTask *>(arg);
+    xTaskNotify(self->task, NOTIFY_SAMPLE, eSetBits);
+  }
+
+  static void taskEntry(void *arg)
+  {
+    static_cast<SamplingTask *>(arg)->run();
+  }
+
+  void arm()
+  {
+    uint64_t now = Clock::nowUs();
+    uint64_t due = scheduler.getNextDueUs();
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, due > now ? due - now : 1);
+  }
+
+  void run()
+  {
+    arm();
+
+    for (;;)
+      serviceOnce(portMAX_DELAY);
+  }
+
+public:
+  // Una vuelta de la tarea: esperar avisos y atenderlos. Cada aviso se
+  // consume al salir de la espera. Devuelve false si venció wait sin
+  // avisos (el banco la llama con wait 0, sin tarea)
+  bool serviceOnce(TickType_t wait)
+  {
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, NOTIFY_SAMPLE | NOTIFY_RECONFIG | NOTIFY_READ, &bits, wait) != pdTRUE)
+      return false;
+
+    if (bits & NOTIFY_RECONFIG)
+    {
+      portENTER_CRITICAL(&mux);
+      scheduler.setInterval(pendingInterval);
+      portEXIT_CRITICAL(&mux);
+      arm();
+    }
+
+    // Con una muestra en el mismo aviso, la lectura a pedido sale de su conversión
+    if ((bits & NOTIFY_READ) && !(bits & NOTIFY_SAMPLE))
+      acquire();
+
+    if (!(bits & NOTIFY_SAMPLE))
+      return true;
+
+    uint64_t now = Clock::nowUs();
+    uint64_t due = scheduler.getNextDueUs();
+
+    portENTER_CRITICAL(&mux);
+    scheduler.getStats().recordLateness(now > due ? (uint32_t)(now - due) : 0);
+    SampleResult result;
+    result.timestampMs = scheduler.markSampled(now);
+    portEXIT_CRITICAL(&mux);
+
+    // Rearmar antes de leer: la lectura del DHT no corre el próximo deadline
+    arm();
+
+    acquire();
+    portENTER_CRITICAL(&mux);
+    result.ok = cached.ok;
+    result.temperatura = cached.temperatura;
+    result.humedad = cached.humedad;
+    portEXIT_CRITICAL(&mux);
+    result.sensorError = sensor.hayErrores();
+
+    if (xQueueSend(results, &result, 0) != pdTRUE)
+      droppedResults++;
+    return true;
+  }
+
+  SamplingTask(SensorFusion &sensor, uint32_t intervalMs, bool alignToUtc)
+      : sensor(sensor), scheduler(intervalMs, alignToUtc),
+        timer(nullptr), task(nullptr), results(nullptr),
+        pendingInterval(intervalMs), droppedResults(0), generation(0)
+  {
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    memset(&cached, 0, sizeof(cached));
+  }
+
+  void begin()
+  {
+    results = xQueueCreate(SAMPLE_QUEUE_LEN, sizeof(SampleResult));
+
+    esp_timer_create_args_t args = {};
+    args.callback = onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "sampler";
+    esp_timer_create(&args, &timer);
+
+    scheduler.begin();
+    xTaskCreatePinnedToCore(taskEntry, "sensing", SAMPLING_TASK_STACK, this,
+                            SAMPLING_TASK_PRIORITY, &task, 1);
+
+    LOG_I("✓ Muestreo por timer iniciado");
+  }
+
+  // Cambiar el intervalo (se aplica en la tarea de muestreo)
+  void setInterval(uint32_t intervalMs)
+  {
+    pendingInterval = intervalMs;
+    xTaskNotify(task, NOTIFY_RECONFIG, eSetBits);
+  }
+
+  // Obtener el siguiente resultado pendiente sin bloquear
+  bool poll(SampleResult &out)
+  {
+    return xQueueReceive(results, &out, 0) == pdTRUE;
+  }
+
+  // Última lectura en cache, sin bloquear ni tocar el bus
+  SensorReading latest()
+  {
+    portENTER_CRITICAL(&mux);
+    SensorReading copy = cached;
+    portEXIT_CRITICAL(&mux);
+    return copy;
+  }
+
+  // Lectura con antigüedad máxima maxAgeMs (nunca menor al intervalo
+  // mínimo del sensor), sin bloquear. Devuelve true si la cache alcanza
+  // (out tiene la lectura); si no pide una conversión y deja en ticket el
+  // valor a pasar a readDone(). Varios pedidos simultáneos comparten la
+  // misma conversión.
+  bool requestRead(SensorReading &out, uint32_t maxAgeMs, uint32_t &ticket)
+  {
+    if (maxAgeMs < SENSOR_MIN_READ_INTERVAL_MS)
+      maxAgeMs = SENSOR_MIN_READ_INTERVAL_MS;
+
+    out = latest();
+    if (out.valid && Clock::nowMs() - out.monoMs <= maxAgeMs)
+    {
+      metricSensorCacheHits.inc();
+      return true;
+    }
+
+    ticket = generation;
+    xTaskNotify(task, NOTIFY_READ, eSetBits);
+    return false;
+  }
+
+  // true cuando terminó una conversión posterior al pedido de requestRead()
+  bool readDone(uint32_t ticket, SensorReading &out)
+  {
+    if (generation == ticket)
+      return false;
+    out = latest();
+    return true;
+  }
+
+  SamplingStats getStats()
+  {
+    portENTER_CRITICAL(&mux);
+    SamplingStats copy = scheduler.getStats();
+    portEXIT_CRITICAL(&mux);
+    return copy;
+  }
+
+  uint32_t getDroppedResults() const { return droppedResults; }
+};
+
+#endif
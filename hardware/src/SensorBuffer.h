@@ -79,11 +79,30 @@ public:
     return maxVal;
   }
 
+  // i-ésimo elemento más antiguo (0 = el más viejo)
+  const T &at(size_t i) const
+  {
+    size_t start = (head + N - count) % N;
+    return buffer[(start + i) % N];
+  }
+
+  // Descartar el más antiguo (el de at(0))
+  void dropOldest()
+  {
+    if (count > 0)
+      count--;
+  }
+
   bool isFull() const
   {
     return count == N;
   }
 
+  size_t capacity() const
+  {
+    return N;
+  }
+
   size_t size() const
   {
     return count;
@@ -0,0 +1,251 @@
+#ifndef SENSOR_FUSION_H
+#define SENSOR_FUSION_H
+
+#include <Arduino.h>
+#include <new>
+#include "Config.h"
+#include "TemperatureSensor.h"
+#include "Metrics.h"
+#include "Log.h"
+
+static Gauge metricFusionSensorsOk("fusion_sensors_ok", "Sensores que aportaron a la ultima medicion fusionada");
+
+// Aporte de un sensor a la última medición
+struct SensorContribution
+{
+  uint8_t pin;
+  bool ok;
+  float temperatura;
+  float humedad;
+  float pesoTemp;     // Fracción del peso total (0..1)
+  float pesoHum;
+  uint8_t salud;      // 0..100
+};
+
+struct FusionSnapshot
+{
+  uint8_t count;
+  uint8_t sensorsOk;
+  SensorContribution sensors[SENSOR_MAX];
+};
+
+// Fusión de varios DHT de una misma habitación.
+// Cada sensor pesa 1 / (varianza base + varianza de sus residuos), con el
+// residuo medido contra la fusión de los demás (leave-one-out) para que un
+// sensor que deriva no se tape a sí mismo. Un sensor que no responde queda
+// fuera de esa medición y los pesos se renormalizan entre los que quedan,
+// así una falla individual no interrumpe control ni telemetría.
+// Expone la misma interfaz que TemperatureSensor (leer, getTemperatura,
+// hayErrores...) para que SamplingTask no distinga uno de varios.
+class SensorFusion
+{
+private:
+  struct State
+  {
+    float varTemp;      // EWMA del residuo al cuadrado
+    float varHum;
+    float fiabilidad;   // EWMA de lecturas exitosas (0..1)
+    bool ok;
+    float pesoTemp;
+    float pesoHum;
+  };
+
+  // Los sensores viven en almacenamiento estático (sin heap)
+  alignas(TemperatureSensor) uint8_t storage[SENSOR_MAX][sizeof(TemperatureSensor)];
+  TemperatureSensor *sensors[SENSOR_MAX];
+  State state[SENSOR_MAX];
+  size_t count;
+
+  float ultimaTemperatura;
+  float ultimaHumedad;
+  uint8_t sensorsOk;
+  portMUX_TYPE mux;
+
+  static float weight(float baseVar, float var)
+  {
+    return 1.0f / (baseVar + var);
+  }
+
+  static void updateResiduals(float *values, float *vars, float *weights, size_t n, const bool *ok, float baseVar)
+  {
+    float sumW = 0;
+    float sumWX = 0;
+    size_t nOk = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      if (!ok[i])
+        continue;
+      sumW += weights[i];
+      sumWX += weights[i] * values[i];
+      nOk++;
+    }
+    // Con dos sensores el residuo es el mismo para ambos y no se sabe cuál
+    // se desvió: se conservan las varianzas aprendidas con tres o más
+    if (nOk < 3)
+      return;
+
+    for (size_t i = 0; i < n; i++)
+    {
+      if (!ok[i])
+        continue;
+      float others = (sumWX - weights[i] * values[i]) / (sumW - weights[i]);
+      float r = values[i] - others;
+      // Un residuo aislado enorme no debe hundir al sensor de golpe
+      float r2 = fminf(r * r, FUSION_RESIDUAL_CLAMP * baseVar);
+      vars[i] += FUSION_RESIDUAL_ALPHA * (r2 - vars[i]);
+    }
+  }
+
+public:
+  SensorFusion(const uint8_t *pins, const int8_t *powerPins, size_t n)
+      : count(n > SENSOR_MAX ? SENSOR_MAX : n), ultimaTemperatura(NAN), ultimaHumedad(NAN), sensorsOk(0)
+  {
+    // Calibración propia por sensor: "cal" para el primero, "cal1", ...
+    static const char *const calNamespaces[] = {"cal", "cal1", "cal2", "cal3"};
+    static_assert(SENSOR_MAX <= sizeof(calNamespaces) / sizeof(calNamespaces[0]), "faltan namespaces de calibración");
+
+    for (size_t i = 0; i < count; i++)
+    {
+      sensors[i] = new (storage[i]) TemperatureSensor(pins[i], DHT22, calNamespaces[i], powerPins[i]);
+      state[i] = {0, 0, 1.0f, false, 0, 0};
+    }
+    mux = portMUX_INITIALIZER_UNLOCKED;
+  }
+
+  void begin()
+  {
+    for (size_t i = 0; i < count; i++)
+      sensors[i]->begin();
+    LOG_I("✓ Fusión de %u sensores", (unsigned)count);
+  }
+
+  // Lee todos los sensores y fusiona; false solo si no respondió ninguno
+  bool leer()
+  {
+    float temps[SENSOR_MAX];
+    float hums[SENSOR_MAX];
+    float wTemp[SENSOR_MAX];
+    float wHum[SENSOR_MAX];
+    bool ok[SENSOR_MAX];
+    float sumWT = 0, sumWTX = 0, sumWH = 0, sumWHX = 0;
+    uint8_t nOk = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      ok[i] = sensors[i]->leer();
+      State &s = state[i];
+      s.fiabilidad += FUSION_RESIDUAL_ALPHA * ((ok[i] ? 1.0f : 0.0f) - s.fiabilidad);
+      if (!ok[i])
+        continue;
+
+      temps[i] = sensors[i]->getTemperatura();
+      hums[i] = sensors[i]->getHumedad();
+      wTemp[i] = weight(FUSION_TEMP_BASE_VAR, s.varTemp);
+      wHum[i] = weight(FUSION_HUM_BASE_VAR, s.varHum);
+      sumWT += wTemp[i];
+      sumWTX += wTemp[i] * temps[i];
+      sumWH += wHum[i];
+      sumWHX += wHum[i] * hums[i];
+      nOk++;
+    }
+
+    float varTemp[SENSOR_MAX];
+    float varHum[SENSOR_MAX];
+    for (size_t i = 0; i < count; i++)
+    {
+      varTemp[i] = state[i].varTemp;
+      varHum[i] = state[i].varHum;
+    }
+    updateResiduals(temps, varTemp, wTemp, count, ok, FUSION_TEMP_BASE_VAR);
+    updateResiduals(hums, varHum, wHum, count, ok, FUSION_HUM_BASE_VAR);
+
+    portENTER_CRITICAL(&mux);
+    for (size_t i = 0; i < count; i++)
+    {
+      State &s = state[i];
+      s.varTemp = varTemp[i];
+      s.varHum = varHum[i];
+      s.ok = ok[i];
+      s.pesoTemp = ok[i] ? wTemp[i] / sumWT : 0;
+      s.pesoHum = ok[i] ? wHum[i] / sumWH : 0;
+    }
+    sensorsOk = nOk;
+    if (nOk > 0)
+    {
+      ultimaTemperatura = sumWTX / sumWT;
+      ultimaHumedad = sumWHX / sumWH;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    metricFusionSensorsOk.set(nOk);
+    if (nOk > 0 && nOk < count)
+      LOG_W("⚠️ Fusión con %u de %u sensores", nOk, (unsigned)count);
+    return nOk > 0;
+  }
+
+  float getTemperatura() const
+  {
+    return ultimaTemperatura;
+  }
+
+  float getHumedad() const
+  {
+    return ultimaHumedad;
+  }
+
+  // Todos los sensores con errores consecutivos: la habitación quedó ciega
+  bool hayErrores() const
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      if (!sensors[i]->hayErrores())
+        return false;
+    }
+    return true;
+  }
+
+  void imprimirDatos() const
+  {
+    if (!isnan(ultimaTemperatura) && !isnan(ultimaHumedad))
+    {
+      LOG_D("🌡️  Temperatura: %.1f°C  💧 Humedad: %.1f%% (%u/%u sensores)",
+            ultimaTemperatura, ultimaHumedad, sensorsOk, (unsigned)count);
+    }
+  }
+
+  // Salud 0..100: lecturas exitosas recientes por la calidad del peor canal.
+  // Un sensor sano tiene residuos del orden de su varianza base (calidad 1);
+  // la calidad cae a medida que los residuos la superan.
+  uint8_t salud(size_t i) const
+  {
+    const State &s = state[i];
+    float calidadTemp = fminf(1.0f, 2 * FUSION_TEMP_BASE_VAR / (FUSION_TEMP_BASE_VAR + s.varTemp));
+    float calidadHum = fminf(1.0f, 2 * FUSION_HUM_BASE_VAR / (FUSION_HUM_BASE_VAR + s.varHum));
+    return (uint8_t)(100.0f * s.fiabilidad * fminf(calidadTemp, calidadHum) + 0.5f);
+  }
+
+  void getSnapshot(FusionSnapshot &out)
+  {
+    portENTER_CRITICAL(&mux);
+    out.count = count;
+    out.sensorsOk = sensorsOk;
+    for (size_t i = 0; i < count; i++)
+    {
+      const State &s = state[i];
+      SensorContribution &c = out.sensors[i];
+      c.pin = sensors[i]->getPin();
+      c.ok = s.ok;
+      c.temperatura = sensors[i]->getTemperatura();
+      c.humedad = sensors[i]->getHumedad();
+      c.pesoTemp = s.pesoTemp;
+      c.pesoHum = s.pesoHum;
+      c.salud = salud(i);
+    }
+    portEXIT_CRITICAL(&mux);
+  }
+
+  size_t size() const { return count; }
+  TemperatureSensor &getSensor(size_t i) { return *sensors[i]; }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Metrics.h"
+
+static Gauge metricCpuIdlePct("cpu_idle_pct", "Porcentaje de CPU en las tareas IDLE (ambos nucleos)");
+static Gauge metricLoopStackFree("loop_stack_free_bytes", "Minimo historico de stack libre de loopTask");
+
+// Uso de CPU por tarea y marca de agua del stack.
+// El porcentaje de CPU sale de los contadores de run-time de FreeRTOS
+// (configGENERATE_RUN_TIME_STATS); si el core no los trae compilados, se
+// informa solo el stack y cpuPermille queda en -1.
+class TaskStats
+{
+public:
+  struct Entry
+  {
+    char name[configMAX_TASK_NAME_LEN];
+    int16_t cpuPermille; // CPU en ‰ del total de ambos núcleos
+    uint32_t stackFree;  // Mínimo histórico de stack libre (bytes)
+    UBaseType_t priority;
+  };
+
+private:
+  TaskStatus_t status[TASK_STATS_MAX];
+  uint32_t prevRunTime[TASK_STATS_MAX];
+  UBaseType_t prevTaskNumber[TASK_STATS_MAX];
+  size_t prevCount;
+  uint32_t prevTotalRunTime;
+
+  Entry entries[TASK_STATS_MAX];
+  size_t count;
+  size_t total; // Tareas existentes (más de TASK_STATS_MAX: no hay muestra)
+  int16_t idlePermille;
+
+  // Tiempo acumulado de la tarea en la muestra anterior (0 si es nueva)
+  uint32_t previousRunTime(UBaseType_t taskNumber) const
+  {
+    for (size_t i = 0; i < prevCount; i++)
+    {
+      if (prevTaskNumber[i] == taskNumber)
+        return prevRunTime[i];
+    }
+    return 0;
+  }
+
+public:
+  TaskStats() : prevCount(0), prevTotalRunTime(0), count(0), total(0), idlePermille(-1) {}
+
+  // Tomar una muestra; los porcentajes son sobre el intervalo desde la anterior
+  void collect()
+  {
+    uint32_t totalRunTime = 0;
+    total = uxTaskGetNumberOfTasks();
+    UBaseType_t n = uxTaskGetSystemState(status, TASK_STATS_MAX, &totalRunTime);
+
+#if configGENERATE_RUN_TIME_STATS
+    uint32_t elapsed = (totalRunTime - prevTotalRunTime) * portNUM_PROCESSORS;
+#else
+    uint32_t elapsed = 0;
+#endif
+    int32_t idle = 0;
+
+    count = n;
+    for (size_t i = 0; i < count; i++)
+    {
+      const TaskStatus_t &t = status[i];
+      Entry &e = entries[i];
+      strncpy(e.name, t.pcTaskName, sizeof(e.name) - 1);
+      e.name[sizeof(e.name) - 1] = '\0';
+      e.stackFree = t.usStackHighWaterMark; // En ESP-IDF ya está en bytes
+      e.priority = t.uxCurrentPriority;
+      e.cpuPermille = -1;
+
+#if configGENERATE_RUN_TIME_STATS
+      if (elapsed > 0 && prevCount > 0)
+      {
+        uint32_t delta = t.ulRunTimeCounter - previousRunTime(t.xTaskNumber);
+        e.cpuPermille = (int16_t)((uint64_t)delta * 1000 / elapsed);
+        if (strncmp(e.name, "IDLE", 4) == 0)
+          idle += e.cpuPermille;
+      }
+#endif
+
+      if (strcmp(e.name, "loopTask") == 0)
+        metricLoopStackFree.set(e.stackFree);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      prevTaskNumber[i] = status[i].xTaskNumber;
+      prevRunTime[i] = status[i].ulRunTimeCounter;
+    }
+    idlePermille = (elapsed > 0 && prevCount > 0) ? idle : -1;
+    prevCount = count;
+    prevTotalRunTime = totalRunTime;
+
+    metricCpuIdlePct.set(idlePermille >= 0 ? idlePermille / 10 : -1);
+  }
+
+  size_t size() const { return count; }
+  size_t getTotal() const { return total; }
+  const Entry &at(size_t i) const { return entries[i]; }
+  int16_t getIdlePermille() const { return idlePermille; }
+};
+
+#endif
@@ -3,42 +3,246 @@
 
 #include <Arduino.h>
 #include <DHT.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Log.h"
+#include "PowerManager.h"
+#include "Calibration.h"
+
+static const uint32_t SENSOR_READ_BUCKETS_US[] = {1000, 5000, 10000, 25000, 50000};
+static Counter metricSensorReads("sensor_reads", "Lecturas del DHT intentadas");
+static Counter metricSensorErrors("sensor_read_errors", "Lecturas del DHT fallidas o fuera de rango");
+static Gauge metricSensorConsecutiveErrors("sensor_consecutive_errors", "Errores de lectura consecutivos");
+static Histogram<5> metricSensorReadUs("sensor_read_us", "Duracion de la lectura del DHT en microsegundos", SENSOR_READ_BUCKETS_US);
+static Counter metricSensorStuck("sensor_stuck_detections", "Sensores con valor congelado o plano detectados");
+static Counter metricSensorRecoveries("sensor_recoveries", "Intentos de recuperacion (reinicio del bus o de la alimentacion)");
+static Counter metricSensorRecovered("sensor_recoveries_ok", "Recuperaciones seguidas de una lectura valida");
+
+// Estadísticas de un sensor desde el arranque
+struct SensorHealthStats
+{
+  uint32_t reads;
+  uint32_t errors;
+  uint32_t stuckEvents;
+  uint32_t recoveries;
+  uint32_t recovered;
+  uint32_t lastReadUs;
+  uint32_t maxReadUs;
+  uint64_t healthyMs;   // Tiempo entregando lecturas válidas
+  uint64_t totalMs;
+};
 
 class TemperatureSensor
 {
 private:
   DHT dht;
   uint8_t pin;
+  int8_t powerPin;      // GPIO que alimenta al sensor, -1 si no hay
+  SensorCalibration calibracion;
   float ultimaTemperatura;
   float ultimaHumedad;
   int erroresConsecutivos;
   static const int MAX_ERRORES = 5;
 
+  // Detección de valor congelado (lecturas crudas idénticas) y de línea
+  // plana (rango menor al ruido normal del DHT22). Las ventanas son de
+  // tiempo, no de lecturas: con intervalos cortos una habitación quieta da
+  // muchas lecturas iguales seguidas sin que el sensor falle
+  float crudaTemp;
+  float crudaHum;
+  uint16_t repetidas;
+  uint64_t repetidasDesdeMs;
+  float planoMinTemp, planoMaxTemp, planoMinHum, planoMaxHum;
+  uint16_t planoMuestras;
+  uint64_t planoDesdeMs;
+
+  // Una sospecha solo dispara una recuperación y las lecturas se siguen
+  // entregando; si la primera lectura después sigue en el valor sospechoso
+  // la falla queda confirmada y se dejan de entregar
+  bool verificando;     // Recuperación por sospecha, falta la lectura que decide
+  bool congelado;       // Falla confirmada
+  float sospechaTemp;
+  float sospechaHum;
+
+  // Recuperación con backoff
+  uint32_t backoffMs;
+  uint64_t proximaRecuperacionMs;
+  uint64_t ultimaRecuperacionMs;
+  bool recuperando;     // Hubo recuperación y falta la primera lectura válida
+
+  SensorHealthStats stats;
+  uint64_t ultimaActualizacionMs;
+  bool sano;
+
+  void actualizarDisponibilidad(bool ok)
+  {
+    uint64_t now = Clock::nowMs();
+    uint64_t elapsed = now - ultimaActualizacionMs;
+    stats.totalMs += elapsed;
+    if (sano)
+      stats.healthyMs += elapsed;
+    ultimaActualizacionMs = now;
+    sano = ok;
+  }
+
+  void reiniciarVentanas(float temp, float hum, uint64_t now)
+  {
+    crudaTemp = planoMinTemp = planoMaxTemp = temp;
+    crudaHum = planoMinHum = planoMaxHum = hum;
+    repetidas = planoMuestras = 0;
+    repetidasDesdeMs = planoDesdeMs = now;
+  }
+
+  // Devuelve "congelado" o "sin variación" si la lectura completa una
+  // ventana sospechosa, nullptr si no
+  const char *detectarCongelado(float temp, float hum)
+  {
+    uint64_t now = Clock::nowMs();
+    if (isnan(crudaTemp))
+      reiniciarVentanas(temp, hum, now);
+
+    if (temp == crudaTemp && hum == crudaHum)
+    {
+      if (repetidas < UINT16_MAX)
+        repetidas++;
+    }
+    else
+    {
+      crudaTemp = temp;
+      crudaHum = hum;
+      repetidas = 0;
+      repetidasDesdeMs = now;
+    }
+
+    planoMinTemp = min(planoMinTemp, temp);
+    planoMaxTemp = max(planoMaxTemp, temp);
+    planoMinHum = min(planoMinHum, hum);
+    planoMaxHum = max(planoMaxHum, hum);
+    if (planoMaxTemp - planoMinTemp >= SENSOR_FLATLINE_TEMP_RANGE || planoMaxHum - planoMinHum >= SENSOR_FLATLINE_HUM_RANGE)
+    {
+      // Hubo variación: la ventana vuelve a empezar en esta lectura
+      planoMinTemp = planoMaxTemp = temp;
+      planoMinHum = planoMaxHum = hum;
+      planoMuestras = 0;
+      planoDesdeMs = now;
+    }
+    else if (planoMuestras < UINT16_MAX)
+    {
+      planoMuestras++;
+    }
+
+    if (repetidas + 1 >= SENSOR_FAULT_MIN_SAMPLES && now - repetidasDesdeMs >= SENSOR_STUCK_MS)
+      return "congelado";
+    if (planoMuestras + 1 >= SENSOR_FAULT_MIN_SAMPLES && now - planoDesdeMs >= SENSOR_FLATLINE_MS)
+      return "sin variación";
+    return nullptr;
+  }
+
+  // La lectura sigue donde estaba al sospechar (dentro del ruido del DHT22)
+  bool igualASospecha(float temp, float hum) const
+  {
+    return fabsf(temp - sospechaTemp) < SENSOR_FLATLINE_TEMP_RANGE && fabsf(hum - sospechaHum) < SENSOR_FLATLINE_HUM_RANGE;
+  }
+
+  // Reinicia el bus y, si hay GPIO de alimentación, apaga y prende el
+  // sensor. Bloquea unos segundos: corre en la tarea de muestreo.
+  bool recuperar()
+  {
+    uint64_t now = Clock::nowMs();
+    if (now < proximaRecuperacionMs)
+      return false;
+
+    stats.recoveries++;
+    metricSensorRecoveries.inc();
+    LOG_W("🔧 Recuperando DHT en pin %u (%s, próximo intento en %u s)", pin,
+          powerPin >= 0 ? "ciclo de alimentación" : "reinicio del bus", backoffMs / 1000);
+
+    if (powerPin >= 0)
+    {
+      // Sin alimentación el pin de datos también va a bajo, si no el
+      // sensor se alimenta por el pull-up
+      pinMode(pin, OUTPUT);
+      digitalWrite(pin, LOW);
+      digitalWrite(powerPin, LOW);
+      vTaskDelay(pdMS_TO_TICKS(SENSOR_POWER_OFF_MS));
+      digitalWrite(powerPin, HIGH);
+    }
+    else
+    {
+      // Pulso de arranque largo para sacar al sensor de una trama a medias
+      pinMode(pin, OUTPUT);
+      digitalWrite(pin, LOW);
+      vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    pinMode(pin, INPUT_PULLUP);
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_POWER_ON_SETTLE_MS));
+    dht.begin();
+
+    crudaTemp = NAN; // Las ventanas empiezan de nuevo con la próxima lectura
+    recuperando = true;
+
+    ultimaRecuperacionMs = Clock::nowMs();
+    proximaRecuperacionMs = ultimaRecuperacionMs + backoffMs;
+    backoffMs = min((uint32_t)SENSOR_RECOVERY_BACKOFF_MAX_MS, backoffMs * 2);
+    return true;
+  }
+
 public:
-  TemperatureSensor(uint8_t pin, uint8_t tipo = DHT22)
-      : dht(pin, tipo), pin(pin), ultimaTemperatura(NAN), ultimaHumedad(NAN), erroresConsecutivos(0) {}
+  TemperatureSensor(uint8_t pin, uint8_t tipo = DHT22, const char *calNamespace = "cal", int8_t powerPin = -1)
+      : dht(pin, tipo), pin(pin), powerPin(powerPin), calibracion(calNamespace),
+        ultimaTemperatura(NAN), ultimaHumedad(NAN), erroresConsecutivos(0),
+        crudaTemp(NAN), crudaHum(NAN), repetidas(0), repetidasDesdeMs(0),
+        planoMinTemp(NAN), planoMaxTemp(NAN), planoMinHum(NAN), planoMaxHum(NAN), planoMuestras(0), planoDesdeMs(0),
+        verificando(false), congelado(false), sospechaTemp(NAN), sospechaHum(NAN),
+        backoffMs(SENSOR_RECOVERY_BACKOFF_MIN_MS), proximaRecuperacionMs(0), ultimaRecuperacionMs(0), recuperando(false),
+        ultimaActualizacionMs(0), sano(false)
+  {
+    memset(&stats, 0, sizeof(stats));
+  }
 
   void begin()
   {
+    if (powerPin >= 0)
+    {
+      pinMode(powerPin, OUTPUT);
+      digitalWrite(powerPin, HIGH);
+    }
     dht.begin();
-    Serial.println("✓ Sensor DHT11 iniciado");
+    calibracion.begin();
+    ultimaActualizacionMs = Clock::nowMs();
+    LOG_I("✓ Sensor DHT11 iniciado en pin %u", pin);
   }
 
   bool leer()
   {
+    TRACE_SCOPE("leer");
+    CpuBoost boost; // El DHT se lee contando ciclos
+    uint64_t readStart = Clock::nowUs();
     float temp = dht.readTemperature();
     float hum = dht.readHumidity();
+    uint32_t readUs = (uint32_t)(Clock::nowUs() - readStart);
+    metricSensorReadUs.observe(readUs);
+    metricSensorReads.inc();
+    stats.reads++;
+    stats.lastReadUs = readUs;
+    if (readUs > stats.maxReadUs)
+      stats.maxReadUs = readUs;
 
     if (isnan(temp) || isnan(hum))
     {
       erroresConsecutivos++;
-      Serial.print("✗ Error al leer DHT11 (");
-      Serial.print(erroresConsecutivos);
-      Serial.println(" consecutivos)");
+      stats.errors++;
+      metricSensorErrors.inc();
+      metricSensorConsecutiveErrors.set(erroresConsecutivos);
+      actualizarDisponibilidad(false);
+      LOG_W("✗ Error al leer DHT11 en pin %u (%d consecutivos)", pin, erroresConsecutivos);
 
       if (erroresConsecutivos >= MAX_ERRORES)
       {
-        Serial.println("⚠️ Sensor DHT11 posiblemente desconectado");
+        LOG_E("⚠️ Sensor DHT11 en pin %u posiblemente desconectado", pin);
+        recuperar();
       }
       return false;
     }
@@ -46,13 +250,64 @@ public:
     // Validar rangos razonables
     if (temp < -40 || temp > 80 || hum < 0 || hum > 100)
     {
-      Serial.println("✗ Lectura fuera de rango válido");
+      LOG_W("✗ Lectura fuera de rango válido");
+      stats.errors++;
+      metricSensorErrors.inc();
+      actualizarDisponibilidad(false);
       return false;
     }
 
-    ultimaTemperatura = temp;
-    ultimaHumedad = hum;
+    const char *sospecha = detectarCongelado(temp, hum);
+    if (congelado || verificando)
+    {
+      if (igualASospecha(temp, hum))
+      {
+        // Confirmado tras una recuperación: no se entrega, para la fusión
+        // cuenta como caído
+        if (!congelado)
+        {
+          LOG_E("⚠️ DHT en pin %u sigue en %.1f°C, %.1f%% tras la recuperación", pin, temp, hum);
+          stats.stuckEvents++;
+          metricSensorStuck.inc();
+        }
+        verificando = false;
+        congelado = true;
+        actualizarDisponibilidad(false);
+        recuperar();
+        return false;
+      }
+      if (congelado)
+        LOG_I("✓ DHT en pin %u vuelve a variar", pin);
+      verificando = false;
+      congelado = false;
+    }
+    else if (sospecha)
+    {
+      // La lectura se entrega igual: sin confirmar puede ser una habitación quieta
+      LOG_W("⚠️ DHT en pin %u posiblemente %s (%.1f°C, %.1f%%)", pin, sospecha, temp, hum);
+      sospechaTemp = temp;
+      sospechaHum = hum;
+      verificando = recuperar();
+    }
+
+    if (recuperando && !verificando)
+    {
+      LOG_I("✓ DHT en pin %u recuperado", pin);
+      stats.recovered++;
+      metricSensorRecovered.inc();
+      recuperando = false;
+    }
+    // El backoff vuelve al mínimo tras una ventana completa sin problemas
+    if (!verificando && Clock::nowMs() - ultimaRecuperacionMs >= SENSOR_FLATLINE_MS)
+      backoffMs = SENSOR_RECOVERY_BACKOFF_MIN_MS;
+    actualizarDisponibilidad(true);
+
+    // El rango se valida sobre la lectura cruda; de acá en adelante todo
+    // consumidor recibe valores calibrados
+    ultimaTemperatura = calibracion.temperatureC(temp);
+    ultimaHumedad = calibracion.humidityPct(hum);
     erroresConsecutivos = 0;
+    metricSensorConsecutiveErrors.set(0);
     return true;
   }
 
@@ -66,22 +321,33 @@ public:
     return ultimaHumedad;
   }
 
+  uint8_t getPin() const
+  {
+    return pin;
+  }
+
+  SensorCalibration &getCalibracion()
+  {
+    return calibracion;
+  }
+
+  const SensorHealthStats &getStats() const
+  {
+    return stats;
+  }
+
   bool hayErrores() const
   {
-    return erroresConsecutivos >= MAX_ERRORES;
+    return erroresConsecutivos >= MAX_ERRORES || congelado;
   }
 
   void imprimirDatos() const
   {
     if (!isnan(ultimaTemperatura) && !isnan(ultimaHumedad))
     {
-      Serial.print("🌡️  Temperatura: ");
-      Serial.print(ultimaTemperatura, 1);
-      Serial.print("°C  💧 Humedad: ");
-      Serial.print(ultimaHumedad, 1);
-      Serial.println("%");
+      LOG_D("🌡️  Temperatura: %.1f°C  💧 Humedad: %.1f%%", ultimaTemperatura, ultimaHumedad);
     }
   }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,337 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <WiFi.h>
+#include <sdkconfig.h>
+#include <lwip/sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "PowerManager.h"
+
+static const uint32_t TLS_HANDSHAKE_BUCKETS_MS[] = {100, 250, 500, 1000, 2000, 4000};
+static Histogram<6> metricTlsHandshakeMs("tls_handshake_ms", "Duracion del handshake TLS", TLS_HANDSHAKE_BUCKETS_MS);
+static Gauge metricTlsLastHandshakeMs("tls_last_handshake_ms", "Duracion del ultimo handshake TLS");
+static Counter metricTlsResumed("tls_handshakes_resumed", "Handshakes abreviados con la sesion guardada");
+static Counter metricTlsFull("tls_handshakes_full", "Handshakes completos (ECDHE)");
+static Counter metricTlsFailures("tls_handshake_failures", "Handshakes o verificaciones fallidas");
+
+// Cliente TLS 1.2 sobre mbedTLS para PubSubClient.
+// A diferencia de WiFiClientSecure, guarda la sesión (ticket o ID) y la
+// ofrece en la reconexión siguiente: el handshake abreviado evita la
+// operación ECDHE y la verificación de la cadena, que son casi todo el
+// costo. Solo se negocian suites ECDHE-ECDSA con AES-GCM/SHA-256 sobre
+// P-256, que en el ESP32 corren en los aceleradores de AES, SHA y bignum.
+// El contexto SSL se crea en la primera conexión y se reutiliza con
+// mbedtls_ssl_session_reset(), sin volver a pedir los buffers al heap.
+class TlsClient : public Client
+{
+private:
+  static const int CIPHERSUITES[];
+
+  const char *caPem;
+  const char *serverName;
+
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context drbg;
+  mbedtls_x509_crt ca;
+  mbedtls_ssl_config conf;
+  mbedtls_ssl_context ssl;
+  bool configured;
+  bool configFailed;
+  bool sslReady;
+
+  mbedtls_ssl_session session;
+  bool hasSession;
+
+  int fd;
+  bool connectedFlag;
+  bool pollOnly; // Lecturas sin bloquear (available())
+
+  // ---- E/S de mbedTLS sobre el socket ----
+  static int sendCallback(void *ctx, const unsigned char *buf, size_t len)
+  {
+    TlsClient *self = static_cast<TlsClient *>(ctx);
+    int n = send(self->fd, buf, len, 0);
+    if (n >= 0)
+      return n;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+  }
+
+  static int recvCallback(void *ctx, unsigned char *buf, size_t len)
+  {
+    TlsClient *self = static_cast<TlsClient *>(ctx);
+    int n = recv(self->fd, buf, len, self->pollOnly ? MSG_DONTWAIT : 0);
+    if (n >= 0)
+      return n; // 0 = conexión cerrada
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+  }
+
+  // Configuración común a todas las conexiones
+  bool configure()
+  {
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_ssl_config_init(&conf);
+
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) != 0 ||
+        mbedtls_x509_crt_parse(&ca, (const unsigned char *)caPem, strlen(caPem) + 1) != 0 ||
+        mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0)
+    {
+      LOG_E("✗ Configuración TLS inválida (revisar certificado CA)");
+      return false;
+    }
+
+    static const mbedtls_ecp_group_id curves[] = {MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_NONE};
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+    mbedtls_ssl_conf_ciphersuites(&conf, CIPHERSUITES);
+    mbedtls_ssl_conf_curves(&conf, curves);
+    mbedtls_ssl_conf_min_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+#if defined(CONFIG_MBEDTLS_HARDWARE_AES) && defined(CONFIG_MBEDTLS_HARDWARE_SHA) && defined(CONFIG_MBEDTLS_HARDWARE_MPI)
+    LOG_I("🔒 TLS listo (AES/SHA/MPI por hardware)");
+#else
+    LOG_W("🔒 TLS listo, sin todos los aceleradores de hardware");
+#endif
+    return true;
+  }
+
+  bool openSocket(IPAddress ip, uint16_t port)
+  {
+    fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0)
+      return false;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv;
+    tv.tv_sec = TLS_HANDSHAKE_TIMEOUT_MS / 1000;
+    tv.tv_usec = (TLS_HANDSHAKE_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+
+    if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+      close(fd);
+      fd = -1;
+      return false;
+    }
+    return true;
+  }
+
+  bool handshake()
+  {
+    CpuBoost boost; // ECDHE y verificación de la cadena
+    if (!sslReady)
+    {
+      mbedtls_ssl_init(&ssl);
+      if (mbedtls_ssl_setup(&ssl, &conf) != 0)
+        return false;
+      sslReady = true;
+    }
+    else
+    {
+      mbedtls_ssl_session_reset(&ssl);
+    }
+
+    mbedtls_ssl_set_hostname(&ssl, serverName);
+    mbedtls_ssl_set_bio(&ssl, this, sendCallback, recvCallback, nullptr);
+
+    // El servidor repite el ID que ofrecemos solo si acepta reanudar
+    unsigned char offeredId[32];
+    size_t offeredLen = 0;
+    if (hasSession && mbedtls_ssl_set_session(&ssl, &session) == 0)
+    {
+      offeredLen = session.id_len;
+      memcpy(offeredId, session.id, offeredLen);
+    }
+
+    uint64_t start = Clock::nowUs();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0)
+    {
+      if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+      {
+        LOG_W("✗ Handshake TLS falló: -0x%04X", (unsigned)-ret);
+        metricTlsFailures.inc();
+        hasSession = false; // No insistir con una sesión rechazada
+        return false;
+      }
+    }
+    uint32_t elapsedMs = (uint32_t)((Clock::nowUs() - start) / 1000);
+
+    // Guardar la sesión (con ticket, si el servidor lo emitió)
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    hasSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+
+    bool resumed = offeredLen > 0 && hasSession && session.id_len == offeredLen &&
+                   memcmp(session.id, offeredId, offeredLen) == 0;
+    (resumed ? metricTlsResumed : metricTlsFull).inc();
+    metricTlsHandshakeMs.observe(elapsedMs);
+    metricTlsLastHandshakeMs.set(elapsedMs);
+    LOG_I("🔒 Handshake TLS %s en %u ms (%s)", resumed ? "reanudado" : "completo",
+          elapsedMs, mbedtls_ssl_get_ciphersuite(&ssl));
+    return true;
+  }
+
+public:
+  TlsClient()
+      : caPem(""), serverName(nullptr), configured(false), configFailed(false), sslReady(false),
+        hasSession(false), fd(-1), connectedFlag(false), pollOnly(false)
+  {
+    mbedtls_ssl_session_init(&session);
+  }
+
+  // CA en PEM; debe seguir vigente (se parsea en la primera conexión)
+  void setCACert(const char *pem) { caPem = pem; }
+
+  // Nombre que se verifica contra el certificado (y SNI)
+  void setServerName(const char *name) { serverName = name; }
+
+  int connect(IPAddress ip, uint16_t port) override
+  {
+    stop();
+    if (!configured)
+    {
+      if (configFailed || !(configured = configure()))
+      {
+        configFailed = true;
+        return 0;
+      }
+    }
+
+    if (!openSocket(ip, port))
+      return 0;
+
+    if (!handshake())
+    {
+      close(fd);
+      fd = -1;
+      return 0;
+    }
+    connectedFlag = true;
+    return 1;
+  }
+
+  int connect(const char *host, uint16_t port) override
+  {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip))
+      return 0;
+    return connect(ip, port);
+  }
+
+  size_t write(uint8_t b) override
+  {
+    return write(&b, 1);
+  }
+
+  size_t write(const uint8_t *buf, size_t size) override
+  {
+    if (!connectedFlag)
+      return 0;
+
+    size_t sent = 0;
+    while (sent < size)
+    {
+      int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+      if (ret > 0)
+        sent += ret;
+      else if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ)
+      {
+        stop();
+        break;
+      }
+    }
+    return sent;
+  }
+
+  int available() override
+  {
+    if (!connectedFlag)
+      return 0;
+
+    size_t pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (pending == 0)
+    {
+      // Procesar un registro si llegó algo, sin bloquear
+      pollOnly = true;
+      int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+      pollOnly = false;
+      if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+      {
+        stop();
+        return 0;
+      }
+      pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    }
+    return pending;
+  }
+
+  int read() override
+  {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+
+  int read(uint8_t *buf, size_t size) override
+  {
+    if (!available())
+      return -1;
+    int ret = mbedtls_ssl_read(&ssl, buf, size);
+    return ret > 0 ? ret : -1;
+  }
+
+  int peek() override { return -1; } // PubSubClient no lo usa
+  void flush() override {}
+
+  void stop() override
+  {
+    if (fd >= 0)
+    {
+      if (connectedFlag)
+        mbedtls_ssl_close_notify(&ssl);
+      close(fd);
+      fd = -1;
+    }
+    connectedFlag = false;
+  }
+
+  uint8_t connected() override
+  {
+    return connectedFlag;
+  }
+
+  operator bool() override
+  {
+    return connectedFlag;
+  }
+};
+
+const int TlsClient::CIPHERSUITES[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+    0};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "Config.h"
+#include "Clock.h"
+
+// Registro de eventos de traza en un anillo en RAM.
+// Cada evento ocupa 16 bytes (timestamp µs de 32 bits, puntero al nombre,
+// nombre de la tarea y fase) y se escribe sin locks: el índice se reserva
+// con un fetch_add atómico. Los nombres deben ser literales (se guarda el
+// puntero). La tarea se copia al registrar (sus primeros caracteres): el
+// handle no sirve para el volcado porque la tarea puede haber terminado
+// (OTA, sondeo del broker).
+// El volcado es texto "ts fase tarea nombre" por línea; tools/trace_to_chrome.py
+// lo convierte a JSON de Chrome/Perfetto.
+// Con TRACE_ENABLED 0 no hay anillo y dump() no devuelve nada.
+
+enum class TracePhase : char
+{
+  BEGIN = 'B',
+  END = 'E',
+  INSTANT = 'i'
+};
+
+typedef void (*TraceSink)(const char *data, size_t len, void *ctx);
+
+class Tracer
+{
+#if TRACE_ENABLED
+private:
+  static const size_t TASK_NAME_LEN = 7;
+
+  struct Event
+  {
+    uint32_t timestampUs;
+    const char *name;
+    char task[TASK_NAME_LEN]; // Sin terminador si ocupa todo
+    char phase;
+  };
+
+  static Event ring[TRACE_BUFFER_EVENTS];
+  static std::atomic<uint32_t> writeIndex;
+  static volatile bool enabled;
+
+public:
+  static void record(const char *name, TracePhase phase)
+  {
+    if (!enabled)
+      return;
+
+    uint32_t idx = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Event &e = ring[idx % TRACE_BUFFER_EVENTS];
+    e.timestampUs = (uint32_t)Clock::nowUs();
+    e.name = name;
+    e.phase = (char)phase;
+
+    // Los espacios ("Tmr Svc") romperían el formato del volcado
+    const char *task = pcTaskGetName(nullptr);
+    size_t i = 0;
+    for (; i < TASK_NAME_LEN && task[i]; i++)
+      e.task[i] = task[i] == ' ' ? '_' : task[i];
+    if (i < TASK_NAME_LEN)
+      e.task[i] = '\0';
+  }
+
+  static void setEnabled(bool on) { enabled = on; }
+  static bool isEnabled() { return enabled; }
+
+  // Volcar los eventos en orden, del más viejo al más nuevo.
+  // Se pausa el registro durante el volcado para no pisar el anillo.
+  static size_t dump(TraceSink sink, void *ctx)
+  {
+    bool wasEnabled = enabled;
+    enabled = false;
+
+    uint32_t end = writeIndex.load(std::memory_order_relaxed);
+    uint32_t start = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+
+    char line[64];
+    for (uint32_t i = start; i < end; i++)
+    {
+      const Event &e = ring[i % TRACE_BUFFER_EVENTS];
+      int len = snprintf(line, sizeof(line), "%u %c %.*s %s\n",
+                         (unsigned)e.timestampUs, e.phase, (int)TASK_NAME_LEN, e.task, e.name);
+      if (len > 0)
+        sink(line, min<size_t>(len, sizeof(line) - 1), ctx);
+    }
+
+    enabled = wasEnabled;
+    return end - start;
+  }
+
+  static void clear()
+  {
+    writeIndex.store(0, std::memory_order_relaxed);
+  }
+#else
+public:
+  static void record(const char *, TracePhase) {}
+  static void setEnabled(bool) {}
+  static bool isEnabled() { return false; }
+  static size_t dump(TraceSink, void *) { return 0; }
+  static void clear() {}
+#endif
+};
+
+#if TRACE_ENABLED
+// Inicializar miembros estáticos
+Tracer::Event Tracer::ring[TRACE_BUFFER_EVENTS];
+std::atomic<uint32_t> Tracer::writeIndex(0);
+volatile bool Tracer::enabled = true;
+#endif
+
+// Begin/End automáticos para un bloque
+class TraceScope
+{
+private:
+  const char *name;
+
+public:
+  TraceScope(const char *name) : name(name) { Tracer::record(name, TracePhase::BEGIN); }
+  ~TraceScope() { Tracer::record(name, TracePhase::END); }
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_BEGIN(name) Tracer::record(name, TracePhase::BEGIN)
+#define TRACE_END(name) Tracer::record(name, TracePhase::END)
+#define TRACE_INSTANT(name) Tracer::record(name, TracePhase::INSTANT)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_INSTANT(name)
+#endif
+
+#endif
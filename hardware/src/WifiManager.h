@@ -0,0 +1,164 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Config.h"
+#include "Clock.h"
+#include "Log.h"
+
+// Canal y BSSID del último AP, en memoria RTC: sobreviven a un reinicio por
+// software y permiten reconectar sin escanear todos los canales
+RTC_DATA_ATTR static uint8_t cachedBssid[6];
+RTC_DATA_ATTR static int32_t cachedChannel = 0;
+
+// Conexión WiFi manejada por eventos.
+// Nunca reinicia la placa: ante una caída reintenta con backoff exponencial
+// mientras el resto del sistema (muestreo, control AC) sigue funcionando.
+class WifiManager
+{
+private:
+  const char *ssid;
+  const char *password;
+
+  // Escritos desde la tarea de eventos de WiFi
+  volatile bool connected;
+  volatile bool linkLost;
+  volatile uint8_t lastReason;
+
+  bool useFastReconnect;
+  uint32_t backoffMs;
+  uint64_t nextAttemptMs;
+  uint64_t offlineSinceMs;   // 0 = conectado
+  uint64_t offlineTotalMs;
+  uint32_t disconnects;
+
+  static WifiManager *instance;
+
+  static void onEvent(arduino_event_id_t event, arduino_event_info_t info)
+  {
+    if (!instance)
+      return;
+
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      memcpy(cachedBssid, info.wifi_sta_connected.bssid, sizeof(cachedBssid));
+      cachedChannel = info.wifi_sta_connected.channel;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      instance->connected = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      instance->lastReason = info.wifi_sta_disconnected.reason;
+      instance->connected = false;
+      instance->linkLost = true;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void attempt()
+  {
+    WiFi.disconnect();
+    if (useFastReconnect && cachedChannel != 0)
+    {
+      WiFi.begin(ssid, password, cachedChannel, cachedBssid);
+    }
+    else
+    {
+      WiFi.begin(ssid, password);
+    }
+  }
+
+public:
+  WifiManager(const char *ssid, const char *password)
+      : ssid(ssid), password(password), connected(false), linkLost(false), lastReason(0),
+        useFastReconnect(WIFI_FAST_RECONNECT), backoffMs(WIFI_BACKOFF_MIN_MS),
+        nextAttemptMs(0), offlineSinceMs(0), offlineTotalMs(0), disconnects(0)
+  {
+    instance = this;
+  }
+
+  void begin()
+  {
+    WiFi.mode(WIFI_STA);
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false); // Los reintentos los maneja loop()
+    WiFi.onEvent(onEvent);
+
+    offlineSinceMs = Clock::nowMs();
+    nextAttemptMs = offlineSinceMs + backoffMs;
+    attempt();
+  }
+
+  // Espera acotada para el arranque; no es un error si no conecta
+  bool waitConnected(uint32_t timeoutMs)
+  {
+    uint64_t start = Clock::nowMs();
+    while (!connected && Clock::nowMs() - start < timeoutMs)
+    {
+      loop();
+      delay(100);
+    }
+    return connected;
+  }
+
+  void loop()
+  {
+    uint64_t now = Clock::nowMs();
+
+    if (connected)
+    {
+      if (offlineSinceMs != 0)
+      {
+        offlineTotalMs += now - offlineSinceMs;
+        LOG_I("📶 WiFi conectado tras %llu ms offline (IP %s)",
+              now - offlineSinceMs, WiFi.localIP().toString());
+        offlineSinceMs = 0;
+        backoffMs = WIFI_BACKOFF_MIN_MS;
+      }
+      return;
+    }
+
+    if (offlineSinceMs == 0)
+    {
+      offlineSinceMs = now;
+      nextAttemptMs = now + backoffMs;
+      disconnects++;
+      LOG_W("✗ WiFi desconectado (razón %u)", lastReason);
+    }
+
+    // El AP cacheado ya no responde: volver al escaneo completo
+    if (linkLost && useFastReconnect && cachedChannel != 0 && backoffMs > WIFI_BACKOFF_MIN_MS)
+    {
+      cachedChannel = 0;
+    }
+    linkLost = false;
+
+    if (now >= nextAttemptMs)
+    {
+      attempt();
+      nextAttemptMs = now + backoffMs;
+      backoffMs = min<uint32_t>(backoffMs * 2, WIFI_BACKOFF_MAX_MS);
+    }
+  }
+
+  bool isConnected() const { return connected; }
+  uint32_t getDisconnects() const { return disconnects; }
+
+  // Tiempo total sin red, incluyendo la caída en curso
+  uint64_t getOfflineMs() const
+  {
+    uint64_t total = offlineTotalMs;
+    if (offlineSinceMs != 0)
+      total += Clock::nowMs() - offlineSinceMs;
+    return total;
+  }
+};
+
+// Inicializar puntero estático
+WifiManager *WifiManager::instance = nullptr;
+
+#endif
@@ -1,25 +1,65 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <NTPClient.h>
-#include <WiFiUdp.h>
 #include "Config.h"
+#include "Clock.h"
+#include "WifiManager.h"
 #include "AcController.h"
-#include "RgbLed.h"
+#include "CompressorBudget.h"
+#include "DemandResponse.h"
+#include "LedCompositor.h"
 #include "TemperatureSensor.h"
-#include "MqttManager.h"
+#include "SensorFusion.h"
 #include "SensorBuffer.h"
+#include "SamplingTask.h"
+#include "MetricsServer.h"
+#include "TaskStats.h"
+#include "Trace.h"
+#include "Log.h"
+#include "MemoryPool.h"
+#include "OtaUpdater.h"
+#include "Events.h"
+#include "PowerManager.h"
 #include "Config.h"
 
+// Reacciones de la aplicación a comandos MQTT. Usan varios objetos de este
+// archivo, así que se suscriben acá, antes de incluir a quien los publica;
+// los handlers están en la región SUSCRIPTORES
+bool onAcCommand(const AcCommandEvent &event);
+bool onLedCommand(const LedCommandEvent &event);
+bool onConfigUpdate(const ConfigUpdateEvent &event);
+bool onCalibration(const CalibrationEvent &event);
+bool onSensorRead(const SensorReadEvent &event);
+
+EVENT_SUBSCRIBE(AcCommandEvent, 0, onAcCommand);
+EVENT_SUBSCRIBE(LedCommandEvent, 0, onLedCommand);
+EVENT_SUBSCRIBE(ConfigUpdateEvent, 0, onConfigUpdate);
+EVENT_SUBSCRIBE(CalibrationEvent, 0, onCalibration);
+EVENT_SUBSCRIBE(SensorReadEvent, 0, onSensorRead);
+
+#include "MqttManager.h"
+
 #define IR_SEND_PIN 4
 #define DHT_PIN 5
 #define PIN_RED 16
 #define PIN_GREEN 17
 #define PIN_BLUE 18
 
-AcController aire(IR_SEND_PIN);
-RgbLed led(PIN_RED, PIN_GREEN, PIN_BLUE);
-TemperatureSensor sensor(DHT_PIN);
-MqttManager mqtt(MQTT_BROKER, MQTT_PORT, DEVICE_ID);
+WifiManager wifi(WIFI_SSID, WIFI_PASSWORD);
+CompressorBudget compressorBudget(DEVICE_ID);
+AcController aire(IR_SEND_PIN, compressorBudget);
+DemandResponse demand(aire);
+RgbLed rgb(PIN_RED, PIN_GREEN, PIN_BLUE);
+LedCompositor led(rgb);
+const uint8_t sensorPins[] = DHT_PINS;
+const int8_t sensorPowerPins[] = DHT_POWER_PINS;
+static_assert(sizeof(sensorPins) == sizeof(sensorPowerPins), "DHT_POWER_PINS debe tener una entrada por sensor");
+SensorFusion sensor(sensorPins, sensorPowerPins, sizeof(sensorPins));
+const BrokerEndpoint mqttBrokers[] = MQTT_BROKERS;
+MqttManager mqtt(mqttBrokers, sizeof(mqttBrokers) / sizeof(mqttBrokers[0]), DEVICE_ID);
+MetricsServer metricsServer(METRICS_HTTP_PORT);
+TaskStats taskStats;
+SamplingTask sampling(sensor, SAMPLE_INTERVAL_MS, SAMPLE_ALIGN_TO_UTC);
+OtaUpdater ota;
 
 // ============================================
 #pragma region BUFFERS PARA PROMEDIOS
@@ -27,88 +67,206 @@ MqttManager mqtt(MQTT_BROKER, MQTT_PORT, DEVICE_ID);
 CircularBuffer<float, 10> tempBuffer;
 CircularBuffer<float, 10> humBuffer;
 
-// ============================================
-// NTP CLIENT
-// ============================================
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, NTP_SERVER, NTP_OFFSET, NTP_UPDATE_INTERVAL);
+// Mediciones tomadas sin conexión, se publican al reconectar
+CircularBuffer<SampleResult, OFFLINE_BUFFER_LEN> offlineBuffer;
 
 // ============================================
 // VARIABLES GLOBALES
 // ============================================
-unsigned long lastSample = 0;
-unsigned long lastHeartbeat = 0;
-int sampleInterval = SAMPLE_INTERVAL_MS;
+uint64_t lastHeartbeat = 0; // ms monotónicos (Clock)
 int avgSamples = SAMPLES_FOR_AVERAGE;
+uint32_t otaStatusSeq = 0;
+
+// command_id del arranque en cola, para el ack final ("" sin ID o sin cola)
+char queuedCommandId[CommandDedupCache<1>::MAX_ID_LEN + 1] = "";
+
+// Lectura a pedido esperando la conversión de la tarea de muestreo
+bool sensorReadPending = false;
+uint32_t sensorReadTicket = 0;
+uint64_t sensorReadSinceMs = 0;
 
 // ============================================
-#pragma region CALLBACKS MQTT
+#pragma region SUSCRIPTORES
 // ============================================
+// Handlers del bus de eventos que coordinan varios objetos; los de un solo
+// módulo (LED, grupo, demand response, OTA) están en su header
+
+static Gauge metricRoomTemperature("room_temperature_dc", "Temperatura fusionada en decimas de grado");
+static Gauge metricRoomHumidity("room_humidity_dpct", "Humedad fusionada en decimas de porcentaje");
 
-void onAcCommandReceived(bool turnOn, uint8_t temperature, const String& mode, const String& fanSpeed)
+bool onAcAppliedStatus(const AcAppliedEvent &event)
 {
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
-  Serial.printf("📡 Comando AC recibido: %s, %d°C, %s, %s\n",
-                turnOn ? "ENCENDER" : "APAGAR", temperature, mode.c_str(), fanSpeed.c_str());
+  // Confirmar estado al backend
+  if (event.success)
+    mqtt.publishAcStatus(aire.estaEncendido(), aire.getTemperatura(),
+                         aire.getModoStr(), aire.getFanStr(), demand.getLevel(), Clock::utcMs());
+  return true;
+}
+EVENT_SUBSCRIBE(AcAppliedEvent, 1, onAcAppliedStatus);
 
-  bool success = aire.enviarComando(turnOn, temperature, mode, fanSpeed);
+bool onAcCommand(const AcCommandEvent &event)
+{
+  LOG_I("📡 Comando AC recibido: %s, %d°C, %s, %s",
+        event.turnOn ? "ENCENDER" : "APAGAR", event.temperature, event.mode, event.fanSpeed);
 
-  if (success)
+  // Un comando nuevo reemplaza al arranque que seguía en cola
+  if (queuedCommandId[0])
   {
-    // Parpadeo LED para confirmar
-    led.blink(0, 255, 0, 2, 150);
-
-    // Confirmar estado al backend
-    unsigned long timestamp = timeClient.getEpochTime();
-    mqtt.publishAcStatus(aire.estaEncendido(), aire.getTemperatura(),
-                         aire.getModoStr(), aire.getFanStr(), timestamp);
+    mqtt.completeCommandAck(queuedCommandId, false);
+    queuedCommandId[0] = '\0';
   }
-  else
+
+  AcSendResult result = demand.command(event.turnOn, event.temperature, event.mode, event.fanSpeed);
+  if (result == AcSendResult::QUEUED)
   {
-    // Error - parpadeo rojo
-    led.blink(255, 0, 0, 3, 100);
+    // Se aplica desde loop() al obtener el lease de arranque, que manda el ack final
+    *event.status = AcAckStatus::QUEUED;
+    strncpy(queuedCommandId, event.commandId, sizeof(queuedCommandId) - 1);
+    EventBus::publish(AcQueuedEvent{});
+    return true;
   }
 
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
+  bool success = result == AcSendResult::SENT;
+  *event.status = success ? AcAckStatus::APPLIED : AcAckStatus::FAILED;
+  EventBus::publish(AcAppliedEvent{success});
+  return success;
 }
 
-void onLedCommandReceived(uint8_t r, uint8_t g, uint8_t b, bool enabled)
+bool onLedCommand(const LedCommandEvent &event)
 {
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
-  Serial.print("💡 Comando LED recibido: RGB(");
-  Serial.print(r);
-  Serial.print(", ");
-  Serial.print(g);
-  Serial.print(", ");
-  Serial.print(b);
-  Serial.println(")");
+  LOG_I("💡 Comando LED recibido: RGB(%u, %u, %u)", event.r, event.g, event.b);
 
-  led.setEnabledFeedback(enabled);
+  led.setEnabled(event.enabled);
 
-  led.setColor(r, g, b);
-  mqtt.publishLedStatus(r, g, b, enabled);
-
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
+  led.show(LedLayer::USER, event.r, event.g, event.b);
+  mqtt.publishLedStatus(event.r, event.g, event.b, event.enabled);
+  return true;
 }
 
-void onConfigUpdateReceived(int newSampleInterval, int newAvgSamples)
+bool onConfigUpdate(const ConfigUpdateEvent &event)
 {
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
-  Serial.println("⚙️  Configuración actualizada:");
-  Serial.print("   Sample Interval: ");
-  Serial.print(newSampleInterval);
-  Serial.println("s");
-  Serial.print("   Avg Samples: ");
-  Serial.println(newAvgSamples);
+  // El DHT22 no admite lecturas más seguidas que SENSOR_MIN_READ_INTERVAL_MS
+  if (event.sampleIntervalS < (int)(SENSOR_MIN_READ_INTERVAL_MS / 1000) || event.sampleIntervalS > SAMPLE_INTERVAL_MAX_S ||
+      event.avgSamples < 1 || event.avgSamples > (int)tempBuffer.capacity())
+  {
+    LOG_W("⚠️ Configuración rechazada: sample_interval %d s, avg_samples %d", event.sampleIntervalS, event.avgSamples);
+    return false;
+  }
+
+  LOG_I("⚙️  Configuración actualizada: Sample Interval %ds, Avg Samples %d",
+        event.sampleIntervalS, event.avgSamples);
 
-  sampleInterval = newSampleInterval * 1000; // Convertir a ms
-  avgSamples = newAvgSamples;
+  sampling.setInterval((uint32_t)event.sampleIntervalS * 1000); // Convertir a ms
+  avgSamples = event.avgSamples;
 
   // Limpiar buffers al cambiar configuración
   tempBuffer.clear();
   humBuffer.clear();
+  return true;
+}
+
+bool onCalibration(const CalibrationEvent &event)
+{
+  const char *name = event.channel == CalChannel::TEMPERATURE ? "temperatura" : "humedad";
+  if (event.sensor >= sensor.size() ||
+      !sensor.getSensor(event.sensor).getCalibracion().update(event.channel, event.points, event.count))
+    return false;
+
+  LOG_I("📐 Calibración de %s del sensor %u actualizada: %u puntos", name, event.sensor, (unsigned)event.count);
+
+  // Los promedios en curso mezclarían valores con y sin la curva nueva
+  tempBuffer.clear();
+  humBuffer.clear();
+  return true;
+}
+
+// Lectura a pedido: sale de la cache de la tarea de muestreo y solo
+// convierte si la cache es más vieja que maxAgeMs. La conversión no se
+// espera acá: loop() publica cuando termina (o vence SENSOR_READ_WAIT_MS)
+bool onSensorRead(const SensorReadEvent &event)
+{
+  SensorReading reading;
+  uint32_t ticket;
+  if (sampling.requestRead(reading, event.maxAgeMs, ticket))
+  {
+    mqtt.publishCurrentReading(reading, true);
+    return true;
+  }
+
+  // Pedidos mientras hay uno en curso se responden con la misma conversión
+  if (!sensorReadPending)
+  {
+    sensorReadPending = true;
+    sensorReadTicket = ticket;
+    sensorReadSinceMs = Clock::nowMs();
+  }
+  return true;
+}
 
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
+bool onSamplePublish(const SampleEvent &event)
+{
+  const SampleResult &sample = event.sample;
+  if (!sample.ok)
+    return true;
+
+  // Enviar medición raw a MQTT, o guardarla hasta reconectar (también si
+  // falla o si quedan offline sin publicar, para mantener el orden).
+  // Timestamp del slot nominal (alineado a UTC si hay hora NTP)
+  if (offlineBuffer.size() > 0 ||
+      !mqtt.publishTemperature(sample.temperatura, sample.humedad, sample.timestampMs))
+    offlineBuffer.push(sample);
+
+  // Con varios sensores, detalle de la fusión (solo en vivo)
+  if (sensor.size() > 1)
+  {
+    FusionSnapshot fusion;
+    sensor.getSnapshot(fusion);
+    mqtt.publishFusion(fusion, sample.temperatura, sample.humedad, sample.timestampMs);
+  }
+  return true;
+}
+EVENT_SUBSCRIBE(SampleEvent, 0, onSamplePublish);
+
+bool onSampleAverage(const SampleEvent &event)
+{
+  const SampleResult &sample = event.sample;
+  if (!sample.ok)
+    return true;
+
+  // Agregar a buffers
+  tempBuffer.push(sample.temperatura);
+  humBuffer.push(sample.humedad);
+
+  // Si completamos las muestras necesarias, enviar promedio
+  if (tempBuffer.size() >= (size_t)avgSamples)
+  {
+    float avgTemp = tempBuffer.average(avgSamples);
+    float avgHum = humBuffer.average(avgSamples);
+
+    mqtt.publishAverage(avgTemp, avgHum, avgSamples, sample.timestampMs);
+
+    // Limpiar buffers
+    tempBuffer.clear();
+    humBuffer.clear();
+  }
+  return true;
+}
+EVENT_SUBSCRIBE(SampleEvent, 1, onSampleAverage);
+
+bool onSampleMetrics(const SampleEvent &event)
+{
+  if (event.sample.ok)
+  {
+    metricRoomTemperature.set((int32_t)lroundf(event.sample.temperatura * 10));
+    metricRoomHumidity.set((int32_t)lroundf(event.sample.humedad * 10));
+  }
+  return true;
+}
+EVENT_SUBSCRIBE(SampleEvent, 3, onSampleMetrics);
+
+void serialSink(const char *data, size_t len, void *)
+{
+  Serial.write((const uint8_t *)data, len);
 }
 
 // ============================================
@@ -119,102 +277,81 @@ void setup()
 {
   Serial.begin(115200);
   delay(1000);
+  Log::begin();
+  ota.begin(); // Antes que nada: puede volver a la imagen anterior
 
-  Serial.println("\n\n");
-  Serial.println("╔════════════════════════════════════╗");
-  Serial.println("║   SISTEMA DE CLIMA INTELIGENTE    ║");
-  Serial.println("║         ESP32 + MQTT v1.0          ║");
-  Serial.println("╚════════════════════════════════════╝");
-  Serial.println();
+  PowerManager::begin();
+  CpuBoost boost; // Arranque a frecuencia máxima hasta el final de setup()
+
+  LOG_I("SISTEMA DE CLIMA INTELIGENTE - ESP32 + MQTT v1.0");
 
   // ============================================
   // CONECTAR WiFi
   // ============================================
-  Serial.print("📶 Conectando a WiFi");
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  LOG_I("📶 Conectando a WiFi...");
+  wifi.begin();
 
-  int wifiRetries = 0;
-  while (WiFi.status() != WL_CONNECTED && wifiRetries < 30)
+  // Sin red se arranca igual: muestreo y control siguen funcionando offline
+  if (wifi.waitConnected(WIFI_BOOT_TIMEOUT_MS))
   {
-    delay(500);
-    Serial.print(".");
-    wifiRetries++;
+    LOG_I("   RSSI: %d dBm", WiFi.RSSI());
   }
-
-  if (WiFi.status() != WL_CONNECTED)
+  else
   {
-    Serial.println("\n✗ No se pudo conectar a WiFi");
-    Serial.println("Reiniciando en 5 segundos...");
-    delay(5000);
-    ESP.restart();
+    LOG_W("   ✗ Sin WiFi, se sigue reintentando en segundo plano");
   }
 
-  Serial.println(" ✓");
-  Serial.print("   IP: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("   RSSI: ");
-  Serial.print(WiFi.RSSI());
-  Serial.println(" dBm");
-  Serial.println();
-
   // ============================================
   // INICIALIZAR NTP
   // ============================================
-  Serial.print("🕐 Sincronizando hora NTP...");
-  timeClient.begin();
-  timeClient.update();
-  Serial.println(" ✓");
-  Serial.print("   Hora actual: ");
-  Serial.println(timeClient.getFormattedTime());
-  Serial.println();
+  Clock::beginSntp(NTP_SERVER, NTP_UPDATE_INTERVAL);
+
+  // La sincronización sigue en segundo plano si no llega a tiempo
+  uint64_t ntpStart = Clock::nowMs();
+  while (wifi.isConnected() && !Clock::isSynced() && Clock::nowMs() - ntpStart < NTP_SYNC_TIMEOUT_MS)
+  {
+    delay(100);
+  }
+  LOG_I("🕐 Hora NTP %s, UTC ms: %llu", Clock::isSynced() ? "✓" : "(pendiente)", Clock::utcMs());
 
   // ============================================
   // INICIALIZAR HARDWARE
   // ============================================
-  Serial.println("🔧 Inicializando hardware:");
+  LOG_I("🔧 Inicializando hardware");
   sensor.begin();
   led.begin();
   aire.begin();
-  Serial.println();
+  demand.begin();
 
   // ============================================
   // CONECTAR MQTT
   // ============================================
-  Serial.println("🌐 Conectando a MQTT Broker:");
-  Serial.print("   Broker: ");
-  Serial.print(MQTT_BROKER);
-  Serial.print(":");
-  Serial.println(MQTT_PORT);
-  Serial.print("   Device ID: ");
-  Serial.println(DEVICE_ID);
+  LOG_I("🌐 Conectando a MQTT (%u brokers), Device ID: %s",
+        (unsigned)(sizeof(mqttBrokers) / sizeof(mqttBrokers[0])), DEVICE_ID);
 
   mqtt.begin();
 
-  // Configurar callbacks
-  mqtt.setAcCommandCallback(onAcCommandReceived);
-  mqtt.setLedCommandCallback(onLedCommandReceived);
-  mqtt.setConfigUpdateCallback(onConfigUpdateReceived);
-  Serial.println();
-
   // ============================================
   // SEÑAL DE INICIO
   // ============================================
-  Serial.println("✅ Sistema iniciado correctamente");
-  Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
-  Serial.println();
+  LOG_I("✅ Sistema iniciado correctamente");
 
-  // Parpadeo verde de confirmación
-  led.blink(255, 255, 255, 6, 50);
+  // Parpadeo blanco de confirmación (sin bloquear: lo anima loop())
+  led.blink(LedLayer::BOOT, 255, 255, 255, 6, 50);
 
   // Publicar estado inicial
-  unsigned long timestamp = timeClient.getEpochTime();
   mqtt.publishAcStatus(aire.estaEncendido(), aire.getTemperatura(),
-                       aire.getModoStr(), aire.getFanStr(), timestamp);
+                       aire.getModoStr(), aire.getFanStr(), demand.getLevel(), Clock::utcMs());
 
   uint8_t r, g, b;
-  led.getColor(r, g, b);
-  mqtt.publishLedStatus(r, g, b, true);
+  led.getColor(LedLayer::USER, r, g, b);
+  mqtt.publishLedStatus(r, g, b, led.isEnabled());
+
+  metricsServer.begin();
+  sampling.begin();
+
+  // Uso de pools durante el arranque (conexión, estado inicial)
+  MemoryPool::report();
 }
 
 // ============================================
@@ -223,60 +360,114 @@ void setup()
 
 void loop()
 {
-  unsigned long now = millis();
+  TRACE_SCOPE("loop");
+  uint64_t now = Clock::nowMs();
 
-  // Mantener conexión MQTT
+  // Mantener conexiones WiFi y MQTT
+  wifi.loop();
   mqtt.loop();
+  metricsServer.loop();
+  ota.loop(mqtt.isConnected());
 
-  // Actualizar hora NTP
-  timeClient.update();
+  OtaStatus otaStatus;
+  if (ota.pollStatus(otaStatus, otaStatusSeq))
+  {
+    mqtt.publishOtaStatus(OtaUpdater::stateStr(otaStatus.state), otaStatus.downloaded, otaStatus.total,
+                          otaStatus.written, otaStatus.durationMs, otaStatus.error);
+  }
 
-  // ============================================
-  // TOMAR MUESTRAS DE SENSORES
-  // ============================================
-  if (now - lastSample >= sampleInterval)
+  // Tras cambiar de broker, reponer el estado retained en el nuevo
+  if (mqtt.consumeResync())
   {
-    lastSample = now;
+    mqtt.publishAcStatus(aire.estaEncendido(), aire.getTemperatura(),
+                         aire.getModoStr(), aire.getFanStr(), demand.getLevel(), Clock::utcMs());
+    uint8_t r, g, b;
+    led.getColor(LedLayer::USER, r, g, b);
+    mqtt.publishLedStatus(r, g, b, led.isEnabled());
+  }
 
-    if (sensor.leer())
+  // Publicar lo acumulado mientras no hubo conexión, de a tandas: cada
+  // medición sale del buffer recién cuando se publicó, y ante un fallo se
+  // sigue en el próximo loop()
+  if (mqtt.isConnected() && offlineBuffer.size() > 0)
+  {
+    size_t sent = 0;
+    while (sent < OFFLINE_FLUSH_BATCH && offlineBuffer.size() > 0)
     {
-      float temp = sensor.getTemperatura();
-      float hum = sensor.getHumedad();
-      unsigned long timestamp = timeClient.getEpochTime();
+      const SampleResult &pending = offlineBuffer.at(0);
+      if (!mqtt.publishTemperature(pending.temperatura, pending.humedad, pending.timestampMs))
+      {
+        LOG_W("⚠️ Falló la publicación offline, quedan %u mediciones", offlineBuffer.size());
+        break;
+      }
+      offlineBuffer.dropOldest();
+      sent++;
+    }
+    if (offlineBuffer.size() == 0)
+      LOG_I("📤 Mediciones offline publicadas");
+  }
 
-      // Mostrar datos
-      sensor.imprimirDatos();
+  // ============================================
+  // PROCESAR MUESTRAS DE SENSORES
+  // ============================================
+  // La adquisición la hace la tarea de muestreo; acá solo se reparte
+  SampleResult sample;
+  while (sampling.poll(sample))
+  {
+    EventBus::publish(SampleEvent{sample});
+  }
 
-      // Enviar medición raw a MQTT
-      mqtt.publishTemperature(temp, hum, timestamp);
+  // Lectura a pedido: publicar cuando terminó la conversión; si no llega
+  // a tiempo se responde con la cache y fresh = false
+  if (sensorReadPending)
+  {
+    SensorReading reading;
+    bool fresh = sampling.readDone(sensorReadTicket, reading);
+    if (fresh || Clock::nowMs() - sensorReadSinceMs >= SENSOR_READ_WAIT_MS)
+    {
+      if (!fresh)
+        reading = sampling.latest();
+      mqtt.publishCurrentReading(reading, fresh);
+      sensorReadPending = false;
+    }
+  }
 
-      // Agregar a buffers
-      tempBuffer.push(temp);
-      humBuffer.push(hum);
+  // ============================================
+  // ARRANQUES DE COMPRESOR EN COLA
+  // ============================================
+  bool acSuccess = false;
+  bool startSent = aire.loop(mqtt.isConnected(), acSuccess);
+  if (startSent)
+  {
+    EventBus::publish(AcAppliedEvent{acSuccess});
+  }
 
-      // Si completamos las muestras necesarias, enviar promedio
-      if (tempBuffer.size() >= avgSamples)
-      {
-        float avgTemp = tempBuffer.average(avgSamples);
-        float avgHum = humBuffer.average(avgSamples);
+  // Ack final del comando en cola: aplicado, o descartado (p. ej. por el
+  // ciclo de ventilación de demand response)
+  if (queuedCommandId[0] && !aire.arranqueEnCola())
+  {
+    mqtt.completeCommandAck(queuedCommandId, startSent && acSuccess);
+    queuedCommandId[0] = '\0';
+  }
 
-        mqtt.publishAverage(avgTemp, avgHum, avgSamples, timestamp);
+  CompressorLease lease;
+  if (mqtt.isConnected() && compressorBudget.pollLease(lease))
+  {
+    mqtt.publishCompressorLease(lease);
+  }
 
-        // Limpiar buffers
-        tempBuffer.clear();
-        humBuffer.clear();
-      }
-    }
-    else
-    {
-      // Error en lectura - LED rojo
-      if (sensor.hayErrores())
-      {
-        led.setRojo();
-      }
-    }
+  // ============================================
+  // DEMAND RESPONSE
+  // ============================================
+  // Aplica la señal recibida, el ciclo de ventilación y la restauración
+  if (demand.loop(acSuccess))
+  {
+    EventBus::publish(AcAppliedEvent{acSuccess});
   }
 
+  // Mezclar las capas del LED; no escribe nada si no cambió la salida
+  led.update();
+
   // ============================================
   // HEARTBEAT DEL SISTEMA
   // ============================================
@@ -285,15 +476,21 @@ void loop()
     lastHeartbeat = now;
 
     int rssi = WiFi.RSSI();
-    mqtt.publishHeartbeat(now / 1000, rssi);
-
-    Serial.print("💓 Heartbeat | Uptime: ");
-    Serial.print(now / 1000);
-    Serial.print("s | RSSI: ");
-    Serial.print(rssi);
-    Serial.print(" dBm | Free Heap: ");
-    Serial.print(ESP.getFreeHeap());
-    Serial.println(" bytes");
+    mqtt.publishHeartbeat((uint32_t)(now / 1000), rssi, sampling.getStats(),
+                          (uint32_t)(wifi.getOfflineMs() / 1000), wifi.getDisconnects());
+    taskStats.collect();
+    mqtt.publishTaskStats(taskStats);
+    mqtt.publishSensorHealth(sensor);
+    mqtt.publishMetrics();
+
+    LOG_D("💓 Heartbeat | Uptime: %us | RSSI: %d dBm | Free Heap: %u bytes",
+          (uint32_t)(now / 1000), rssi, ESP.getFreeHeap());
+  }
+
+  // 't' por el monitor serie vuelca las trazas
+  if (Serial.available() && Serial.read() == 't')
+  {
+    Tracer::dump(serialSink, nullptr);
   }
 
   // Pequeño delay para no saturar el CPU
@@ -0,0 +1,362 @@
+#!/usr/bin/env python3
+"""
+Comparar el rendimiento de dos revisiones del firmware (A/B) en la PC.
+
+Compila src/ de cada revisión para el host junto con el driver y los shims
+de bench/ (los del árbol actual, iguales para ambas), reproduce el mismo
+workload sobre el reloj virtual y compara por categoría de evento
+(loop, sample, sensor, mqtt/<topic>, setup):
+
+  - latencia (media, p50, p99 e histograma log2), con significancia
+    estadística (Mann-Whitney entre corridas)
+  - asignaciones al heap y bytes publicados (deterministas: se comparan
+    directamente)
+  - tiempo de CPU total de la corrida
+
+Uso:
+    python ab_bench.py                       # HEAD contra el árbol de trabajo
+    python ab_bench.py --base v1.2 --head HEAD --runs 15
+    python ab_bench.py record captura.txt > bench/workloads/casa.txt
+
+Para grabar un workload real:
+    mosquitto_sub -h <broker> -t 'room_01/#' -F '%U %t %p' > captura.txt
+
+Hace falta ArduinoJson para el host: se toma de .pio/libdeps/*/ArduinoJson
+(queda al compilar el firmware una vez con PlatformIO) o de --arduinojson.
+Las revisiones deben tener el bus de eventos (src/Events.h), que es por
+donde el driver entrega las muestras.
+"""
+
+import argparse
+import glob
+import io
+import json
+import math
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tarfile
+import tempfile
+
+HARDWARE_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH_DIR = os.path.join(HARDWARE_DIR, "bench")
+DEFAULT_WORKLOAD = os.path.join(BENCH_DIR, "workloads", "typical.txt")
+WORKTREE = "WORKTREE"
+
+# Topics a los que se suscribe el dispositivo (MqttManager::subscribeToTopics)
+COMMAND_SUFFIXES = ("ac/command", "led/command", "config/update", "calibration/update",
+                    "sensor/read", "system/reboot", "trace/dump", "ota/update")
+
+SCALAR_METRICS = ("mean_ns", "p50_ns", "p99_ns")
+COUNT_METRICS = ("allocs", "alloc_bytes", "published", "published_bytes")
+
+
+# ============================================
+# Compilación
+# ============================================
+
+def git(*args, cwd=HARDWARE_DIR):
+    return subprocess.run(["git", "-C", cwd] + list(args), check=True,
+                          capture_output=True).stdout
+
+
+def export_revision(rev, dest):
+    """Copiar hardware/src de una revisión (o del árbol de trabajo) a dest/src"""
+    src = os.path.join(dest, "src")
+    if rev == WORKTREE:
+        shutil.copytree(os.path.join(HARDWARE_DIR, "src"), src)
+        return src
+
+    top = git("rev-parse", "--show-toplevel").decode().strip()
+    prefix = git("rev-parse", "--show-prefix").decode().strip()
+    data = git("archive", "--format=tar", f"{rev}:{prefix}src", cwd=top)
+    with tarfile.open(fileobj=io.BytesIO(data)) as tar:
+        tar.extractall(src)
+    return src
+
+
+def case_aliases(src, alias_dir):
+    """Los includes se escriben sin respetar mayúsculas (compila en Windows);
+    en Linux se agregan enlaces con el nombre usado"""
+    os.makedirs(alias_dir, exist_ok=True)
+    files = {name.lower(): name for name in os.listdir(src)}
+    for name in os.listdir(src):
+        with open(os.path.join(src, name), encoding="utf-8", errors="replace") as f:
+            for include in re.findall(r'#include\s+"([^"/]+)"', f.read()):
+                real = files.get(include.lower())
+                alias = os.path.join(alias_dir, include)
+                if real and real != include and not os.path.exists(alias):
+                    os.symlink(os.path.join(src, real), alias)
+
+
+def find_arduinojson(explicit):
+    if explicit:
+        return explicit
+    for path in sorted(glob.glob(os.path.join(HARDWARE_DIR, ".pio", "libdeps", "*", "ArduinoJson", "src"))):
+        return path
+    sys.exit("✗ No se encontró ArduinoJson: compilar una vez con PlatformIO o pasar --arduinojson")
+
+
+def build(rev, workdir, args):
+    dest = os.path.join(workdir, "rev_" + re.sub(r"[^\w.-]", "_", rev))
+    os.makedirs(dest)
+    src = export_revision(rev, dest)
+    aliases = os.path.join(dest, "include")
+    case_aliases(src, aliases)
+
+    binary = os.path.join(dest, "bench")
+    cmd = [args.cxx, "-std=gnu++11", args.opt, "-DARDUINO=10819",
+           "-I", os.path.join(BENCH_DIR, "native"), "-I", src, "-I", aliases,
+           "-I", args.arduinojson, os.path.join(BENCH_DIR, "bench_main.cpp"), "-o", binary]
+    cmd += ["-D" + d for d in args.define or []]
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr)
+        sys.exit(f"✗ No compila la revisión {rev}")
+    return binary
+
+
+def run(binary, args):
+    out = subprocess.run([binary, args.workload, "--loop-ms", str(args.loop_ms)],
+                         check=True, capture_output=True, text=True).stdout
+    return json.loads(out)
+
+
+# ============================================
+# Estadística
+# ============================================
+
+def mann_whitney(a, b):
+    """p-valor bilateral de Mann-Whitney U. Exacto sin empates y muestras
+    chicas; si no, aproximación normal con corrección por empates."""
+    n1, n2 = len(a), len(b)
+    ranked = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(ranked)
+    ties = []
+    i = 0
+    while i < len(ranked):
+        j = i
+        while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        if j > i:
+            ties.append(j - i + 1)
+        i = j + 1
+
+    r1 = sum(r for r, (_, group) in zip(ranks, ranked) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+    u = min(u, n1 * n2 - u)
+
+    if not ties and n1 + n2 <= 40:
+        # Distribución exacta de U por recurrencia: f(n1, n2, u)
+        counts = exact_u_counts(n1, n2)
+        total = sum(counts)
+        p = 2 * sum(counts[: int(u) + 1]) / total
+        return min(1.0, p)
+
+    n = n1 + n2
+    tie_term = sum(t ** 3 - t for t in ties) / (n * (n - 1)) if n > 1 else 0
+    sigma = math.sqrt(n1 * n2 / 12 * ((n + 1) - tie_term))
+    if sigma == 0:
+        return 1.0
+    z = (u - n1 * n2 / 2 + 0.5) / sigma
+    return min(1.0, math.erfc(abs(z) / math.sqrt(2)))
+
+
+def exact_u_counts(n1, n2):
+    """Cantidad de ordenamientos con cada valor de U (0..n1*n2)"""
+    table = {}
+
+    def f(a, b):
+        if (a, b) in table:
+            return table[(a, b)]
+        if a == 0 or b == 0:
+            result = [1]
+        else:
+            # El mayor elemento es de A (suma b a U) o de B (no suma)
+            with_a = [0] * b + f(a - 1, b)
+            with_b = f(a, b - 1)
+            size = max(len(with_a), len(with_b))
+            result = [(with_a[k] if k < len(with_a) else 0) + (with_b[k] if k < len(with_b) else 0)
+                      for k in range(size)]
+        table[(a, b)] = result
+        return result
+
+    return f(n1, n2)
+
+
+def verdict(a, b, alpha, min_effect):
+    ma, mb = statistics.median(a), statistics.median(b)
+    delta = (mb - ma) / ma * 100 if ma else 0.0
+    p = mann_whitney(a, b)
+    if p < alpha and abs(delta) >= min_effect:
+        label = "MÁS LENTO" if delta > 0 else "más rápido"
+    else:
+        label = "sin cambio"
+    return ma, mb, delta, p, label
+
+
+# ============================================
+# Reporte
+# ============================================
+
+def fmt_ns(ns):
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f} ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.2f} µs"
+    return f"{ns:.0f} ns"
+
+
+def histogram_lines(hist_a, hist_b, width=24):
+    used = [i for i in range(32) if hist_a[i] or hist_b[i]]
+    if not used:
+        return []
+    total_a, total_b = sum(hist_a) or 1, sum(hist_b) or 1
+    lines = []
+    for i in range(used[0], used[-1] + 1):
+        fa, fb = hist_a[i] / total_a, hist_b[i] / total_b
+        bar_a = "#" * round(fa * width)
+        bar_b = "#" * round(fb * width)
+        lines.append(f"      {fmt_ns(2 ** i):>10} | A {fa * 100:5.1f}% {bar_a:<{width}} | B {fb * 100:5.1f}% {bar_b}")
+    return lines
+
+
+def report(base, head, runs_a, runs_b, args):
+    out = []
+    out.append(f"Comparación A/B: A = {base}, B = {head}")
+    out.append(f"Workload: {os.path.relpath(args.workload)} ({runs_a[0]['events']} eventos, "
+               f"{runs_a[0]['virtual_s']:.0f} s virtuales), {len(runs_a)} corridas por revisión")
+    out.append(f"Criterio: p < {args.alpha} (Mann-Whitney) y |Δ| >= {args.min_effect}%")
+    out.append("")
+
+    cpu = verdict([r["cpu_s"] for r in runs_a], [r["cpu_s"] for r in runs_b], args.alpha, args.min_effect)
+    out.append(f"CPU total: A {cpu[0]:.3f} s, B {cpu[1]:.3f} s, Δ {cpu[2]:+.1f}% (p={cpu[3]:.3g}) → {cpu[4]}")
+    for key in ("allocs", "published", "published_bytes"):
+        va, vb = runs_a[0][key], runs_b[0][key]
+        out.append(f"{key}: A {va}, B {vb}, Δ {vb - va:+d}")
+    # Mensajes del workload que el firmware no pudo parsear (revisiones viejas no lo informan)
+    errors_a, errors_b = runs_a[0].get("parse_errors", 0), runs_b[0].get("parse_errors", 0)
+    if errors_a or errors_b:
+        out.append(f"⚠️ parse_errors: A {errors_a}, B {errors_b} (mensajes del workload descartados)")
+    out.append("")
+
+    names = sorted(set(runs_a[0]["categories"]) | set(runs_b[0]["categories"]))
+    for name in names:
+        ca = [r["categories"].get(name) for r in runs_a]
+        cb = [r["categories"].get(name) for r in runs_b]
+        if None in ca or None in cb:
+            side = "A" if None in cb else "B"
+            out.append(f"[{name}] solo en {side}")
+            continue
+
+        out.append(f"[{name}] {ca[0]['count']} eventos")
+        for metric in SCALAR_METRICS:
+            ma, mb, delta, p, label = verdict([c[metric] for c in ca], [c[metric] for c in cb],
+                                              args.alpha, args.min_effect)
+            out.append(f"  {metric:<8} A {fmt_ns(ma):>10}  B {fmt_ns(mb):>10}  Δ {delta:+6.1f}%  p={p:<8.3g} {label}")
+
+        # Los conteos no dependen del tiempo: deben repetirse en cada corrida
+        for metric in COUNT_METRICS:
+            va, vb = ca[0][metric], cb[0][metric]
+            unstable = len({c[metric] for c in ca}) > 1 or len({c[metric] for c in cb}) > 1
+            flag = "  (varía entre corridas)" if unstable else ""
+            if va != vb or unstable:
+                out.append(f"  {metric:<8} A {va}  B {vb}  Δ {vb - va:+d}{flag}")
+
+        if args.histograms and ca[0]["count"] >= args.histograms:
+            hist_a = [sum(c["hist_log2_ns"][i] for c in ca) for i in range(32)]
+            hist_b = [sum(c["hist_log2_ns"][i] for c in cb) for i in range(32)]
+            out.extend(histogram_lines(hist_a, hist_b))
+        out.append("")
+
+    return "\n".join(out)
+
+
+# ============================================
+# Grabación de workloads
+# ============================================
+
+def record(capture, out):
+    """Convertir una captura de mosquitto_sub (-F '%U %t %p') a workload:
+    los comandos al dispositivo se reproducen tal cual y cada sensor/raw
+    publicado se vuelve una muestra con los mismos valores"""
+    start = None
+    out.write(f"# Grabado de {os.path.basename(capture.name)}\n")
+    for line in capture:
+        parts = line.rstrip("\n").split(" ", 2)
+        if len(parts) < 3:
+            continue
+        try:
+            ts = float(parts[0])
+        except ValueError:
+            continue
+        topic, payload = parts[1], parts[2]
+        if start is None:
+            start = ts
+        t_ms = int((ts - start) * 1000)
+        suffix = topic.split("/", 1)[1] if "/" in topic else ""
+
+        if suffix in COMMAND_SUFFIXES:
+            out.write(f"{t_ms} mqtt {suffix} {payload}\n")
+        elif suffix == "sensor/raw":
+            try:
+                data = json.loads(payload)
+                out.write(f"{t_ms} sample {data['temperature']} {data['humidity']}\n")
+            except (ValueError, KeyError):
+                continue
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == "record":
+        parser = argparse.ArgumentParser(description="Convertir una captura MQTT a workload")
+        parser.add_argument("command")
+        parser.add_argument("capture", type=argparse.FileType("r", encoding="utf-8"))
+        args = parser.parse_args()
+        record(args.capture, sys.stdout)
+        return
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--base", default="HEAD", help="revisión A (default HEAD)")
+    parser.add_argument("--head", default=WORKTREE, help="revisión B (default: árbol de trabajo)")
+    parser.add_argument("--workload", default=DEFAULT_WORKLOAD)
+    parser.add_argument("--runs", type=int, default=10, help="corridas por revisión, intercaladas")
+    parser.add_argument("--loop-ms", type=int, default=10, help="período mínimo de loop() en tiempo virtual")
+    parser.add_argument("--alpha", type=float, default=0.01)
+    parser.add_argument("--min-effect", type=float, default=2.0, help="cambio mínimo relevante en %%")
+    parser.add_argument("--histograms", type=int, default=100,
+                        help="mostrar histogramas de categorías con al menos N eventos (0: nunca)")
+    parser.add_argument("--arduinojson", help="directorio con ArduinoJson.h")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    parser.add_argument("--opt", default="-O2", help="optimización del build nativo")
+    parser.add_argument("-D", "--define", action="append", help="macro extra para ambas revisiones")
+    parser.add_argument("--json", help="guardar las corridas crudas en este archivo")
+    args = parser.parse_args()
+    args.arduinojson = find_arduinojson(args.arduinojson)
+
+    with tempfile.TemporaryDirectory(prefix="ab_bench_") as workdir:
+        print(f"🔨 Compilando {args.base} y {args.head}...", file=sys.stderr)
+        bin_a = build(args.base, workdir, args)
+        bin_b = build(args.head, workdir, args)
+
+        runs_a, runs_b = [], []
+        for i in range(args.runs):
+            # Orden ABBA: una deriva lenta de la máquina afecta igual a ambas
+            order = [(bin_a, runs_a), (bin_b, runs_b)]
+            for binary, runs in (order if i % 2 == 0 else order[::-1]):
+                runs.append(run(binary, args))
+            print(f"⏱️  Corrida {i + 1}/{args.runs}", file=sys.stderr)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"base": args.base, "head": args.head, "a": runs_a, "b": runs_b}, f)
+
+    print(report(args.base, args.head, runs_a, runs_b, args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Armar curvas de calibración del DHT22 y verificar la tabla compilada.
+
+Entrada: CSV con columnas raw_t,ref_t,raw_h,ref_h (lecturas del dispositivo
+y de un patrón tomadas al mismo tiempo; se puede dejar vacío un canal).
+Si hay más pares que CAL_MAX_POINTS se agrupan por cuantiles de la lectura
+cruda y se promedia cada grupo.
+
+Uso:
+    python calibration.py mediciones.csv            # comando MQTT + verificación
+    python calibration.py mediciones.csv --points 5 --tolerance 0.05
+
+La verificación reproduce en float32 el núcleo de src/Calibration.h
+(tabla uniforme de CAL_LUT_CELLS celdas + interpolación) y lo compara
+con la curva exacta en todo el rango del sensor y con los pares del CSV.
+Sale con código 1 si el error de la tabla supera --tolerance.
+El JSON resultante se publica en <device>/calibration/update.
+"""
+
+import argparse
+import csv
+import json
+import struct
+import sys
+
+CAL_MAX_POINTS = 8     # Igual que src/Config.h
+CAL_LUT_CELLS = 128
+RANGES = {"temperature": (-40.0, 80.0), "humidity": (0.0, 100.0)}
+COLUMNS = {"temperature": ("raw_t", "ref_t"), "humidity": ("raw_h", "ref_h")}
+
+
+def f32(x: float) -> float:
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+def reduce_points(pairs, count):
+    """Agrupa los pares por cuantiles de la lectura cruda"""
+    pairs = sorted(pairs)
+    if len(pairs) <= count:
+        groups = [[p] for p in pairs]
+    else:
+        groups = [pairs[i * len(pairs) // count:(i + 1) * len(pairs) // count] for i in range(count)]
+
+    points = []
+    for g in groups:
+        raw = sum(p[0] for p in g) / len(g)
+        ref = sum(p[1] for p in g) / len(g)
+        if points and abs(points[-1][0] - raw) < 1e-6:
+            continue
+        points.append((round(raw, 2), round(ref, 2)))
+    return points
+
+
+def evaluate(points, raw):
+    """CalibrationCurve::evaluate()"""
+    if not points:
+        return raw
+    if len(points) == 1:
+        return raw + (points[0][1] - points[0][0])
+    k = 0
+    while k + 2 < len(points) and raw > points[k + 1][0]:
+        k += 1
+    (ax, ay), (bx, by) = points[k], points[k + 1]
+    return ay + (raw - ax) * (by - ay) / (bx - ax)
+
+
+def compile_table(points, lo, hi):
+    step = f32((hi - lo) / CAL_LUT_CELLS)
+    return [f32(evaluate(points, f32(lo + i * step))) for i in range(CAL_LUT_CELLS + 1)]
+
+
+def apply(table, lo, hi, raw):
+    """CalibrationCurve::apply()"""
+    inv_step = f32(CAL_LUT_CELLS / (hi - lo))
+    f = f32(min(max(f32((raw - lo) * inv_step), 0.0), CAL_LUT_CELLS - 0.0001))
+    i = int(f)
+    t = f32(f - i)
+    return f32(table[i] + f32(table[i + 1] - table[i]) * t)
+
+
+def check(name, points, pairs, tolerance):
+    lo, hi = RANGES[name]
+    table = compile_table(points, lo, hi)
+
+    steps = 12000
+    lut_err = max(abs(apply(table, lo, hi, lo + (hi - lo) * i / steps) -
+                      evaluate(points, lo + (hi - lo) * i / steps)) for i in range(steps + 1))
+
+    raw_err = max((abs(r - ref) for r, ref in pairs), default=0.0)
+    cal_err = max((abs(apply(table, lo, hi, r) - ref) for r, ref in pairs), default=0.0)
+
+    print(f"{name}: {len(points)} puntos")
+    print(f"  error tabla vs curva exacta: {lut_err:.4f}")
+    print(f"  error contra patrón: crudo {raw_err:.3f} -> calibrado {cal_err:.3f}")
+    return lut_err <= tolerance
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("csv", help="pares crudo/referencia")
+    parser.add_argument("--points", type=int, default=CAL_MAX_POINTS, help="puntos por curva")
+    parser.add_argument("--tolerance", type=float, default=0.05, help="error máximo de la tabla")
+    args = parser.parse_args()
+
+    pairs = {name: [] for name in COLUMNS}
+    with open(args.csv, newline="") as f:
+        for row in csv.DictReader(f):
+            for name, (raw_col, ref_col) in COLUMNS.items():
+                if row.get(raw_col) and row.get(ref_col):
+                    pairs[name].append((float(row[raw_col]), float(row[ref_col])))
+
+    command = {}
+    ok = True
+    for name, channel_pairs in pairs.items():
+        if not channel_pairs:
+            continue
+        points = reduce_points(channel_pairs, min(args.points, CAL_MAX_POINTS))
+        ok &= check(name, points, channel_pairs, args.tolerance)
+        command[name] = [list(p) for p in points]
+
+    print("\nPublicar en <device>/calibration/update:")
+    print(json.dumps(command))
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
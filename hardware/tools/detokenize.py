@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Reconstruir logs tokenizados del ESP32 (LOG_TOKENIZED=1).
+
+Entrada:
+  - Monitor serie: líneas "$<base64>"; el resto de las líneas se copia tal cual.
+  - MQTT (<device>/system/log): payload binario con registros
+    [varint largo][registro]; usar --mqtt.
+
+Uso:
+    pio device monitor | python detokenize.py .pio/build/esp32dev/log_tokens.json
+    mosquitto_sub -t room_01/system/log -C 1 > batch.bin
+    python detokenize.py log_tokens.json --mqtt batch.bin
+"""
+
+import base64
+import json
+import re
+import struct
+import sys
+
+CONVERSION = re.compile(r'%(?:%|[-+ #0]*\d*(?:\.\d+)?(hh|h|ll|l|z|j|t|L)?([diouxXeEfFgGcsp]))')
+
+
+def read_varint(data: bytes, pos: int):
+    value = 0
+    shift = 0
+    while pos < len(data):
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+    raise ValueError("varint truncado")
+
+
+def decode_args(fmt: str, data: bytes, pos: int):
+    """Decodificar los argumentos según las conversiones del formato"""
+    values = []
+    for match in CONVERSION.finditer(fmt):
+        length, conv = match.group(1), match.group(2)
+        if conv is None:
+            continue
+        if pos >= len(data):
+            values.append('?')
+            continue
+
+        if conv in 'eEfFgG':
+            values.append(struct.unpack_from('<f', data, pos)[0])
+            pos += 4
+        elif conv == 's':
+            size, pos = read_varint(data, pos)
+            values.append(data[pos:pos + size].decode('utf-8', errors='replace'))
+            pos += size
+        elif length == 'll':
+            value, pos = read_varint(data, pos)
+            if conv in 'di' and value >= 1 << 63:
+                value -= 1 << 64
+            values.append(value)
+        else:
+            raw, pos = read_varint(data, pos)
+            value = (raw >> 1) ^ -(raw & 1)  # zigzag
+            if conv not in 'di':
+                value &= 0xFFFFFFFF
+            values.append(value)
+    return values
+
+
+def render(fmt: str, values: list) -> str:
+    """Aplicar el formato de printf con los valores decodificados"""
+    it = iter(values)
+
+    def replace(match):
+        if match.group(0) == '%%':
+            return '%'
+        spec = match.group(0)
+        if match.group(1):
+            spec = spec.replace(match.group(1), '')
+        value = next(it, '?')
+        if value == '?':
+            return '?'
+        if match.group(2) == 'p':
+            return hex(value)
+        return spec % value
+
+    return CONVERSION.sub(replace, fmt)
+
+
+def detokenize(record: bytes, database: dict) -> str:
+    token = '%08x' % struct.unpack_from('<I', record, 0)[0]
+    timestamp, pos = read_varint(record, 4)
+    suppressed, pos = read_varint(record, pos)
+
+    entry = database.get(token)
+    if entry is None:
+        return f"[{timestamp / 1000:10.3f}] ? <token {token} desconocido> {record[pos:].hex()}"
+
+    text = render(entry["format"], decode_args(entry["format"], record, pos))
+    if suppressed:
+        text += f" (+{suppressed} suprimidos)"
+    return f"[{timestamp / 1000:10.3f}] {entry['level']} {text}"
+
+
+def iter_mqtt_batch(payload: bytes):
+    pos = 0
+    while pos < len(payload):
+        size, pos = read_varint(payload, pos)
+        yield payload[pos:pos + size]
+        pos += size
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    with open(sys.argv[1], encoding='utf-8') as f:
+        database = json.load(f)
+
+    if len(sys.argv) >= 4 and sys.argv[2] == '--mqtt':
+        with open(sys.argv[3], 'rb') as f:
+            for record in iter_mqtt_batch(f.read()):
+                print(detokenize(record, database))
+        return
+
+    for line in sys.stdin:
+        line = line.rstrip('\r\n')
+        if line.startswith('$'):
+            try:
+                print(detokenize(base64.b64decode(line[1:]), database), flush=True)
+                continue
+            except (ValueError, struct.error):
+                pass
+        print(line, flush=True)
+
+
+if __name__ == "__main__":
+    main()
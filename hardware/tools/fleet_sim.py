@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""
+Simular una flota contra un broker local y verificar el límite de arranques
+simultáneos de compresor (src/CompressorBudget.h).
+
+Cada equipo simulado reproduce la máquina de estados del firmware: en cola,
+pedido retained en fleet/<grupo>/compressor/lease/<id>, espera de pedidos
+simultáneos, lease con vencimiento. Todos piden arrancar a la vez (como
+tras un horario programado) y se mide, sobre los retained que publica el
+broker, cuántos leases hubo vigentes a la vez y cuánto esperó cada uno.
+Los ESP32 reales del mismo grupo entran en la cuenta: basta encenderlos
+por /ac/command al mismo tiempo. Con --command-key los leases van firmados
+como los del firmware (si no, los equipos reales los descartan).
+
+Uso:
+    docker compose up -d mqtt-broker
+    python fleet_sim.py --devices 40 --max-starts 4 --lease-s 20
+    python fleet_sim.py --devices 40 --jitter-ms 800      # broker lento
+    python fleet_sim.py --devices 10 --offline             # sin broker al arrancar
+
+Sale con código 1 si en algún momento hubo más leases vigentes que
+--max-starts. Requiere paho-mqtt (backend/requirements.txt).
+"""
+
+import argparse
+import hashlib
+import hmac
+import heapq
+import json
+import queue
+import random
+import sys
+import time
+import uuid
+
+import paho.mqtt.client as mqtt
+
+# Igual que src/Config.h
+FLEET_CLAIM_SETTLE_MS = 2000
+FLEET_RETRY_MIN_MS = 1000
+FLEET_RETRY_MAX_MS = 5000
+FLEET_MAX_WAIT_MS = 600000
+FLEET_OFFLINE_SPREAD_MS = 60000
+
+IDLE, WAITING, CLAIMING, HELD = range(4)
+
+
+def now_ms() -> int:
+    return int(time.time() * 1000)
+
+
+def fnv1a(text: str) -> int:
+    h = 2166136261
+    for c in text.encode():
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+class SimDevice:
+    """CompressorBudget + el arranque en cola de AcController"""
+
+    def __init__(self, device_id, max_starts, lease_ms):
+        self.id = device_id
+        self.max_starts = max_starts
+        self.lease_ms = lease_ms
+        self.peers = {}  # id -> (held, since, expires)
+        self.state = IDLE
+        self.queued = self.since = self.claim = self.retry = self.expires = 0
+        self.offline_delay = fnv1a(device_id) % FLEET_OFFLINE_SPREAD_MS
+        self.dirty = False
+        self.started_at = None
+
+    def on_lease(self, device, payload):
+        if device == self.id:
+            return
+        if payload is None:
+            self.peers.pop(device, None)
+        elif payload["expires"] > now_ms():
+            self.peers[device] = (payload.get("held", False), payload["since"], payload["expires"])
+
+    def ahead(self, now):
+        count = 0
+        for device, (held, since, expires) in list(self.peers.items()):
+            if expires <= now:
+                del self.peers[device]
+            elif held or since < self.since or (since == self.since and device < self.id):
+                count += 1
+        return count
+
+    def grant(self, now):
+        self.state = HELD
+        self.expires = now + self.lease_ms
+        self.dirty = True
+        self.started_at = now
+
+    def request(self, online):
+        now = now_ms()
+        if self.state == HELD:
+            return True
+        if self.state == IDLE:
+            self.state, self.queued, self.since, self.retry = WAITING, now, now, now
+        if now - self.queued >= FLEET_MAX_WAIT_MS:
+            self.grant(now)
+            return True
+        if not online:
+            if self.state == CLAIMING:
+                self.state = WAITING
+            if now - self.queued >= self.offline_delay:
+                self.grant(now)
+                return True
+            return False
+        if self.state == WAITING:
+            if now >= self.retry and self.ahead(now) < self.max_starts:
+                self.state, self.claim, self.dirty = CLAIMING, now, True
+            return False
+        if now - self.claim < FLEET_CLAIM_SETTLE_MS:
+            return False
+        if self.ahead(now) < self.max_starts:
+            self.grant(now)
+            return True
+        self.state = WAITING
+        self.retry = now + random.randint(FLEET_RETRY_MIN_MS, FLEET_RETRY_MAX_MS)
+        self.dirty = True
+        return False
+
+    def update(self):
+        if self.state == HELD and now_ms() >= self.expires:
+            self.state = IDLE
+            self.dirty = True
+
+    def poll_lease(self):
+        if not self.dirty:
+            return None
+        self.dirty = False
+        if self.state not in (CLAIMING, HELD):
+            return b""
+        remaining = self.expires - now_ms() if self.state == HELD else 2 * FLEET_CLAIM_SETTLE_MS
+        return json.dumps({"held": self.state == HELD, "since": self.since,
+                           "expires": now_ms() + remaining}).encode()
+
+
+def sign(key: bytes, topic: str, payload: dict) -> str:
+    """Como backend/mqtt_client.py: _sign_payload()"""
+    signed = dict(payload, timestamp=int(time.time()), nonce=uuid.uuid4().hex)
+    body = json.dumps(signed, separators=(',', ':'))
+    mac = hmac.new(key, f"{topic}\n{body}".encode(), hashlib.sha256)
+    return f'{body[:-1]},"sig":"{mac.hexdigest()}"}}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--group", default="building_a", help="FLEET_GROUP")
+    parser.add_argument("--devices", type=int, default=20)
+    parser.add_argument("--max-starts", type=int, default=3)
+    parser.add_argument("--lease-s", type=int, default=30)
+    parser.add_argument("--jitter-ms", type=int, default=0, help="demora aleatoria extra por mensaje entregado")
+    parser.add_argument("--offline", action="store_true", help="equipos sin broker: solo retraso por ID")
+    parser.add_argument("--no-budget", action="store_true", help="no publicar el presupuesto (usar el retained actual)")
+    parser.add_argument("--command-key", help="MQTT_COMMAND_KEY, si los equipos exigen firma")
+    parser.add_argument("--timeout-s", type=int, default=600)
+    args = parser.parse_args()
+
+    base = f"fleet/{args.group}/compressor"
+    devices = [SimDevice(f"sim_{i:03d}", args.max_starts, args.lease_s * 1000) for i in range(args.devices)]
+    by_id = {d.id: d for d in devices}
+
+    received = queue.Queue()  # Hilo de paho -> bucle principal
+    inbox = []  # (entrega_ms, seq, equipo, origen, payload) con demora simulada
+    held_now = {}  # Vista del broker: id -> vencimiento de leases con held
+    peak = {"held": 0, "at": 0}
+    seq = 0
+
+    def on_message(client, userdata, msg):
+        received.put((msg.topic, msg.payload))
+
+    client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id=f"fleet_sim_{uuid.uuid4().hex[:8]}")
+    client.on_message = on_message
+    client.connect(args.broker, args.port, 30)
+    client.subscribe(base + "/lease/+", 1)
+    client.loop_start()
+
+    key = args.command_key.encode() if args.command_key else None
+    if not args.no_budget:
+        budget = {"max_starts": args.max_starts, "lease_s": args.lease_s}
+        payload = sign(key, base + "/budget", budget) if key else json.dumps(budget)
+        client.publish(base + "/budget", payload, qos=1, retain=True)
+        print(f"🏭 Presupuesto {base}/budget: {budget}")
+
+    time.sleep(1)  # Retained previos
+    start = now_ms()
+    print(f"⏱️  {args.devices} equipos piden arrancar a la vez")
+
+    pending = set(by_id)
+    while pending and now_ms() - start < args.timeout_s * 1000:
+        now = now_ms()
+        while not received.empty():
+            topic, raw = received.get()
+            device = topic.rsplit("/", 1)[1]
+            payload = json.loads(raw) if raw else None
+            if payload and payload.get("held"):
+                held_now[device] = payload["expires"]
+            else:
+                held_now.pop(device, None)
+            for d in devices:
+                seq += 1
+                heapq.heappush(inbox, (now + random.randint(0, args.jitter_ms), seq, d.id, device, payload))
+
+        while inbox and inbox[0][0] <= now:
+            _, _, target, device, payload = heapq.heappop(inbox)
+            by_id[target].on_lease(device, payload)
+
+        for d in devices:
+            d.update()
+            if d.id in pending and d.request(not args.offline):
+                pending.discard(d.id)
+            lease = d.poll_lease()
+            if lease is not None and not args.offline:
+                topic = f"{base}/lease/{d.id}"
+                if lease and key:
+                    lease = sign(key, topic, json.loads(lease))
+                client.publish(topic, lease, qos=1, retain=True)
+
+        active = sum(1 for expires in held_now.values() if expires > now)
+        if active > peak["held"]:
+            peak.update(held=active, at=now - start)
+        time.sleep(0.02)
+
+    # Dejar el broker limpio
+    for d in devices:
+        client.publish(f"{base}/lease/{d.id}", b"", qos=1, retain=True)
+    time.sleep(0.5)
+    client.loop_stop()
+    client.disconnect()
+
+    waits = sorted(d.started_at - start for d in devices if d.started_at)
+    print(f"Arrancaron {len(waits)}/{args.devices}, sin arrancar: {len(pending)}")
+    if waits:
+        print(f"Espera: min {waits[0] / 1000:.1f} s, mediana {waits[len(waits) // 2] / 1000:.1f} s, "
+              f"max {waits[-1] / 1000:.1f} s")
+        per_window = {}
+        for w in waits:
+            per_window[w // (args.lease_s * 1000)] = per_window.get(w // (args.lease_s * 1000), 0) + 1
+        print("Arranques por lease:", " ".join(f"{per_window.get(i, 0)}" for i in range(max(per_window) + 1)))
+
+    if args.offline:
+        return
+    print(f"Leases vigentes a la vez: máximo {peak['held']} (límite {args.max_starts}) a los {peak['at'] / 1000:.1f} s")
+    if peak["held"] > args.max_starts:
+        print("✗ Se superó el límite")
+        sys.exit(1)
+    print("✓ Límite respetado")
+
+
+if __name__ == "__main__":
+    main()
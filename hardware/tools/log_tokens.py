@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Base de strings de los logs tokenizados.
+
+Recorre src/ buscando LOG_E/W/I/D("formato", ...) y genera un JSON
+token -> formato. El token es FNV-1a de 32 bits sobre los bytes del literal,
+igual que logToken() en src/Log.h.
+
+Se usa de dos formas:
+  - Como extra_script de PlatformIO (pre:): regenera
+    $BUILD_DIR/log_tokens.json en cada build.
+  - Desde la línea de comandos:
+        python log_tokens.py ../src log_tokens.json
+"""
+
+import json
+import os
+import re
+import sys
+
+LOG_CALL = re.compile(r'\bLOG_([EWID])\s*\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)', re.S)
+STRING_LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"', re.S)
+
+SIMPLE_ESCAPES = {
+    'n': b'\n', 't': b'\t', 'r': b'\r', '0': b'\0',
+    '\\': b'\\', '"': b'"', "'": b"'", '?': b'?',
+}
+
+
+def unescape(body: str) -> bytes:
+    """Convertir el contenido de un literal C a los bytes que genera el compilador"""
+    out = bytearray()
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c != '\\':
+            out += c.encode('utf-8')
+            i += 1
+            continue
+
+        nxt = body[i + 1]
+        if nxt == 'x':
+            j = i + 2
+            while j < len(body) and body[j] in '0123456789abcdefABCDEF':
+                j += 1
+            out.append(int(body[i + 2:j], 16) & 0xFF)
+            i = j
+        elif nxt in SIMPLE_ESCAPES:
+            out += SIMPLE_ESCAPES[nxt]
+            i += 2
+        else:
+            out += nxt.encode('utf-8')
+            i += 2
+    return bytes(out)
+
+
+def fnv1a(data: bytes) -> int:
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def scan(src_dir: str) -> dict:
+    """Extraer todos los formatos de log del árbol de fuentes"""
+    database = {}
+    for root, _, files in os.walk(src_dir):
+        for name in sorted(files):
+            if not name.endswith(('.h', '.hpp', '.cpp')):
+                continue
+            path = os.path.join(root, name)
+            with open(path, encoding='utf-8') as f:
+                text = f.read()
+
+            for match in LOG_CALL.finditer(text):
+                fmt = b''.join(unescape(m) for m in STRING_LITERAL.findall(match.group(2)))
+                token = '%08x' % fnv1a(fmt)
+                entry = {
+                    "format": fmt.decode('utf-8', errors='replace'),
+                    "level": match.group(1),
+                    "file": os.path.relpath(path, src_dir),
+                    "line": text.count('\n', 0, match.start()) + 1,
+                }
+                previous = database.get(token)
+                if previous and previous["format"] != entry["format"]:
+                    print(f"⚠️ Colisión de token {token}: {previous['format']!r} / {entry['format']!r}")
+                database[token] = entry
+    return database
+
+
+def write_database(src_dir: str, output: str) -> int:
+    database = scan(src_dir)
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    with open(output, 'w', encoding='utf-8') as f:
+        json.dump(database, f, ensure_ascii=False, indent=1, sort_keys=True)
+    return len(database)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    count = write_database(sys.argv[1], sys.argv[2])
+    print(f"✓ {count} formatos en {sys.argv[2]}")
+
+
+try:
+    Import("env")  # noqa: F821 - definido por PlatformIO/SCons
+    _output = os.path.join(env.subst("$BUILD_DIR"), "log_tokens.json")  # noqa: F821
+    _count = write_database(env.subst("$PROJECT_SRC_DIR"), _output)  # noqa: F821
+    print(f"Log tokens: {_count} formatos -> {_output}")
+except NameError:
+    if __name__ == "__main__":
+        main()
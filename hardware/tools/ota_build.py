@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""
+Preparar imágenes OTA para el ESP32 y servirlas por HTTP en la red local.
+
+Genera, a partir del firmware nuevo (y opcionalmente del que corre hoy):
+  - <nombre>.bin    imagen completa           (format "full")
+  - <nombre>.hs     imagen comprimida         (format "heatshrink")
+  - <nombre>.delta  parche contra la base     (format "delta", comprimido)
+
+y muestra el comando MQTT a publicar en <device>/ota/update.
+
+Uso:
+    python ota_build.py .pio/build/esp32dev/firmware.bin --base viejo.bin \\
+        --out ota/ --serve 8000 --host 192.168.0.105
+
+El parche usa bsdiff4 si está instalado (pip install bsdiff4); si no, se
+usa una búsqueda de anclas más simple que da parches algo más grandes.
+Los parámetros de heatshrink deben coincidir con OTA_HS_WINDOW_BITS y
+OTA_HS_LOOKAHEAD_BITS de src/Config.h.
+"""
+
+import argparse
+import functools
+import hashlib
+import http.server
+import json
+import os
+import socketserver
+import struct
+
+WINDOW_BITS = 12
+LOOKAHEAD_BITS = 5
+MIN_MATCH = 3   # Un backref (1 + 12 + 5 bits) conviene desde 3 bytes
+MAX_CHAIN = 16  # Candidatos por posición: compromiso tamaño/velocidad
+
+# Posición del app_elf_sha256 en la imagen: cabecera (0x18) + segmento (0x08)
+# + offset del campo dentro de esp_app_desc_t (0x90)
+APP_ELF_SHA256_OFFSET = 0x20 + 0x90
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value: int, bits: int):
+        self.acc = (self.acc << bits) | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.acc >> self.count) & 0xFF)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self) -> bytes:
+        if self.count:
+            self.out.append((self.acc << (8 - self.count)) & 0xFF)
+        return bytes(self.out)
+
+
+def heatshrink_compress(data: bytes, window_bits=WINDOW_BITS, lookahead_bits=LOOKAHEAD_BITS) -> bytes:
+    """Compresión LZSS codiciosa con formato de flujo heatshrink"""
+    window = 1 << window_bits
+    max_len = 1 << lookahead_bits
+    chains = {}
+    writer = BitWriter()
+    pos = 0
+    n = len(data)
+
+    while pos < n:
+        best_len = 0
+        best_dist = 0
+        key = data[pos:pos + MIN_MATCH]
+        candidates = chains.get(key, ())
+        limit = min(max_len, n - pos)
+
+        for cand in reversed(candidates):
+            dist = pos - cand
+            if dist > window:
+                break
+            length = MIN_MATCH
+            while length < limit and data[cand + length] == data[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_dist = length, dist
+                if length == limit:
+                    break
+
+        step = best_len if best_len >= MIN_MATCH and len(key) == MIN_MATCH else 1
+        if step > 1:
+            writer.write(0, 1)
+            writer.write(best_dist - 1, window_bits)
+            writer.write(best_len - 1, lookahead_bits)
+        else:
+            writer.write(1, 1)
+            writer.write(data[pos], 8)
+
+        for p in range(pos, pos + step):
+            k = data[p:p + MIN_MATCH]
+            if len(k) == MIN_MATCH:
+                chain = chains.setdefault(k, [])
+                chain.append(p)
+                if len(chain) > MAX_CHAIN:
+                    del chain[0]
+        pos += step
+
+    return writer.finish()
+
+
+def heatshrink_decompress(data: bytes, window_bits=WINDOW_BITS, lookahead_bits=LOOKAHEAD_BITS) -> bytes:
+    """Referencia del decodificador de src/Heatshrink.h, para verificar la salida"""
+    out = bytearray()
+    acc = 0
+    count = 0
+    pos = 0
+
+    def take(bits):
+        nonlocal acc, count, pos
+        while count < bits:
+            if pos >= len(data):
+                return None
+            acc = (acc << 8) | data[pos]
+            pos += 1
+            count += 8
+        count -= bits
+        return (acc >> count) & ((1 << bits) - 1)
+
+    while True:
+        tag = take(1)
+        if tag is None:
+            break
+        if tag:
+            literal = take(8)
+            if literal is None:
+                break
+            out.append(literal)
+        else:
+            index = take(window_bits)
+            length = take(lookahead_bits)
+            if index is None or length is None:
+                break
+            for _ in range(length + 1):
+                src = len(out) - (index + 1)
+                out.append(out[src] if src >= 0 else 0)
+    return bytes(out)
+
+
+def approximate_diff(old: bytes, new: bytes, key_len=16, max_gap=64):
+    """
+    Alternativa a bsdiff sin dependencias: busca anclas exactas de key_len
+    bytes y las extiende hacia adelante tolerando diferencias, con el mismo
+    criterio que bsdiff (2 * coincidencias - largo). Lo que queda entre
+    anclas va como extra.
+    """
+    index = {}
+    for i in range(0, len(old) - key_len + 1, 4):
+        index.setdefault(old[i:i + key_len], i)
+
+    control = []
+    diff = bytearray()
+    extra = bytearray()
+    block_new = 0   # Inicio del diff pendiente en new
+    block_old = 0   # Inicio del diff pendiente en old
+    block_len = 0
+
+    def close_block(next_new, next_old):
+        end_new = block_new + block_len
+        for i in range(block_len):
+            diff.append((new[block_new + i] - old[block_old + i]) & 0xFF)
+        extra.extend(new[end_new:next_new])
+        control.append((block_len, next_new - end_new, next_old - (block_old + block_len)))
+
+    pos = 0
+    while pos <= len(new) - key_len:
+        o = index.get(new[pos:pos + key_len])
+        if o is None:
+            pos += 1
+            continue
+
+        score = best = length = 0
+        limit = min(len(old) - o, len(new) - pos)
+        for i in range(limit):
+            if old[o + i] == new[pos + i]:
+                score += 1
+            if 2 * score - (i + 1) > best:
+                best = 2 * score - (i + 1)
+                length = i + 1
+            elif i + 1 - length > max_gap:
+                break
+
+        close_block(pos, o)
+        block_new, block_old, block_len = pos, o, length
+        pos += length
+
+    close_block(len(new), block_old + block_len)
+    return control, bytes(diff), bytes(extra)
+
+
+def make_patch(old: bytes, new: bytes) -> bytes:
+    """Parche "BSD1" para DeltaPatcher (src/DeltaPatch.h)"""
+    try:
+        import bsdiff4.core
+        control, diff, extra = bsdiff4.core.diff(old, new)
+    except ImportError:
+        control, diff, extra = approximate_diff(old, new)
+
+    out = bytearray(b"BSD1" + struct.pack("<I", len(new)))
+    diff_pos = 0
+    extra_pos = 0
+    for diff_len, extra_len, seek in control:
+        out += struct.pack("<IIi", diff_len, extra_len, seek)
+        out += diff[diff_pos:diff_pos + diff_len]
+        out += extra[extra_pos:extra_pos + extra_len]
+        diff_pos += diff_len
+        extra_pos += extra_len
+    return bytes(out)
+
+
+def apply_patch(old: bytes, patch: bytes) -> bytes:
+    """Referencia de DeltaPatcher, para verificar el parche antes de publicarlo"""
+    assert patch[:4] == b"BSD1", "magic inválido"
+    new_size = struct.unpack_from("<I", patch, 4)[0]
+    pos = 8
+    out = bytearray()
+    old_pos = 0
+    while len(out) < new_size:
+        diff_len, extra_len, seek = struct.unpack_from("<IIi", patch, pos)
+        pos += 12
+        for i in range(diff_len):
+            out.append((old[old_pos + i] + patch[pos + i]) & 0xFF)
+        pos += diff_len
+        old_pos += diff_len
+        out += patch[pos:pos + extra_len]
+        pos += extra_len
+        old_pos += seek
+    return bytes(out)
+
+
+def app_elf_sha256(image: bytes) -> str:
+    return image[APP_ELF_SHA256_OFFSET:APP_ELF_SHA256_OFFSET + 32].hex()
+
+
+def build(firmware: str, base: str, out_dir: str) -> dict:
+    with open(firmware, "rb") as f:
+        new = f.read()
+    name = os.path.splitext(os.path.basename(firmware))[0]
+    os.makedirs(out_dir, exist_ok=True)
+
+    sha256 = hashlib.sha256(new).hexdigest()
+    artifacts = {"full": name + ".bin", "heatshrink": name + ".hs"}
+    with open(os.path.join(out_dir, artifacts["full"]), "wb") as f:
+        f.write(new)
+
+    compressed = heatshrink_compress(new)
+    assert heatshrink_decompress(compressed)[:len(new)] == new, "heatshrink no reproduce la imagen"
+    with open(os.path.join(out_dir, artifacts["heatshrink"]), "wb") as f:
+        f.write(compressed)
+
+    print(f"Imagen completa:  {len(new):8d} bytes")
+    print(f"Comprimida:       {len(compressed):8d} bytes ({100 * len(compressed) / len(new):.1f}%)")
+
+    base_sha = None
+    if base:
+        with open(base, "rb") as f:
+            old = f.read()
+        patch = make_patch(old, new)
+        assert apply_patch(old, patch) == new, "el parche no reproduce la imagen"
+        delta = heatshrink_compress(patch)
+        base_sha = app_elf_sha256(old)
+        artifacts["delta"] = f"{name}-{base_sha[:8]}.delta"
+        with open(os.path.join(out_dir, artifacts["delta"]), "wb") as f:
+            f.write(delta)
+        print(f"Delta:            {len(delta):8d} bytes ({100 * len(delta) / len(new):.1f}%)")
+
+    print(f"SHA-256:          {sha256}")
+    return {"sha256": sha256, "base": base_sha, "artifacts": artifacts}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("firmware", help="firmware.bin nuevo")
+    parser.add_argument("--base", help="firmware.bin que corre hoy en el dispositivo (para el delta)")
+    parser.add_argument("--out", default="ota", help="directorio de salida")
+    parser.add_argument("--host", default="192.168.0.105", help="IP de esta máquina para la URL")
+    parser.add_argument("--serve", type=int, metavar="PORT", help="servir el directorio por HTTP")
+    args = parser.parse_args()
+
+    info = build(args.firmware, args.base, args.out)
+    port = args.serve or 8000
+    fmt = "delta" if info["base"] else "heatshrink"
+    command = {
+        "url": f"http://{args.host}:{port}/{info['artifacts'][fmt]}",
+        "format": fmt,
+        "sha256": info["sha256"],
+    }
+    if info["base"]:
+        command["base"] = info["base"]
+
+    print("\nPublicar en <device>/ota/update:")
+    print(json.dumps(command))
+
+    if args.serve:
+        handler = functools.partial(http.server.SimpleHTTPRequestHandler, directory=args.out)
+        with socketserver.TCPServer(("", args.serve), handler) as server:
+            print(f"\nSirviendo {args.out} en el puerto {args.serve} (Ctrl+C para salir)")
+            server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
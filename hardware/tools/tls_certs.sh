@@ -0,0 +1,44 @@
+#!/bin/sh
+# Certificados ECDSA P-256 para el broker MQTT local con TLS.
+#
+# Genera la CA y el certificado del broker en backend/certs/ (montado por
+# docker-compose para mosquitto-tls.conf) y escribe la CA en
+# hardware/src/Certificates.h para el firmware. El nombre del servidor debe
+# coincidir con MQTT_TLS_SERVER_NAME de src/Config.h.
+#
+# Uso (desde hardware/):  sh tools/tls_certs.sh [mqtt.local]
+set -e
+
+NAME="${1:-mqtt.local}"
+CERTS="../backend/certs"
+HEADER="src/Certificates.h"
+DAYS=3650
+
+mkdir -p "$CERTS"
+cd "$CERTS"
+
+openssl ecparam -name prime256v1 -genkey -noout -out ca.key
+openssl req -x509 -new -key ca.key -sha256 -days "$DAYS" -subj "/CN=Clima CA" -out ca.crt
+
+openssl ecparam -name prime256v1 -genkey -noout -out server.key
+openssl req -new -key server.key -subj "/CN=$NAME" -out server.csr
+printf "subjectAltName=DNS:%s\n" "$NAME" > server.ext
+openssl x509 -req -in server.csr -CA ca.crt -CAkey ca.key -CAcreateserial \
+  -days "$DAYS" -sha256 -extfile server.ext -out server.crt
+rm -f server.csr server.ext ca.srl
+chmod 644 server.key # mosquitto corre con su propio usuario dentro del contenedor
+
+cd - > /dev/null
+{
+  echo "#ifndef CERTIFICATES_H"
+  echo "#define CERTIFICATES_H"
+  echo ""
+  echo "// CA del broker MQTT (PEM). Generado por tools/tls_certs.sh"
+  echo "static const char MQTT_CA_CERT[] = R\"PEM("
+  cat "$CERTS/ca.crt"
+  echo ")PEM\";"
+  echo ""
+  echo "#endif"
+} > "$HEADER"
+
+echo "✓ Certificados para $NAME en $CERTS, CA en $HEADER"
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""
+Convertir un volcado de trazas del ESP32 a JSON de Chrome/Perfetto.
+
+El volcado (topic <device>/trace/data o 't' por el monitor serie) tiene una
+línea por evento: "<ts_us> <fase> <tarea> <nombre>". Los timestamps son de
+32 bits y se desenrollan si dan la vuelta.
+
+Uso:
+    python trace_to_chrome.py volcado.txt > trace.json
+    mosquitto_sub -t room_01/trace/data -C 1 | python trace_to_chrome.py > trace.json
+
+Abrir el resultado en chrome://tracing o https://ui.perfetto.dev
+"""
+
+import json
+import sys
+
+WRAP = 1 << 32
+
+
+def parse_events(lines):
+    """Parsear líneas del volcado a eventos de Chrome"""
+    events = []
+    tids = {}
+    offset = 0
+    previous = None
+
+    for line in lines:
+        parts = line.strip().split(" ", 3)
+        if len(parts) != 4:
+            continue
+
+        ts_raw, phase, task, name = parts
+        try:
+            ts = int(ts_raw)
+        except ValueError:
+            continue
+
+        # El contador de 32 bits dio la vuelta (cada ~71 minutos)
+        if previous is not None and ts + offset < previous - WRAP // 2:
+            offset += WRAP
+        ts += offset
+        previous = ts
+
+        tid = tids.setdefault(task, len(tids) + 1)
+        event = {"name": name, "ph": phase, "ts": ts, "pid": 1, "tid": tid}
+        if phase == "i":
+            event["s"] = "t"
+        events.append(event)
+
+    # Nombres de las tareas como metadatos
+    for task, tid in tids.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                       "args": {"name": task}})
+    return events
+
+
+def main():
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    with source:
+        events = parse_events(source)
+    json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()